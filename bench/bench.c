@@ -0,0 +1,480 @@
+// end-to-end frame benchmark: loads a model, flies a scripted camera around it through render_model and reports frame
+// time statistics. Everything is deterministic, so two runs over the same model and settings do exactly the same work.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "drawer.h"
+#include "io.h"
+#include "mesh.h"
+#include "meshopt.h"
+#include "matrix.h"
+#include "quat.h"
+#include "render.h"
+#include "profiler.h"
+#include "tiles.h"
+#include "timer.h"
+
+#define M_PI 3.14159265358979323846
+#define MAX_RESOLUTIONS 16
+
+typedef enum camera_path
+{
+    PATH_ORBIT, // circles the model from outside, bobbing up and down
+    PATH_FLY    // flies straight through the middle of the model, which stresses the clipper
+} camera_path;
+
+typedef struct bench_result
+{
+    double min_ms;
+    double median_ms;
+    double p99_ms;
+    double mean_ms;
+    double tris_per_sec;
+} bench_result;
+
+static void print_usage(const char* prog)
+{
+    printf("Usage: %s <model.obj> [options]\n", prog);
+    printf("  --frames <n>            measured frames per resolution (default: 300)\n");
+    printf("  --warmup <n>            unmeasured frames before measuring (default: 10)\n");
+    printf("  --res <WxH>[,<WxH>...]  resolutions to run (default: 800x600)\n");
+    printf("  --path <orbit|fly>      camera path (default: orbit)\n");
+    printf("  --csv <file>            append one line per resolution to a CSV file\n");
+    printf("  --trace <file.json>     write a Chrome trace of the pipeline stages for the last resolution\n");
+    printf("  --trace-csv <file>      same, but as one CSV row per frame\n");
+    printf("  --stages                print the mean time per pipeline stage for each resolution\n");
+    printf("  --soa                   feed positions to the vertex stage as a structure-of-arrays stream\n");
+    printf("  --meshlets              cull whole meshlets before the vertex stage (render_mesh)\n");
+    printf("  --instances <n>         draw an n x n field of smaller copies with one instanced call (implies --meshlets)\n");
+    printf("  --solid                 fill triangles instead of drawing the wireframe\n");
+    printf("  --shading <mode>        unlit, gouraud or phong lighting of solid meshes drawn with --meshlets\n");
+    printf("                          (default: gouraud)\n");
+    printf("  --threads <n>           rasterize on n threads (default: one per CPU)\n");
+    printf("  --no-cache              always parse the .obj; don't read or write <model.obj>.meshcache\n");
+    printf("  --optimize              weld vertices and reorder triangles for the vertex cache and overdraw on load\n");
+    printf("  --lods                  build levels of detail on load and draw the one the camera distance calls for\n");
+    printf("                          (implies --meshlets)\n");
+}
+
+/// @brief Builds the orientation that points the camera's forward (-z) axis along `dir`.
+static quat look_along(vec3f dir)
+{
+    float len = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+    if (len == 0.0f)
+    {
+        return (quat){1.0f, 0.0f, 0.0f, 0.0f};
+    }
+    float yaw = atan2f(-dir.x, -dir.z);
+    float pitch = asinf(dir.y / len);
+    return quat_multiply(quat_from_axis_angle((vec3f){0.0f, 1.0f, 0.0f}, yaw),
+                         quat_from_axis_angle((vec3f){1.0f, 0.0f, 0.0f}, pitch));
+}
+
+/// @brief Camera pose at time t in [0, 1) along the path. The model is normalized to the unit sphere around the origin.
+static void camera_at(camera_path path, float t, vec3f* pos, quat* rot)
+{
+    if (path == PATH_FLY)
+    {
+        // from z = +3 straight through the model to z = -3, weaving a little so the view isn't static
+        float a = 2.0f * (float)M_PI * t;
+        *pos = (vec3f){0.3f * sinf(a), 0.2f * sinf(2.0f * a), 3.0f - 6.0f * t};
+        *rot = look_along((vec3f){-0.1f * sinf(a), 0.0f, -1.0f});
+    }
+    else
+    {
+        float a = 2.0f * (float)M_PI * t;
+        *pos = (vec3f){2.5f * sinf(a), 0.75f * sinf(2.0f * a), 2.5f * cosf(a)};
+        *rot = look_along((vec3f){-pos->x, -pos->y, -pos->z});
+    }
+}
+
+/// @brief Builds a transform that centers the model's bounding box on the origin and scales it to fit in the unit sphere.
+static void normalize_transform(vec3f lo, vec3f hi, mat4 out)
+{
+    vec3f half = {(hi.x - lo.x) * 0.5f, (hi.y - lo.y) * 0.5f, (hi.z - lo.z) * 0.5f};
+    float radius = sqrtf(half.x * half.x + half.y * half.y + half.z * half.z);
+    float scale = radius > 0.0f ? 1.0f / radius : 1.0f;
+
+    mat4 translate, scale_m;
+    mat4_translate(translate, -(lo.x + half.x), -(lo.y + half.y), -(lo.z + half.z));
+    mat4_scale(scale_m, scale, scale, scale);
+    mat4_multiply(scale_m, translate, out);
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static bench_result run_resolution(vec3f* vertices, int num_vertices, const vertex_stream* stream, const mesh* meshlets, int* indices, int num_indices,
+                                   mat4 transform, const mat4* instances, int num_instances, camera_path path, render_mode mode, render_shading shading, int threads, int width, int height, int frames, int warmup)
+{
+    bench_result result = {0};
+
+    if (drawer_init(width, height) != 0)
+    {
+        exit(1);
+    }
+    uint32_t* image = malloc((size_t)width * height * sizeof(uint32_t));
+    double* times = malloc(frames * sizeof(double));
+    render_context ctx;
+    if (!image || !times || render_context_init(&ctx, width, height) != 0)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    ctx.mode = mode;
+    ctx.shading = shading;
+    if (threads > 0 && render_context_set_threads(&ctx, threads) != 0)
+    {
+        exit(1);
+    }
+    drawer_clear_buffer(image);
+    dirty_tiles shown;
+    if (dirty_init(&shown, width, height, TILE_SIZE) != 0)
+    {
+        exit(1);
+    }
+
+    double triangles = 0.0; // submitted over the measured frames, at the level of detail each copy was drawn at
+    for (int frame = -warmup; frame < frames; frame++)
+    {
+        vec3f camera_pos;
+        quat camera_rot;
+        // warmup frames replay the start of the path
+        camera_at(path, (float)(frame < 0 ? 0 : frame) / frames, &camera_pos, &camera_rot);
+
+        if (frame == 0 && profiler_enabled)
+        {
+            // only profile measured frames
+            profiler_cleanup();
+            profiler_enable(1);
+        }
+
+        uint64_t start = timer_now_ns();
+        profiler_begin_frame();
+        render_begin_frame(&ctx);
+        if (num_instances > 0)
+            render_mesh_instanced(&ctx, image, meshlets, NULL, instances, num_instances, camera_pos, camera_rot);
+        else if (meshlets)
+            render_mesh(&ctx, image, meshlets, NULL, transform, camera_pos, camera_rot);
+        else if (stream)
+            render_model_stream(&ctx, image, stream, indices, num_indices, transform, camera_pos, camera_rot);
+        else
+            render_model(&ctx, image, vertices, num_vertices, indices, num_indices, transform, camera_pos, camera_rot);
+        PROFILE_BEGIN(PROFILE_PRESENT);
+        // one buffer, so what changed on screen is what this frame drew plus what the last one did
+        dirty_merge(&shown, &ctx.drawn);
+        dirty_rect rects[DIRTY_MAX_RECTS];
+        drawer_draw_buffer_rects(image, rects, dirty_rects(&shown, rects));
+        dirty_copy(&shown, &ctx.drawn);
+        PROFILE_END(PROFILE_PRESENT);
+        PROFILE_BEGIN(PROFILE_CLEAR);
+        dirty_clear_color(&ctx.drawn, image, 0xFF000000);
+        PROFILE_END(PROFILE_CLEAR);
+        profiler_end_frame();
+        uint64_t end = timer_now_ns();
+
+        if (frame >= 0)
+        {
+            times[frame] = timer_ns_to_ms(end - start);
+            if (num_instances > 0)
+            {
+                for (int i = 0; i < num_instances; i++)
+                {
+                    triangles += meshlets->lods[render_select_lod(&ctx, meshlets, (float*)instances[i], camera_pos)].index_count / 3;
+                }
+            }
+            else if (meshlets)
+            {
+                triangles += meshlets->lods[render_select_lod(&ctx, meshlets, transform, camera_pos)].index_count / 3;
+            }
+            else
+            {
+                triangles += num_indices / 3;
+            }
+        }
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < frames; i++)
+    {
+        total += times[i];
+    }
+    qsort(times, frames, sizeof(double), compare_double);
+
+    // nearest-rank percentiles
+    int p99 = (int)ceil(0.99 * frames) - 1;
+    result.min_ms = times[0];
+    result.median_ms = times[(frames - 1) / 2];
+    result.p99_ms = times[p99 < 0 ? 0 : p99];
+    result.mean_ms = total / frames;
+    result.tris_per_sec = total > 0.0 ? triangles / (total / 1000.0) : 0.0;
+
+    dirty_destroy(&shown);
+    render_context_destroy(&ctx);
+    free(times);
+    free(image);
+    drawer_cleanup();
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    char* model_path = NULL;
+    int frames = 300;
+    int warmup = 10;
+    camera_path path = PATH_ORBIT;
+    const char* csv_path = NULL;
+    const char* trace_path = NULL;
+    const char* trace_csv_path = NULL;
+    int print_stages = 0;
+    int use_soa = 0;
+    int use_meshlets = 0;
+    int instance_grid = 0;
+    render_mode mode = RENDER_MODE_WIREFRAME;
+    render_shading shading = RENDER_SHADING_GOURAUD;
+    int threads = 0; // 0 = one per CPU
+    int load_flags = MESH_LOAD_CACHE;
+    int widths[MAX_RESOLUTIONS] = {800};
+    int heights[MAX_RESOLUTIONS] = {600};
+    int num_resolutions = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            warmup = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--res") == 0 && i + 1 < argc)
+        {
+            num_resolutions = 0;
+            char* spec = argv[++i];
+            while (*spec && num_resolutions < MAX_RESOLUTIONS)
+            {
+                int w, h, n;
+                if (sscanf(spec, "%dx%d%n", &w, &h, &n) != 2 || w <= 0 || h <= 0)
+                {
+                    printf("Bad resolution: %s\n", spec);
+                    return 1;
+                }
+                widths[num_resolutions] = w;
+                heights[num_resolutions] = h;
+                num_resolutions++;
+                spec += n;
+                if (*spec == ',') spec++;
+            }
+        }
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "orbit") == 0) path = PATH_ORBIT;
+            else if (strcmp(argv[i], "fly") == 0) path = PATH_FLY;
+            else
+            {
+                printf("Unknown camera path: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--shading") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "unlit") == 0) shading = RENDER_SHADING_UNLIT;
+            else if (strcmp(argv[i], "gouraud") == 0) shading = RENDER_SHADING_GOURAUD;
+            else if (strcmp(argv[i], "phong") == 0) shading = RENDER_SHADING_PHONG;
+            else
+            {
+                printf("Unknown shading: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csv_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace-csv") == 0 && i + 1 < argc)
+        {
+            trace_csv_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stages") == 0)
+        {
+            print_stages = 1;
+        }
+        else if (strcmp(argv[i], "--soa") == 0)
+        {
+            use_soa = 1;
+        }
+        else if (strcmp(argv[i], "--meshlets") == 0)
+        {
+            use_meshlets = 1;
+        }
+        else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+        {
+            instance_grid = atoi(argv[++i]);
+            use_meshlets = 1;
+        }
+        else if (strcmp(argv[i], "--solid") == 0)
+        {
+            mode = RENDER_MODE_SOLID;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--no-cache") == 0)
+        {
+            load_flags &= ~MESH_LOAD_CACHE;
+        }
+        else if (strcmp(argv[i], "--optimize") == 0)
+        {
+            load_flags |= MESH_LOAD_OPTIMIZE;
+        }
+        else if (strcmp(argv[i], "--lods") == 0)
+        {
+            load_flags |= MESH_LOAD_LODS;
+            use_meshlets = 1;
+        }
+        else if (argv[i][0] != '-' && !model_path)
+        {
+            model_path = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!model_path || frames <= 0 || warmup < 0 || (use_soa && use_meshlets) || instance_grid < 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    key_states = calloc(SDL_NUM_SCANCODES, sizeof(int));
+
+    mesh model;
+    uint64_t load_start = timer_now_ns();
+    if (mesh_load(model_path, load_flags, &model) != 0)
+    {
+        return 1;
+    }
+    double load_ms = timer_ns_to_ms(timer_now_ns() - load_start);
+    vec3f* vertices = model.positions;
+    int* indices = model.indices;
+    int num_vertices = model.num_positions;
+    int num_indices = model.num_indices;
+    if (num_indices == 0)
+    {
+        printf("No triangles loaded from %s\n", model_path);
+        return 1;
+    }
+
+    mat4 transform;
+    normalize_transform(model.bounds_min, model.bounds_max, transform);
+
+    // the instance field: n x n copies on the xz plane, each scaled down to fit its cell, filling the same unit sphere
+    int num_instances = instance_grid * instance_grid;
+    mat4* instances = malloc(((size_t)num_instances + 1) * sizeof(mat4));
+    if (!instances)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+    for (int i = 0; i < num_instances; i++)
+    {
+        float cell = 1.4f / instance_grid;
+        mat4 place, scale;
+        mat4_translate(place, -0.7f + cell * (i % instance_grid + 0.5f), 0.0f, -0.7f + cell * (i / instance_grid + 0.5f));
+        mat4_scale(scale, cell * 0.5f, cell * 0.5f, cell * 0.5f);
+        mat4 placed;
+        mat4_multiply(place, scale, placed);
+        mat4_multiply(placed, transform, instances[i]);
+    }
+
+    vertex_stream stream;
+    if (use_soa && vertex_stream_init(&stream, vertices, num_vertices) != 0)
+    {
+        return 1;
+    }
+
+    printf("%s: %d vertices, %d triangles, loaded in %.1f ms\n", model_path, num_vertices, num_indices / 3, load_ms);
+    printf("vertex cache: %.3f misses per triangle (%d-entry FIFO), %d meshlets\n",
+           meshopt_acmr(indices, num_indices, num_vertices), MESHOPT_CACHE_SIZE, model.num_meshlets);
+    for (int l = 1; l < model.num_lods; l++)
+    {
+        printf("lod %d: %u triangles, error %.5f\n", l, model.lods[l].index_count / 3, model.lods[l].error);
+    }
+    if (num_instances > 0)
+    {
+        printf("instances: %d x %d\n", instance_grid, instance_grid);
+    }
+    printf("path: %s, %d frames (+%d warmup)\n\n", path == PATH_FLY ? "fly" : "orbit", frames, warmup);
+    printf("%-11s %10s %10s %10s %10s %14s\n", "resolution", "min ms", "median ms", "p99 ms", "mean ms", "tris/sec");
+
+    FILE* csv = NULL;
+    if (csv_path)
+    {
+        csv = fopen(csv_path, "a");
+        if (!csv)
+        {
+            perror("Failed to open CSV file");
+            return 1;
+        }
+    }
+
+    drawer_set_backend(&drawer_null_backend);
+    profiler_enable(trace_path || trace_csv_path || print_stages);
+    for (int r = 0; r < num_resolutions; r++)
+    {
+        bench_result result = run_resolution(vertices, num_vertices, use_soa ? &stream : NULL, use_meshlets ? &model : NULL, indices, num_indices,
+                                             transform, instances, num_instances, path, mode, shading, threads, widths[r], heights[r], frames, warmup);
+
+        char res[32];
+        snprintf(res, sizeof(res), "%dx%d", widths[r], heights[r]);
+        printf("%-11s %10.3f %10.3f %10.3f %10.3f %14.0f\n", res,
+               result.min_ms, result.median_ms, result.p99_ms, result.mean_ms, result.tris_per_sec);
+
+        if (csv)
+        {
+            fprintf(csv, "%s,%s,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%.0f\n", model_path,
+                    path == PATH_FLY ? "fly" : "orbit", widths[r], heights[r], num_indices / 3, frames,
+                    result.min_ms, result.median_ms, result.p99_ms, result.mean_ms, result.tris_per_sec);
+        }
+
+        if (print_stages)
+        {
+            profiler_print_summary(stdout);
+        }
+    }
+
+    if (trace_path) profiler_export_chrome_trace(trace_path);
+    if (trace_csv_path) profiler_export_csv(trace_csv_path);
+    profiler_cleanup();
+
+    if (csv)
+    {
+        fclose(csv);
+    }
+    if (use_soa)
+    {
+        vertex_stream_destroy(&stream);
+    }
+    free(instances);
+    mesh_free(&model);
+    free(key_states);
+    return 0;
+}
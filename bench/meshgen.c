@@ -0,0 +1,146 @@
+// generates stress-test meshes for the benchmark as Wavefront .obj files
+/*
+    Two shapes, both scaled by a single size parameter:
+    - sphere <segments>: a UV sphere with `segments` slices and `segments / 2` stacks, roughly segments^2 triangles.
+    - cubes <n>: an n x n x n grid of separate cubes, 12 * n^3 triangles.
+
+    Faces are always written in the full v/vt/vn form with real normals and texture coordinates, so the output works with
+    any loader and is still useful once shading and texturing need those attributes.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define M_PI 3.14159265358979323846
+
+static void write_sphere(FILE* out, int segments)
+{
+    int slices = segments < 3 ? 3 : segments;
+    int stacks = slices / 2 < 2 ? 2 : slices / 2;
+
+    // (stacks + 1) x (slices + 1) grid; the seam and poles are duplicated so every vertex gets a unique UV
+    for (int i = 0; i <= stacks; i++)
+    {
+        float phi = (float)M_PI * i / stacks;
+        for (int j = 0; j <= slices; j++)
+        {
+            float theta = 2.0f * (float)M_PI * j / slices;
+            float x = sinf(phi) * cosf(theta);
+            float y = cosf(phi);
+            float z = sinf(phi) * sinf(theta);
+            fprintf(out, "v %f %f %f\n", x, y, z);
+            fprintf(out, "vt %f %f\n", (float)j / slices, 1.0f - (float)i / stacks);
+            fprintf(out, "vn %f %f %f\n", x, y, z);
+        }
+    }
+
+    int row = slices + 1;
+    for (int i = 0; i < stacks; i++)
+    {
+        for (int j = 0; j < slices; j++)
+        {
+            // obj indices are 1-based
+            int a = i * row + j + 1;
+            int b = a + row;
+            int c = b + 1;
+            int d = a + 1;
+            // the pole rows collapse to a point, so only one triangle of each quad there is non-degenerate
+            if (i != 0)
+                fprintf(out, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d, d, c, c, c);
+            if (i != stacks - 1)
+                fprintf(out, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b);
+        }
+    }
+}
+
+static void write_cubes(FILE* out, int n)
+{
+    static const float corners[8][3] = {
+        {-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+        {-1, -1, 1},  {1, -1, 1},  {1, 1, 1},  {-1, 1, 1}
+    };
+    // counter-clockwise when seen from outside
+    static const int faces[6][4] = {
+        {4, 5, 6, 7}, {1, 0, 3, 2}, {5, 1, 2, 6},
+        {0, 4, 7, 3}, {7, 6, 2, 3}, {0, 1, 5, 4}
+    };
+    static const float normals[6][3] = {
+        {0, 0, 1}, {0, 0, -1}, {1, 0, 0},
+        {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}
+    };
+
+    fprintf(out, "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n");
+    for (int f = 0; f < 6; f++)
+    {
+        fprintf(out, "vn %f %f %f\n", normals[f][0], normals[f][1], normals[f][2]);
+    }
+
+    // cubes of half-size 0.25 on a grid of spacing 1, centered on the origin
+    float offset = (n - 1) * 0.5f;
+    int base = 1;
+    for (int x = 0; x < n; x++)
+    {
+        for (int y = 0; y < n; y++)
+        {
+            for (int z = 0; z < n; z++)
+            {
+                for (int c = 0; c < 8; c++)
+                {
+                    fprintf(out, "v %f %f %f\n",
+                            x - offset + corners[c][0] * 0.25f,
+                            y - offset + corners[c][1] * 0.25f,
+                            z - offset + corners[c][2] * 0.25f);
+                }
+                for (int f = 0; f < 6; f++)
+                {
+                    fprintf(out, "f %d/1/%d %d/2/%d %d/3/%d %d/4/%d\n",
+                            base + faces[f][0], f + 1, base + faces[f][1], f + 1,
+                            base + faces[f][2], f + 1, base + faces[f][3], f + 1);
+                }
+                base += 8;
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        printf("Usage: %s sphere <segments> <out.obj>\n", argv[0]);
+        printf("       %s cubes <n> <out.obj>\n", argv[0]);
+        return 1;
+    }
+
+    int size = atoi(argv[2]);
+    if (size <= 0)
+    {
+        printf("Size must be a positive integer.\n");
+        return 1;
+    }
+
+    int is_sphere = strcmp(argv[1], "sphere") == 0;
+    if (!is_sphere && strcmp(argv[1], "cubes") != 0)
+    {
+        printf("Unknown shape: %s\n", argv[1]);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[3], "w");
+    if (!out)
+    {
+        perror("Failed to open output file");
+        return 1;
+    }
+
+    fprintf(out, "# generated by meshgen %s %d\n", argv[1], size);
+    if (is_sphere)
+        write_sphere(out, size);
+    else
+        write_cubes(out, size);
+
+    fclose(out);
+    return 0;
+}
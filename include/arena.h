@@ -0,0 +1,48 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// default alignment for arena allocations: one cache line, which also covers any SIMD load
+#define ARENA_ALIGN 64
+
+typedef struct arena_block
+{
+    struct arena_block* next;
+    size_t size;
+    size_t used;
+} arena_block;
+
+/**
+ * @brief A bump allocator for memory that lives exactly one frame. Allocation is a pointer bump, and everything is
+ * released at once by arena_reset. If a frame needs more than the arena holds, extra blocks are chained on; the next
+ * reset merges them into one block big enough for that frame, so after a few frames the arena stops calling malloc.
+ */
+typedef struct arena
+{
+    arena_block* blocks; // newest first; allocations come from the head
+} arena;
+
+/**
+ * @brief Sets up an arena with one block of `initial_size` bytes.
+ */
+void arena_init(arena* a, size_t initial_size);
+
+/**
+ * @brief Returns `size` bytes aligned to `align` (a power of two). Never returns NULL; exits if the system is out of memory.
+ */
+void* arena_alloc(arena* a, size_t size, size_t align);
+
+/**
+ * @brief Releases every allocation made since the last reset. Pointers handed out before the reset must not be used afterwards.
+ */
+void arena_reset(arena* a);
+
+/// @brief Returns the number of bytes allocated since the last reset, including alignment padding.
+size_t arena_used(const arena* a);
+
+void arena_destroy(arena* a);
+
+#define arena_alloc_array(a, type, count) ((type*)arena_alloc((a), sizeof(type) * (size_t)(count), ARENA_ALIGN))
+
+#endif // ARENA_H
@@ -3,6 +3,14 @@
 #include "matrix.h"
 #include "quat.h"
 
+/**
+ * Builds the view matrix: the inverse of the camera's transform, taking world space to camera space.
+ *  @param camera_pos The camera's position in world space.
+ *  @param camera_rot The camera's orientation in world space.
+ *  @param out Output matrix.
+ */
+void camera_view_matrix(vec3f camera_pos, quat camera_rot, mat4 out);
+
 /**
  * Transforms vertices from world space to camera space.
  *  @param camera_transform The transformation matrix representing the camera's position and orientation in world space.
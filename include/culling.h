@@ -1,11 +1,42 @@
 #ifndef CULLING_H
 #define CULLING_H
+#include <stdint.h>
+#include "arena.h"
 #include "matrix.h"
+#include "threadpool.h"
 
 #define MAX_VERTS_PER_TRI 12
+// the parallel clipper hands out triangles in runs of this many
+#define CULLING_CHUNK_TRIANGLES 4096
+
+// outcode bits: which frustum planes a clip-space vertex is outside of
+#define CULLING_OUT_LEFT   0x001 // x < -w
+#define CULLING_OUT_RIGHT  0x002 // x > w
+#define CULLING_OUT_BOTTOM 0x004 // y < -w
+#define CULLING_OUT_TOP    0x008 // y > w
+#define CULLING_OUT_NEAR   0x010 // z < -w
+#define CULLING_OUT_FAR    0x020 // z > w
+// ...and which sides of the guard band it is outside of
+#define CULLING_OUT_GUARD_LEFT   0x040
+#define CULLING_OUT_GUARD_RIGHT  0x080
+#define CULLING_OUT_GUARD_BOTTOM 0x100
+#define CULLING_OUT_GUARD_TOP    0x200
+
+#define CULLING_OUT_FRUSTUM 0x03f
+// a triangle only has to go through the clipper if one of its vertices has one of these set; crossing a side plane
+// inside the guard band is left to the rasterizer, which clips to the screen for free
+#define CULLING_OUT_NEEDS_CLIP (CULLING_OUT_NEAR | CULLING_OUT_FAR | CULLING_OUT_GUARD_LEFT | CULLING_OUT_GUARD_RIGHT | \
+                                CULLING_OUT_GUARD_BOTTOM | CULLING_OUT_GUARD_TOP)
+
+// the guard band extends this many times the screen's half-size from its center in x and y. 4 keeps screen
+// coordinates well inside the range the rasterizer's fixed-point snapping handles exactly, even at 4K.
+#define CULLING_GUARD_BAND 4.0f
 
 typedef struct {
     vec4f verts[MAX_VERTS_PER_TRI];
+    // barycentric weights of each vertex with respect to the triangle the polygon was clipped from, so attributes
+    // other than the position can be interpolated to the new vertices afterwards
+    vec3f weights[MAX_VERTS_PER_TRI];
     int count;
 } polygon4f;
 
@@ -51,6 +82,14 @@ void clip_polygon_against_plane(polygon4f* in, polygon4f* out, int axis, float s
  */
 void clip_triangle(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, int* out_vert_count);
 
+/**
+ * @brief clip_triangle, also giving each output vertex's barycentric weights with respect to v0, v1 and v2.
+ * The positions are exactly the ones clip_triangle produces.
+ *
+ * @param out_weights Output array of weights, one per output vertex.
+ */
+void clip_triangle_weights(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, vec3f* out_weights, int* out_vert_count);
+
 /**
  * @brief Triangulates a convex polygon into triangles using a triangle fan.
  *
@@ -62,20 +101,60 @@ void clip_triangle(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, int* out_vert
  */
 void triangulate_polygon(vec4f* verts, int count, int* out_indices, int* out_index_count, int base_index);
 
+/**
+ * @brief Returns the CULLING_OUT_* bits for a clip-space vertex.
+ */
+uint16_t culling_outcode(vec4f v);
+
+/**
+ * @brief Extracts the six frustum planes from a model-view-projection matrix (Gribb and Hartmann), in the model's
+ * own space. Each plane is (a, b, c, d) with a unit normal pointing into the frustum: a point p is inside the plane
+ * when a * p.x + b * p.y + c * p.z + d >= 0, and that value is its distance from the plane.
+ */
+void culling_frustum_planes(const mat4 mvp, vec4f planes[6]);
+
+/**
+ * @brief Returns 1 if a sphere lies entirely outside one of the planes from culling_frustum_planes.
+ * Conservative: a sphere near a frustum corner can be reported inside when it isn't, never the other way round.
+ */
+int culling_sphere_outside(const vec4f planes[6], vec3f center, float radius);
+
 /**
  * @brief Clips and triangulates all input triangles against the view frustum.
  *
+ * Every vertex's outcode is computed once up front. Triangles entirely outside one plane are dropped, and triangles
+ * that are inside the near and far planes and the guard band are passed through untouched; only the rest are clipped.
+ *
+ * Output triangles keep referring to the input vertices wherever they can: the output vertex array is the input
+ * vertices followed by whatever new vertices clipping created, and when nothing was clipped it is the input array
+ * itself. So a closed mesh comes out with about as many vertices as it went in with, not three per triangle.
+ *
+ * Vertices may carry `attribute_count` floats of other attributes each (texture coordinates, say), which new vertices
+ * get by interpolating those of the triangle they were clipped from, in clip space, like the position. They come out
+ * the same way the positions do: the input array itself if nothing was clipped, else a copy with new ones appended.
+ *
+ * With a pool of more than one thread, the triangles are split into CULLING_CHUNK_TRIANGLES runs that are clipped in
+ * parallel and then concatenated in their original order, so the output is identical to the single-threaded result.
+ *
+ * @param frame_arena      Arena the output arrays are allocated from; they stay valid until it is reset.
+ * @param pool             Threads to clip on, or NULL to clip on the calling thread.
+ * @param scratch          One arena per pool thread for intermediate output. Unused without a pool.
  * @param vertices         Input vertex array (in clip space).
  * @param num_vertices     Number of vertices.
+ * @param attributes       `attribute_count` floats per vertex, or NULL if the vertices have no other attributes.
+ * @param attribute_count  Attributes per vertex; 0 without attributes.
  * @param indices          Input triangle indices.
  * @param num_indices      Number of input indices (should be multiple of 3).
- * @param out_vertices     Output array of vertices (malloc'd).
+ * @param out_vertices     Output array of vertices: either `vertices` or an arena-allocated copy with new ones appended.
  * @param out_num_vertices Pointer to number of output vertices.
- * @param out_indices      Output triangle indices (malloc'd).
+ * @param out_attributes   Output attributes, `attribute_count` per output vertex; NULL without attributes.
+ * @param out_indices      Output triangle indices (arena-allocated).
  * @param out_num_indices  Pointer to number of output indices.
  */
-void culling_cull_triangle(vec4f* vertices, int num_vertices, int* indices, int num_indices,
-                           vec4f** out_vertices, int* out_num_vertices,
+void culling_cull_triangle(arena* frame_arena, threadpool* pool, arena* scratch,
+                           vec4f* vertices, int num_vertices, const float* attributes, int attribute_count,
+                           int* indices, int num_indices,
+                           vec4f** out_vertices, int* out_num_vertices, float** out_attributes,
                            int** out_indices, int* out_num_indices);
 
 int culling_check_point_in_range(vec4f point);
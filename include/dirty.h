@@ -0,0 +1,83 @@
+#ifndef DIRTY_H
+#define DIRTY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// above this many rectangles, dirty_rects gives up merging and returns one rectangle around everything: each one is a
+// separate texture upload, and past a few dozen the calls cost more than the pixels they skip
+#define DIRTY_MAX_RECTS 32
+
+/**
+ * @brief Which tiles of a width x height buffer have been drawn into, one flag per tile_size x tile_size tile, where
+ * tile_size is a power of two so finding a pixel's tile is a couple of shifts.
+ * Lets clears and uploads skip the parts of the screen a frame never touched, which for a sparse scene is most of it.
+ * Tile t (row-major) covers pixels [tx * tile_size, (tx + 1) * tile_size) x [ty * tile_size, ...), clipped to the
+ * buffer. Marking different tiles from different threads is safe, since every tile is a byte of its own.
+ */
+typedef struct dirty_tiles
+{
+    int width, height;
+    int tile_size;
+    int tile_shift; // tile_size == 1 << tile_shift
+    int tiles_x, tiles_y;
+    uint8_t* tiles; // tiles_x * tiles_y flags, nonzero = dirty
+} dirty_tiles;
+
+/// @brief A rectangle of pixels, [x, x + w) x [y, y + h).
+typedef struct dirty_rect
+{
+    int x, y;
+    int w, h;
+} dirty_rect;
+
+/**
+ * @brief Allocates the flags for a width x height buffer, all dirty: a buffer nobody has cleared yet holds garbage.
+ * @return 0 on success, nonzero if allocation failed or tile_size isn't a power of two.
+ */
+int dirty_init(dirty_tiles* d, int width, int height, int tile_size);
+void dirty_destroy(dirty_tiles* d);
+
+/// @brief Marks every tile clean.
+void dirty_reset(dirty_tiles* d);
+
+/// @brief Marks every tile dirty.
+void dirty_mark_all(dirty_tiles* d);
+
+/// @brief Marks every tile overlapping the pixel rectangle [x0, x1) x [y0, y1), which is clipped to the buffer.
+void dirty_mark_rect(dirty_tiles* d, int x0, int y0, int x1, int y1);
+
+/// @brief Marks the tile holding pixel (x, y), which must be inside the buffer.
+#define dirty_mark_pixel(d, x, y) ((d)->tiles[((y) >> (d)->tile_shift) * (d)->tiles_x + ((x) >> (d)->tile_shift)] = 1)
+
+/// @brief Copies `src`'s flags into `dst`; both must have the same size and tiles.
+void dirty_copy(dirty_tiles* dst, const dirty_tiles* src);
+
+/// @brief Marks dirty in `dst` every tile that is dirty in `src`; both must have the same size and tiles.
+void dirty_merge(dirty_tiles* dst, const dirty_tiles* src);
+
+/**
+ * @brief Covers the dirty tiles with a few pixel rectangles: runs of dirty tiles along a row, and runs that line up
+ * from one row to the next merged into one. Rectangles are clipped to the buffer and never overlap.
+ * @param rects At least DIRTY_MAX_RECTS entries.
+ * @return How many rectangles were written; 0 if nothing is dirty. If covering everything exactly would take more than
+ * DIRTY_MAX_RECTS, this is 1, the bounding rectangle of all dirty tiles.
+ */
+int dirty_rects(const dirty_tiles* d, dirty_rect* rects);
+
+/**
+ * @brief Clears the dirty tiles of an ARGB8888 buffer to `color`, leaving the rest alone. The flags are not changed.
+ * @param image `d->width * d->height` pixels, rows packed.
+ */
+void dirty_clear_color(const dirty_tiles* d, uint32_t* image, uint32_t color);
+
+/// @brief Same as dirty_clear_color, for a depth buffer.
+void dirty_clear_depth(const dirty_tiles* d, float* depth, float value);
+
+/**
+ * @brief Sets `count` 32-bit words starting at `dst` to `pattern`, with the widest stores available. `dst` only
+ * needs 4 byte alignment.
+ */
+void dirty_fill32(void* dst, uint32_t pattern, size_t count);
+
+#endif // DIRTY_H
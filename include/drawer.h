@@ -1,19 +1,78 @@
 #ifndef DRAWER_H
 #define DRAWER_H
 
-#include <SDL2/SDL.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include "dirty.h"
 
 
-extern SDL_Window *window;
-extern SDL_Renderer *renderer;
-extern SDL_Texture *texture;
 extern int window_width;
 extern int window_height;
 
+/**
+ * @brief A presentation backend. Everything that needs to know where a finished frame ends up (a window, a file, nowhere)
+ * lives behind one of these, and the drawer_* functions below forward to whichever backend is active.
+ */
+typedef struct drawer_backend
+{
+    const char* name;
+    /// @brief Sets up the backend for frames of the given size. Returns 0 on success.
+    int (*init)(int width, int height);
+    /**
+     * @brief Hands a finished ARGB8888 frame to the backend. Only the pixels inside `rects` differ from the last
+     * frame presented; NULL means the whole frame may have changed.
+     */
+    void (*present)(uint32_t* image, const dirty_rect* rects, int num_rects);
+    /// @brief Pumps platform events. Returns 0 once the user has asked to quit.
+    int (*poll_events)(void);
+    void (*cleanup)(void);
+} drawer_backend;
+
+extern const drawer_backend drawer_sdl_backend;
+extern const drawer_backend drawer_null_backend;
+
+typedef enum drawer_dump_format
+{
+    DRAWER_DUMP_NONE,
+    DRAWER_DUMP_PPM, // binary P6, alpha dropped
+    DRAWER_DUMP_RAW  // the ARGB8888 buffer exactly as it sits in memory
+} drawer_dump_format;
+
+/**
+ * @brief Selects the backend used by drawer_init and friends. Must be called before drawer_init; defaults to SDL.
+ */
+void drawer_set_backend(const drawer_backend* backend);
+
+/**
+ * @brief Looks up a backend by name ("sdl" or "null").
+ * @return The backend, or NULL if no backend has that name.
+ */
+const drawer_backend* drawer_find_backend(const char* name);
+
+/**
+ * @brief Initializes the active backend and sets window_width/window_height.
+ * @return 0 on success, nonzero on failure.
+ */
+int drawer_init(int width, int height);
 void drawer_draw_buffer(uint32_t* image);
-void drawer_init(int width, int height);
+
+/**
+ * @brief Presents a frame that only differs from the last one presented inside `rects`, so backends can skip
+ * uploading the rest. 0 rectangles presents the last frame again.
+ */
+void drawer_draw_buffer_rects(uint32_t* image, const dirty_rect* rects, int num_rects);
+int drawer_poll_events(void);
 void drawer_cleanup();
 void drawer_clear_buffer(uint32_t* image);
 
-#endif
\ No newline at end of file
+/**
+ * @brief Makes the null backend write every presented frame to disk.
+ * @param path_prefix Frames are written to `<path_prefix>_<frame>.ppm` (or `.raw`). The directory must already exist.
+ * @param format DRAWER_DUMP_NONE turns dumping back off.
+ */
+void drawer_null_set_dump(const char* path_prefix, drawer_dump_format format);
+
+/// @brief Returns the number of frames the null backend has been handed since drawer_init.
+int drawer_null_frame_count(void);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include "raster.h"
+#include "tiles.h"
+
+/**
+ * @brief A two-level depth pyramid over the depth buffer: the nearest and farthest depth of every RASTER_BLOCK_SIZE
+ * block, and of every TILE_SIZE tile above that.
+ *
+ * Bounds are conservative rather than exact: a block's max is never below the farthest depth actually stored in it,
+ * and its min is never above the nearest. That lets the rasterizer keep them up to date with a couple of compares per
+ * block instead of rescanning pixels, while still guaranteeing that anything behind `max` really is hidden.
+ */
+typedef struct hiz_buffer
+{
+    int width, height;
+    int blocks_x, blocks_y;
+    int tiles_x, tiles_y;
+    float* block_min;
+    float* block_max;
+    float* tile_min;
+    float* tile_max;
+} hiz_buffer;
+
+/**
+ * @brief Allocates the pyramid for a width x height depth buffer.
+ * @return 0 on success, nonzero if allocation failed.
+ */
+int hiz_init(hiz_buffer* hiz, int width, int height);
+void hiz_destroy(hiz_buffer* hiz);
+
+/// @brief Resets every level to `depth`, to match a depth buffer that has just been cleared to that value.
+void hiz_clear(hiz_buffer* hiz, float depth);
+
+/**
+ * @brief Recomputes one tile's bounds from its blocks. The rasterizer calls this when it finishes a tile.
+ * @param tile Row-major tile number.
+ */
+void hiz_update_tile(hiz_buffer* hiz, int tile);
+
+/**
+ * @brief Occlusion test: could anything in the pixel rectangle [x0, x1) x [y0, y1) at depth `min_z` or farther
+ * still be visible? Whole tiles are checked first and only tiles that can't decide it are looked at block by block.
+ * @return 1 if it might be visible, 0 if it is certainly hidden (or entirely off screen).
+ */
+int hiz_rect_visible(const hiz_buffer* hiz, int x0, int y0, int x1, int y1, float min_z);
+
+#endif // HIZ_H
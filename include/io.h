@@ -8,12 +8,16 @@
 #include <string.h>
 #include <SDL2/SDL.h>
 
-#define MAX_VERTICES 10000
-#define MAX_INDICES 30000
-#define MOVE_SPEED 0.1f
-#define ROTATE_SPEED 0.05f // <- in radians
+#define MOVE_SPEED 0.1f // per simulation step
+#define ROTATE_SPEED 0.05f // <- in radians, per simulation step
 
-void read_model(char* filepath, vec3f** vertices, int** indices, int* num_vertices, int* num_indices);
+/**
+ * @brief Loads the positions and triangles of a Wavefront .obj file (see obj_load for what is understood).
+ * @param vertices Set to a malloc'd array of positions; the caller frees it.
+ * @param indices Set to a malloc'd triangle index list; the caller frees it.
+ * @return 0 on success, nonzero if the file could not be loaded; the outputs are untouched then.
+ */
+int read_model(char* filepath, vec3f** vertices, int** indices, int* num_vertices, int* num_indices);
 
 extern int* key_states; // 0 = not pressed, 1 = pressed
 
@@ -21,7 +25,7 @@ extern int* key_states; // 0 = not pressed, 1 = pressed
  * @brief Interprets the keys that are currently held and applies the corresponding transformations to the camera.asm
  * @param pos The `vec3f` position of the camera.
  * @param rot The `quat` rotation of the camera.
- * @note This function should be called once every frame, after all keypresses have been handled.
+ * @note Call once per fixed simulation step (see scheduler.h), after all keypresses have been handled; speeds are per step.
  */
 void tick_transform(vec3f* pos, quat* rot);
 
@@ -1,4 +1,37 @@
-#ifndev LINES_H
+#ifndef LINES_H
 #define LINES_H
 
-void lines_draw(screen_point *p1, screen_point *p2)
\ No newline at end of file
+#include <stdint.h>
+#include "dirty.h"
+#include "matrix.h"
+#include "raster.h"
+
+// lines whose pixels come in runs along a row at least this long on average are drawn a run at a time, with the
+// depth test done several pixels wide; steeper lines step pixel by pixel
+#define LINES_SPAN_MIN 8
+
+/**
+ * @brief Draws one depth-tested screen-space line, for wireframes.
+ *
+ * The line is first clipped to the target rectangle (Cohen-Sutherland), so endpoints anywhere on or off screen are
+ * fine. It is then walked one pixel at a time along its major axis, sampling at pixel centers: the other coordinate
+ * is stepped in 16.16 fixed point and depth is interpolated linearly in screen space, so there is no rounding or
+ * division per pixel, and every pixel drawn is inside the rectangle. Both endpoints are drawn. Shallow lines are
+ * drawn a horizontal run at a time, with the depth test SIMD-wide on long runs. A line less than a pixel long in both
+ * directions, or one that passes no pixel center, draws the pixel under its midpoint.
+ *
+ * @param target Where to draw; its hierarchical depth buffer, if any, is neither used nor updated. Coordinates must
+ * fit 16.16 fixed point, i.e. targets up to 32767 pixels on a side.
+ * @param a, b The endpoints in screen space (x, y in pixels, z is NDC depth).
+ * @param color ARGB8888 line color.
+ * @param drawn Optional; every tile the line writes a pixel in is marked.
+ */
+void lines_draw(const raster_target* target, vec4f a, vec4f b, uint32_t color, dirty_tiles* drawn);
+
+/**
+ * @brief Draws the three edges of every triangle of an indexed screen-space mesh with lines_draw.
+ */
+void lines_draw_model(const raster_target* target, const vec4f* screen_vertices, const int* indices, int num_indices,
+                      uint32_t color, dirty_tiles* drawn);
+
+#endif // LINES_H
@@ -10,6 +10,5 @@
 
 int main(int argc, char *argv[]);
 void print_vertices(vec4f *screen_vertices, int num_vertices);
-void render_model(uint32_t* image, vec3f* vertices, int num_vertices, int* indices, int num_indices, mat4 transform, vec3f camera_pos, quat camera_rot, int width, int height);
 
 #endif
\ No newline at end of file
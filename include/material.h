@@ -0,0 +1,56 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "mesh.h"
+#include "texture.h"
+
+/**
+ * @brief One `newmtl` of a Wavefront .mtl file, as far as the renderer uses it.
+ */
+typedef struct material
+{
+    char name[MESH_NAME_MAX];
+    texture* diffuse_map; // the `map_Kd` image, or NULL if there is none or it couldn't be loaded
+    float diffuse[3];     // `Kd`, multiplying the diffuse map if there is one; (1, 1, 1) if the material has none
+    float specular[3];    // `Ks`; (0, 0, 0), no highlight, if the material has none
+    float shininess;      // `Ns`, the specular exponent; at least 1
+} material;
+
+/// @brief Every material of one .mtl file, and the textures they own.
+typedef struct material_library
+{
+    material* materials;
+    int num_materials;
+} material_library;
+
+/**
+ * @brief Reads a .mtl file and loads the texture of every `map_Kd` in it, relative to the .mtl's directory.
+ * Of a `map_Kd` line only the last word, the file name, is used; options before it (-s, -o, ...) are ignored.
+ * `Kd`, `Ks` and `Ns` are read too; colors given as a single value are gray, and negative ones are taken as 0.
+ * A texture that can't be loaded is reported and left out, but isn't an error: the material just has no texture.
+ * @return 0 on success, nonzero if the file could not be read; the error is printed to stderr.
+ */
+int material_load_library(const char* path, material_library* out);
+
+void material_library_free(material_library* lib);
+
+/// @brief The material called `name`, or NULL if the library has none by that name.
+const material* material_find(const material_library* lib, const char* name);
+
+/**
+ * @brief Looks up the materials a mesh asks for, for drawing it: slot i is the library's material named
+ * m->material_names[i], which is what m->material_ids number. A mesh that names no materials gets one slot. Names the
+ * library doesn't have fall back to its first material, the best guess for a file whose `usemtl` and `newmtl` lines
+ * disagree; with an empty library every slot is NULL.
+ * @return max(1, m->num_materials) slots, malloc'd; the caller frees the array (the materials stay the library's).
+ */
+const material** material_bind(const material_library* lib, const mesh* m);
+
+/**
+ * @brief Resolves `name` the way .obj and .mtl files mean their references: relative to the directory of `base`
+ * (the file doing the referring), unless it is absolute.
+ * @return A malloc'd path the caller frees, or NULL if allocation failed.
+ */
+char* material_resolve_path(const char* base, const char* name);
+
+#endif // MATERIAL_H
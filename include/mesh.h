@@ -0,0 +1,98 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <stddef.h>
+#include "matrix.h"
+#include "meshlet.h"
+
+// at most this many levels of detail per mesh, counting the full-detail one
+#define MESH_MAX_LODS 8
+// levels of detail stop once they get down to about this many triangles
+#define MESH_LOD_MIN_TRIANGLES 64
+// longest material name kept, including the terminating NUL (the same as the .obj loader's)
+#define MESH_NAME_MAX 256
+
+/**
+ * @brief One level of detail: a run of the mesh's index list, and the meshlets made from it.
+ * Stored as-is in the mesh cache, so the layout is fixed at 20 bytes.
+ */
+typedef struct mesh_lod
+{
+    uint32_t index_offset; // into mesh.indices and mesh.meshlet_triangles
+    uint32_t index_count;
+    uint32_t meshlet_offset; // into mesh.meshlets
+    uint32_t meshlet_count;
+    float error; // how far from the full-detail surface this level may be, in model units; 0 for level 0
+} mesh_lod;
+
+/**
+ * @brief A loaded triangle mesh: positions, normals, texture coordinates if it has any, a triangle index list, its
+ * bounding box, its meshlets and its levels of detail, and the names of the materials it asks for.
+ * The arrays either belong to the mesh or point straight into a memory-mapped cache file; either way they stay
+ * valid until mesh_free and must not be freed or written to by anyone else.
+ */
+typedef struct mesh
+{
+    vec3f* positions;
+    vec2f* uvs; // one per position, or NULL if the mesh has no texture coordinates
+    vec3f* normals; // one per position, not necessarily unit length; the file's, or smooth ones if it has none
+    int* material_ids; // one per position, indexing material_names, or NULL if the whole mesh uses the first one
+    int num_positions;
+    int* indices; // three per triangle, 0-based; every level of detail's list, one after the other
+    int num_indices; // in the full-detail list (level 0), which comes first
+    vec3f bounds_min;
+    vec3f bounds_max;
+
+    // levels of detail, finest first; they all index the same positions. Level 0 is always there
+    mesh_lod lods[MESH_MAX_LODS];
+    int num_lods;
+
+    // every level's triangles split into clusters (see meshlet.h); built at load, num_meshlets is 0 for an empty mesh
+    meshlet* meshlets;
+    int num_meshlets;
+    int* meshlet_vertices; // mesh vertex indices, per cluster
+    int num_meshlet_vertices;
+    uint8_t* meshlet_triangles; // local vertex numbers, three per triangle, lined up with `indices`
+
+    // the .obj's material library, relative to the .obj, or "" if there's none, and the names of the materials in it
+    // the mesh uses, in the order material_ids numbers them; num_materials is 0 if the .obj names none
+    char material_library[MESH_NAME_MAX];
+    char (*material_names)[MESH_NAME_MAX];
+    int num_materials;
+
+    // internal: what mesh_free has to release
+    void* mapping;       // the mapped (or read) cache file, or NULL if the arrays were malloc'd
+    size_t mapping_size;
+} mesh;
+
+// mesh_load flags
+#define MESH_LOAD_CACHE 0x1    // read and write the .meshcache sidecar
+#define MESH_LOAD_OPTIMIZE 0x2 // weld and reorder for the vertex cache and overdraw (see meshopt.h)
+#define MESH_LOAD_LODS 0x4     // build simplified levels of detail (see simplify.h)
+
+/**
+ * @brief Loads a mesh from a Wavefront .obj file.
+ *
+ * With MESH_LOAD_CACHE set, a sidecar cache next to the file (`<path>.meshcache`) is used instead of the .obj whenever it
+ * is up to date, which costs one mmap and no parsing. If there is no cache or it is stale, the .obj is parsed and a
+ * fresh cache is written for next time; failing to write it is reported but isn't an error.
+ *
+ * With MESH_LOAD_OPTIMIZE set, the parsed mesh goes through meshopt_optimize before it is cached. With
+ * MESH_LOAD_LODS set, a chain of levels of detail is then built from it, each with about half the triangles of the
+ * one before. Meshlets are built either way, for every level, and cached along with everything else. Caches built
+ * with different flags aren't interchangeable: asking for the other kind rebuilds the cache.
+ *
+ * @return 0 on success, nonzero if the mesh could not be loaded; the error is printed to stderr.
+ */
+int mesh_load(const char* path, int flags, mesh* out);
+
+/// @brief Releases the mesh's arrays, whether they were allocated or mapped.
+void mesh_free(mesh* m);
+
+/// @brief Total number of indices over every level of detail.
+int mesh_total_indices(const mesh* m);
+
+/// @brief Recomputes bounds_min/bounds_max from the positions. An empty mesh gets an empty box at the origin.
+void mesh_compute_bounds(mesh* m);
+
+#endif // MESH_H
@@ -0,0 +1,89 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <stdint.h>
+#include "mesh.h"
+
+// "3MSH" read as a little-endian uint32; a cache written on a machine of the other byte order won't match
+#define MESHCACHE_MAGIC 0x48534d33u
+// bump whenever the layout below or what the loader produces changes, so old caches get rebuilt
+#define MESHCACHE_VERSION 6
+// every section starts on a multiple of this, so mapped arrays are as aligned as freshly allocated ones
+#define MESHCACHE_ALIGN 64
+
+// header flags: how the arrays were processed after parsing
+#define MESHCACHE_FLAG_OPTIMIZED 0x1 // run through meshopt_optimize
+#define MESHCACHE_FLAG_LODS 0x2      // has simplified levels of detail
+
+/**
+ * @brief The fixed-size header at the start of a cache file. All offsets are in bytes from the start of the file.
+ *
+ * Layout: header, then positions (num_positions vec3f), texture coordinates if the mesh has them (num_positions
+ * vec2f), normals (num_positions vec3f), material ids if the mesh has them (num_positions int32), then indices
+ * (total_indices int32, every level of detail),
+ * then the meshlet table (num_meshlets entries of meshlet_size bytes), the meshlet vertex list
+ * (num_meshlet_vertices int32), the meshlet triangles (total_indices bytes), the level of detail table (num_lods
+ * mesh_lod) and the material names (num_materials of MESH_NAME_MAX bytes), each section aligned to MESHCACHE_ALIGN. The arrays are stored exactly as they are used in memory,
+ * so loading is a single mmap.
+ */
+typedef struct meshcache_header
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // the .obj this was built from; if either differs, the cache is stale
+    uint64_t source_size;
+    int64_t source_mtime; // in nanoseconds, where the platform has them
+
+    uint32_t num_positions;
+    uint32_t num_indices; // in level 0
+    float bounds_min[3];
+    float bounds_max[3];
+
+    uint64_t positions_offset;
+    uint64_t indices_offset;
+
+    uint64_t meshlets_offset;
+    uint32_t num_meshlets;
+    uint32_t meshlet_size; // bytes per entry, so readers can tell table versions apart
+
+    uint32_t flags; // MESHCACHE_FLAG_*
+    uint32_t num_meshlet_vertices;
+    uint64_t meshlet_vertices_offset;
+    uint64_t meshlet_triangles_offset;
+
+    uint64_t lods_offset;
+    uint32_t num_lods;
+    uint32_t total_indices;
+
+    uint64_t uvs_offset; // 0 if the mesh has no texture coordinates
+    char material_library[MESH_NAME_MAX];
+
+    uint64_t normals_offset;
+    uint64_t material_ids_offset; // 0 if the mesh has no material ids
+    uint64_t material_names_offset;
+    uint32_t num_materials;
+    uint32_t padding;
+
+    uint8_t reserved[64];
+} meshcache_header;
+
+/**
+ * @brief Maps a cache file and points `out` at the arrays inside it.
+ * @param source_size, source_mtime The .obj's current size and modification time; a cache built from anything
+ *        else is rejected.
+ * @param flags The MESHCACHE_FLAG_* the caller wants; a cache written with different ones is rejected too.
+ * Besides the header, every index, meshlet vertex and meshlet triangle is checked to be in range, so a damaged file
+ * is rejected rather than read out of bounds later.
+ * @return 0 on success, nonzero if the file is missing, stale, damaged, or doesn't look like a cache.
+ */
+int meshcache_map(const char* cache_path, uint64_t source_size, int64_t source_mtime, uint32_t flags, mesh* out);
+
+/**
+ * @brief Writes `m` as a cache file for a source of the given size and modification time, tagged with `flags`. The
+ * file is written under a temporary name and renamed into place, so a reader never sees a half-written cache.
+ * @return 0 on success, nonzero if the file could not be written.
+ */
+int meshcache_write(const char* cache_path, const mesh* m, uint64_t source_size, int64_t source_mtime, uint32_t flags);
+
+#endif // MESHCACHE_H
@@ -0,0 +1,53 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <stdint.h>
+#include "matrix.h"
+
+// cluster size limits; small enough that a cluster's local vertex numbers fit a byte, big enough that the
+// per-cluster tests are cheap next to the work they save
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct mesh;
+
+/**
+ * @brief A small cluster of a mesh's triangles, with what's needed to cull it before transforming anything.
+ *
+ * The cluster's vertices are `vertex_count` mesh vertex indices starting at `mesh.meshlet_vertices[vertex_offset]`;
+ * its triangles are `triangle_count` triples of local vertex numbers (0 to vertex_count - 1) starting at
+ * `mesh.meshlet_triangles[triangle_offset]`. Stored as-is in the mesh cache, so the layout is fixed at 48 bytes.
+ */
+typedef struct meshlet
+{
+    uint32_t vertex_offset;
+    uint32_t triangle_offset; // in bytes, i.e. 3 * the number of triangles (of any level) before this cluster
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+
+    // bounding sphere, in model space
+    vec3f center;
+    float radius;
+
+    // normal cone: every triangle's normal is within the cone around `cone_axis`. The cluster is entirely
+    // back-facing when viewed from anywhere the meshlet_backfacing test passes. cone_cutoff is 1 when the normals
+    // spread too far for the test to ever pass.
+    vec3f cone_axis;
+    float cone_cutoff;
+} meshlet;
+
+/**
+ * @brief Splits every level of detail of `m` into meshlets, in index order, and attaches them to the mesh
+ * (meshlets, meshlet_vertices, meshlet_triangles, and each level's meshlet range). Clusters are only as compact as
+ * the index order is local, so this is at its best after meshopt_optimize.
+ * @note The mesh must own its arrays (not be mapped from a cache).
+ */
+void meshlet_build(struct mesh* m);
+
+/**
+ * @brief Cone test: 1 if every triangle in the cluster faces away from `camera` (in model space, like the cluster),
+ * assuming counter-clockwise front faces as in .obj files.
+ */
+int meshlet_backfacing(const meshlet* ml, vec3f camera);
+
+#endif // MESHLET_H
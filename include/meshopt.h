@@ -0,0 +1,64 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include "mesh.h"
+
+// the post-transform vertex cache size the reordering targets
+#define MESHOPT_CACHE_SIZE 16
+
+/**
+ * @brief Runs the whole load-time optimization pass: meshopt_weld, then meshopt_optimize_vertex_cache, then
+ * meshopt_optimize_overdraw on the resulting clusters, then meshopt_optimize_vertex_fetch.
+ * @note The mesh must own its arrays (not be mapped from a cache).
+ */
+void meshopt_optimize(mesh* m);
+
+/**
+ * @brief Merges vertices with bit-identical positions (treating -0 and +0 as equal), and texture coordinates,
+ * normals and materials if the mesh has them, and rewrites the indices to match. Exporters write a separate vertex per
+ * face corner; with only what the renderer uses compared, most of those are the same vertex, and welding them lets
+ * triangles share transformed vertices. Vertices on a texture seam, a hard edge or a material boundary stay apart.
+ */
+void meshopt_weld(mesh* m);
+
+/**
+ * @brief The lookup meshopt_weld is built on, without changing anything: `remap[i]` is set to the first vertex with
+ * the same position as vertex i (so `remap[i] == i` for first occurrences).
+ * @return The number of distinct positions.
+ */
+int meshopt_position_remap(const vec3f* positions, int num_positions, int* remap);
+
+/**
+ * @brief Same as meshopt_position_remap over the mesh's vertices, but vertices only match if their texture
+ * coordinates, normals and materials (whichever the mesh has) are bit-identical too.
+ */
+int meshopt_vertex_remap(const mesh* m, int* remap);
+
+/**
+ * @brief Reorders triangles for a MESHOPT_CACHE_SIZE FIFO post-transform cache, using Tipsify (Sander, Nehab and
+ * Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007). Linear time.
+ * @param indices Triangle list, reordered in place.
+ * @param clusters If not NULL, receives the first triangle of every cluster: runs of triangles the algorithm laid
+ *        down without jumping across the mesh. Needs room for num_indices / 3 + 1 entries; the last entry written is
+ *        the triangle count.
+ * @return The number of clusters.
+ */
+int meshopt_optimize_vertex_cache(int* indices, int num_indices, int num_vertices, int* clusters);
+
+/**
+ * @brief Reorders whole clusters (from meshopt_optimize_vertex_cache) so that ones facing away from the mesh's
+ * center are drawn first. Those are the most likely to hide the others from any viewpoint, so later triangles fail
+ * the depth test more often. Triangle order inside a cluster, and so vertex cache efficiency, is kept.
+ */
+void meshopt_optimize_overdraw(const vec3f* positions, int* indices, int num_indices, const int* clusters, int num_clusters);
+
+/**
+ * @brief Renumbers vertices in order of first use by the index list, so the vertex stage walks memory front to back.
+ * Vertices no triangle uses are dropped.
+ */
+void meshopt_optimize_vertex_fetch(mesh* m);
+
+/// @brief Average cache misses per triangle for a MESHOPT_CACHE_SIZE FIFO cache: 3 is worst, about 0.5-0.7 is great.
+float meshopt_acmr(const int* indices, int num_indices, int num_vertices);
+
+#endif // MESHOPT_H
@@ -0,0 +1,57 @@
+#ifndef OBJ_H
+#define OBJ_H
+
+#include <stddef.h>
+#include "matrix.h"
+
+// longest material or material library name kept, including the terminating NUL; longer ones are cut short
+#define OBJ_NAME_MAX 256
+
+/**
+ * @brief Geometry loaded from a Wavefront .obj file: vertex positions and a triangle list indexing them.
+ * Polygons with more than three corners are split into triangle fans.
+ *
+ * If the file has texture coordinates, normals or more than one material, every distinct combination of position,
+ * texture coordinate, normal and material a face uses becomes a vertex of its own, with `uvs`, `normals` and
+ * `material_ids` alongside `positions`: a texture seam, a hard edge or a material boundary splits the vertices on it,
+ * as it has to. If that splits anything, vertices are numbered in order of first use rather than file order. Without
+ * seams the vertices are the file's `v` lines as they are.
+ */
+typedef struct obj_mesh
+{
+    vec3f* positions;
+    vec2f* uvs; // one per position, or NULL; corners without a texture coordinate get (0, 0)
+    vec3f* normals; // one per position as the file gives them (not normalized), or NULL; missing ones are (0, 0, 0)
+    int* material_ids; // one per position, indexing `materials`, or NULL if the file uses fewer than two materials
+    int num_positions;
+    int* indices; // three per triangle, 0-based
+    int num_indices;
+    char material_library[OBJ_NAME_MAX]; // the first `mtllib`, or "" if there is none
+    // every `usemtl` name, in order of first use; faces before the first `usemtl` are drawn with materials[0]
+    char (*materials)[OBJ_NAME_MAX];
+    int num_materials;
+} obj_mesh;
+
+/**
+ * @brief Loads an .obj file. The file is memory-mapped, and files bigger than a few megabytes are parsed in parallel
+ * chunks split at line boundaries, on one thread per CPU.
+ *
+ * Understands `v`, `vt` and `vn` lines, `f` lines with any corner form (`v`, `v/vt`, `v//vn`, `v/vt/vn`), negative
+ * (relative) indices and any number of corners, the first `mtllib` and every `usemtl`, which applies to the faces
+ * after it. Everything else (`o`, `g`, `s`, comments, ...) is skipped. Faces that reference a vertex, texture
+ * coordinate or normal that doesn't exist are an error rather than garbage.
+ *
+ * @return 0 on success, nonzero if the file could not be read or is malformed; the error is printed to stderr.
+ */
+int obj_load(const char* path, obj_mesh* out);
+
+/**
+ * @brief Same as obj_load, but parses .obj text already in memory. `text` doesn't need to be NUL-terminated.
+ * @param num_threads How many threads to parse on; 0 picks one per CPU.
+ */
+int obj_parse(const char* text, size_t length, int num_threads, obj_mesh* out);
+
+/// @brief Frees what obj_load allocated.
+void obj_free(obj_mesh* mesh);
+
+#endif // OBJ_H
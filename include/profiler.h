@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "timer.h"
+
+// how many of the most recent frames are kept
+#define PROFILER_MAX_FRAMES 1024
+// events past this many in one frame are dropped
+#define PROFILER_MAX_EVENTS_PER_FRAME 64
+
+typedef enum profiler_stage
+{
+    PROFILE_VERTEX, // model -> clip space
+    PROFILE_CULL,
+    PROFILE_PROJECT, // perspective divide + viewport mapping
+    PROFILE_BIN, // sorting triangles into screen tiles
+    PROFILE_RASTER,
+    PROFILE_PRESENT,
+    PROFILE_CLEAR,
+    PROFILE_STAGE_COUNT
+} profiler_stage;
+
+extern int profiler_enabled;
+
+/**
+ * @brief Times the code between PROFILE_BEGIN(stage) and PROFILE_END(stage) in the same scope.
+ * When profiling is off, this costs one predictable branch on each side.
+ */
+#define PROFILE_BEGIN(stage) uint64_t profile_start_##stage = profiler_enabled ? timer_now_ns() : 0
+#define PROFILE_END(stage) do { if (profiler_enabled) profiler_record(stage, profile_start_##stage, timer_now_ns()); } while (0)
+
+/**
+ * @brief Switches profiling on or off. Safe to call at any point; the ring buffer is allocated on first use.
+ */
+void profiler_enable(int enabled);
+
+/**
+ * @brief Starts a new frame in the ring buffer, overwriting the oldest one when it is full.
+ */
+void profiler_begin_frame(void);
+void profiler_end_frame(void);
+
+/**
+ * @brief Records one event for the current frame. Normally called through PROFILE_END.
+ */
+void profiler_record(profiler_stage stage, uint64_t start_ns, uint64_t end_ns);
+
+/// @brief Returns the short name of a stage, as used in the exports.
+const char* profiler_stage_name(profiler_stage stage);
+
+/**
+ * @brief Writes every frame still in the ring buffer as Chrome trace-event JSON (load it in chrome://tracing or Perfetto).
+ * @return 0 on success, nonzero if the file could not be written.
+ */
+int profiler_export_chrome_trace(const char* path);
+
+/**
+ * @brief Writes one CSV row per frame in the ring buffer: frame number, total frame time, then the time spent in each stage (all in microseconds).
+ * @return 0 on success, nonzero if the file could not be written.
+ */
+int profiler_export_csv(const char* path);
+
+/// @brief Prints the mean time per stage over the frames in the ring buffer.
+void profiler_print_summary(FILE* out);
+
+/// @brief Frees the ring buffer and switches profiling off.
+void profiler_cleanup(void);
+
+#endif // PROFILER_H
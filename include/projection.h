@@ -3,6 +3,16 @@
 
 #include "matrix.h"
 
+/**
+ * @brief Builds a right-handed perspective projection matrix mapping camera space to clip space (OpenGL conventions: the camera looks down -z, NDC z is in [-1, 1]).
+ * @param fov Vertical field of view in radians.
+ * @param aspect Width divided by height.
+ * @param znear Distance to the near plane.
+ * @param zfar Distance to the far plane.
+ * @param out Output matrix.
+ */
+void projection_matrix(float fov, float aspect, float znear, float zfar, mat4 out);
+
 void clip_from_camera(vec4f* vertices, int num_vertices, float fov, float aspect, float znear, float zfar, vec4f* out_vertices);
 
 #endif // PROJECTION_H
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdint.h>
+#include "matrix.h"
+#include "shade.h"
+
+// vertex positions are snapped to 1/16 of a pixel before rasterizing
+#define RASTER_SUBPIXEL_BITS 4
+#define RASTER_SUBPIXEL_ONE (1 << RASTER_SUBPIXEL_BITS)
+// triangles are walked in square blocks of this many pixels; whole blocks are accepted or rejected at once
+#define RASTER_BLOCK_SIZE 8
+
+struct hiz_buffer;
+struct texture;
+
+/**
+ * @brief Where the rasterizer writes: a color buffer, a depth buffer, and the rectangle of pixels it may touch.
+ * Both buffers share the same row stride. The rectangle is [x0, x1) x [y0, y1), which lets callers restrict
+ * drawing to part of the screen without copying buffers around.
+ * If `hiz` is set, blocks are checked against it before being drawn and it is kept up to date as they are; it must
+ * cover the same screen as the buffers, with block (0, 0) at pixel (0, 0).
+ */
+typedef struct raster_target
+{
+    uint32_t* color;
+    float* depth;
+    int stride;
+    int x0, y0;
+    int x1, y1;
+    struct hiz_buffer* hiz; // optional
+} raster_target;
+
+/**
+ * @brief Fills one screen-space triangle with a solid color, depth-tested against target->depth.
+ *
+ * Uses half-space edge functions on fixed-point coordinates with the top-left fill rule, so triangles that share an
+ * edge never both draw, nor both skip, the pixels on it. The triangle's bounding box is walked in
+ * RASTER_BLOCK_SIZE blocks: blocks entirely outside an edge are skipped, blocks entirely inside all three edges are
+ * filled without per-pixel edge tests, and only blocks straddling an edge are tested pixel by pixel. Everything is
+ * evaluated incrementally; there is no per-pixel multiply or rounding. With a hierarchical depth buffer, blocks where
+ * the triangle is behind everything already drawn are skipped outright, and fully covered blocks in front of
+ * everything drawn so far skip the per-pixel depth test.
+ *
+ * @param target Where to draw.
+ * @param a, b, c The triangle's vertices in screen space (x, y in pixels, z is NDC depth). Either winding is fine.
+ * @param color ARGB8888 fill color.
+ */
+void raster_fill_triangle(const raster_target* target, vec4f a, vec4f b, vec4f c, uint32_t color);
+
+/// @brief How triangles are lit, from cheapest to best looking.
+typedef enum raster_lighting
+{
+    RASTER_LIGHTING_NONE,   // the texture or flat color as it is
+    RASTER_LIGHTING_VERTEX, // lighting terms worked out per vertex and interpolated (Gouraud)
+    RASTER_LIGHTING_PIXEL   // the normal interpolated and lit per pixel (Phong)
+} raster_lighting;
+
+/// @brief One material as the rasterizer sees it: an optional texture, and how the surface reflects light.
+typedef struct raster_material
+{
+    const struct texture* texture; // optional
+    shade_material shade;          // only used when lit
+} raster_material;
+
+/**
+ * @brief How a mesh's triangles are colored: a flat color, or per material a texture and lighting.
+ *
+ * Per-vertex values come in `attributes`, `attribute_count` floats per screen-space vertex, clipped along with the
+ * vertices. Each offset says where one value starts inside a vertex's floats, or is -1 if the value isn't there.
+ */
+typedef struct raster_shading
+{
+    uint32_t color; // ARGB8888; for unlit triangles without a texture
+    raster_lighting lighting;
+    shade_light light; // when lit
+    const raster_material* materials; // may be NULL (num_materials 0) when unlit; triangles are then flat
+    int num_materials;
+    const float* attributes;
+    int attribute_count;
+    int uv_offset;       // (u, v)
+    int lighting_offset; // vertex lighting: the shade_terms (diffuse, specular); pixel lighting: the world normal
+    int material_offset; // the index into `materials`, as a float; without it every triangle uses materials[0]
+} raster_shading;
+
+/**
+ * @brief raster_fill_triangle with a material: textured, lit, or both.
+ *
+ * Texture coordinates and per-vertex lighting terms are interpolated perspective-correctly: each value divided by w,
+ * and 1 / w, are affine in screen space, and a span of pixels is divided back out at once. Textures are bilinearly
+ * filtered by texture_sample_span, from the mip level picked once per RASTER_BLOCK_SIZE block from how fast the
+ * texture coordinates change at the block's center; lighting is done by shade_span_vertex or shade_span_pixel.
+ * Pixels are only sampled and lit once they have passed the depth test, so hidden ones cost nothing.
+ *
+ * @param a, b, c As for raster_fill_triangle; w must still be the clip-space w.
+ * @param shading What the attributes hold, and the light.
+ * @param material The triangle's material; its texture is only used if the shading has texture coordinates.
+ * @param attributes The attributes of a, b and c, laid out as `shading` says.
+ */
+void raster_fill_triangle_shaded(const raster_target* target, vec4f a, vec4f b, vec4f c,
+                                 const raster_shading* shading, const raster_material* material,
+                                 const float* const attributes[3]);
+
+/**
+ * @brief Fills every triangle of an indexed screen-space mesh.
+ */
+void raster_fill_model(const raster_target* target, const vec4f* screen_vertices, const int* indices, int num_indices, uint32_t color);
+
+#endif // RASTER_H
@@ -0,0 +1,137 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include "arena.h"
+#include "dirty.h"
+#include "hiz.h"
+#include "material.h"
+#include "matrix.h"
+#include "mesh.h"
+#include "quat.h"
+#include "threadpool.h"
+#include "vertex.h"
+
+typedef enum render_mode
+{
+    RENDER_MODE_WIREFRAME, // triangle edges only
+    RENDER_MODE_SOLID      // filled, depth-tested triangles, textured where the mesh and its material allow
+} render_mode;
+
+/// @brief How solid triangles are lit; each step costs more per pixel than the one before and looks better.
+typedef enum render_shading
+{
+    RENDER_SHADING_UNLIT,   // textures as they are, everything else in a flat color
+    RENDER_SHADING_GOURAUD, // lit per vertex and interpolated: two more values per pixel, like a texture coordinate
+    RENDER_SHADING_PHONG    // lit per pixel: highlights stay round however coarse the mesh, for a square root and
+                            // two more divisions per pixel
+} render_shading;
+
+/**
+ * @brief Everything the pipeline keeps between frames. The per-frame vertex buffers and clipper output come from
+ * `frame_arena`, which is reset at the start of every frame; the depth buffer is allocated once and only ever cleared.
+ */
+typedef struct render_context
+{
+    int width;
+    int height;
+    float znear;
+    float zfar;
+    float fov; // vertical field of view in radians
+    mat4 projection; // built from the fields above by render_context_init
+    render_mode mode; // defaults to RENDER_MODE_WIREFRAME
+    float lod_error_pixels; // render_mesh picks the coarsest level of detail that's off by at most this much on screen
+    render_shading shading; // for render_mesh in solid mode; defaults to RENDER_SHADING_GOURAUD
+    vec3f light_direction; // world space, towards the light; needn't be unit length. The viewer is taken as infinitely far
+    float ambient; // how lit surfaces facing away from the light still are, in [0, 1]
+
+    arena frame_arena;
+    float* depth_buffer; // width * height
+    hiz_buffer hiz; // depth bounds per block and tile, kept up to date by the filled rasterizer
+    // TILE_SIZE tiles drawn into since render_begin_frame, in the framebuffer and the depth buffer alike. Everything
+    // outside them is still clear, so the next frame only clears these, and only they need presenting
+    dirty_tiles drawn;
+    threadpool* pool; // pipeline threads, one per CPU unless changed with render_context_set_threads
+    arena* worker_arenas; // per-frame scratch, one per pool thread; reset along with frame_arena
+} render_context;
+
+/**
+ * @brief Sets up a render context for a framebuffer of the given size.
+ * @return 0 on success, nonzero if allocation failed.
+ */
+int render_context_init(render_context* ctx, int width, int height);
+void render_context_destroy(render_context* ctx);
+
+/**
+ * @brief Changes how many threads the pipeline uses, counting the calling thread. 1 keeps everything on the caller.
+ * @return 0 on success, nonzero if the new threads could not be created (the old pool is kept).
+ */
+int render_context_set_threads(render_context* ctx, int num_threads);
+
+/**
+ * @brief Starts a new frame: releases last frame's scratch memory, clears the depth buffer where the last frame drew
+ * and marks every tile clean.
+ * @note Call once per frame, before any render_model calls for that frame.
+ */
+void render_begin_frame(render_context* ctx);
+
+/**
+ * @brief Occlusion and frustum test for a model-space bounding box, against everything drawn so far this frame.
+ * Draw big occluders first and test smaller things against them before paying for their vertex stage.
+ * @note Only filled drawing updates the depth bounds, so in wireframe mode this only culls against the frustum.
+ * @return 1 if any of the box might be visible, 0 if it is certainly hidden or off screen.
+ */
+int render_bounds_visible(render_context* ctx, vec3f bounds_min, vec3f bounds_max, mat4 transform, vec3f camera_pos, quat camera_rot);
+
+/**
+ * @brief Runs the whole pipeline for one model: model -> clip (one fused MVP pass) -> cull -> NDC -> screen -> raster.
+ * @param ctx The render context; its size must match the framebuffer.
+ * @param image The ARGB8888 framebuffer to draw into, `ctx->width * ctx->height` pixels.
+ * @param vertices Model-space vertex positions.
+ * @param num_vertices Number of vertices.
+ * @param indices Triangle index list; every three indices form one triangle.
+ * @param num_indices Number of indices.
+ * @param transform The model's transform in world space.
+ * @param camera_pos The camera's position in world space.
+ * @param camera_rot The camera's orientation in world space.
+ */
+void render_model(render_context* ctx, uint32_t* image, vec3f* vertices, int num_vertices, int* indices, int num_indices, mat4 transform, vec3f camera_pos, quat camera_rot);
+
+/**
+ * @brief Same as render_model, but takes positions as a structure-of-arrays stream so the vertex stage can run 8 wide.
+ * @param positions Model-space positions, built once with vertex_stream_init.
+ */
+void render_model_stream(render_context* ctx, uint32_t* image, const vertex_stream* positions, int* indices, int num_indices, mat4 transform, vec3f camera_pos, quat camera_rot);
+
+/**
+ * @brief Picks the level of detail render_mesh would draw `m` at: the coarsest one whose error, projected at the
+ * distance of the nearest point of the mesh's bounding sphere, is at most ctx->lod_error_pixels.
+ * @return An index into m->lods; 0 if the camera is inside the bounding sphere.
+ */
+int render_select_lod(const render_context* ctx, const mesh* m, mat4 transform, vec3f camera_pos);
+
+/**
+ * @brief Draws `num_instances` copies of a loaded mesh, one per transform, sharing one pass through the pipeline.
+ * Each instance is culled as a whole by its bounding box (see render_bounds_visible), then drawn at its own level
+ * of detail (render_select_lod) with its meshlets culled before any of their vertices is transformed: meshlets whose
+ * bounding sphere is outside the frustum are skipped, and in solid mode so are meshlets whose normal cone faces away
+ * from the camera (which assumes closed meshes with counter-clockwise front faces, as .obj files have; wireframe
+ * shows back faces, so it only culls against the frustum). Meshlets whose bounding sphere's box is behind what has
+ * already been drawn are skipped as well, by the same Hi-Z test as render_bounds_visible. The surviving meshlets of
+ * many instances are transformed and rasterized together in batches, so small instances cost little more than their
+ * visible triangles. Instances are drawn in order, but not tested for occlusion against earlier instances of the
+ * same call.
+ *
+ * In solid mode, triangles are lit as ctx->shading says, by one directional light. Each vertex takes its material
+ * from `materials`: a mesh with texture coordinates is textured with the material's diffuse map, if it has one, and
+ * lighting uses its Kd, Ks and Ns. Unlit, everything without a texture is drawn in a flat color.
+ * @param materials One entry per material the mesh names, and at least one (see material_bind), or NULL. Vertices
+ * whose entry is NULL, or all of them without the array, are drawn in the flat color, lit with no highlight.
+ * @param transforms Each instance's transform in world space.
+ */
+void render_mesh_instanced(render_context* ctx, uint32_t* image, const mesh* m, const material* const* materials, const mat4* transforms, int num_instances, vec3f camera_pos, quat camera_rot);
+
+/// @brief Same as render_mesh_instanced with a single instance.
+void render_mesh(render_context* ctx, uint32_t* image, const mesh* m, const material* const* materials, mat4 transform, vec3f camera_pos, quat camera_rot);
+
+#endif // RENDER_H
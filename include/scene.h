@@ -0,0 +1,73 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdint.h>
+#include "matrix.h"
+#include "quat.h"
+#include "render.h"
+#include "surface.h"
+
+// parent of a root node
+#define SCENE_NO_PARENT -1
+
+/**
+ * @brief One node of the scene graph: a transform relative to its parent, and optionally a surface to draw with it.
+ * Read the derived fields (world, bounds) only after scene_update; change `local` only through scene_set_local.
+ */
+typedef struct scene_node
+{
+    int parent; // index of the parent node, or SCENE_NO_PARENT; always lower than the node's own index
+    int num_children;
+    const surface* surface; // NULL for nodes that only group and move their children
+    mat4 local; // relative to the parent
+
+    // derived by scene_update
+    mat4 world;
+    vec3f bounds_min, bounds_max; // the surface's box in world space; empty (min > max) without a surface
+    vec3f subtree_min, subtree_max; // around this node and all of its descendants
+    uint8_t dirty; // local changed since the last scene_update
+} scene_node;
+
+/**
+ * @brief A flat scene graph. Nodes live in one array with every parent before its children, so world transforms
+ * and bounds are a single forward (and backward) pass over memory, with no pointers or recursion.
+ */
+typedef struct scene
+{
+    scene_node* nodes;
+    int num_nodes;
+    int node_alloc;
+    int num_dirty; // nodes with `dirty` set; 0 means scene_update has nothing to do
+    uint8_t* hidden; // per-node scratch for scene_render
+} scene;
+
+void scene_init(scene* s);
+void scene_destroy(scene* s);
+
+/**
+ * @brief Adds a node under `parent` (or as a root, with SCENE_NO_PARENT).
+ * @param surface What to draw at the node, or NULL. Must stay valid as long as the node is in the scene.
+ * @return The new node's index, which never changes, or -1 if `parent` isn't a node of this scene.
+ */
+int scene_add_node(scene* s, int parent, const surface* surface, const mat4 local);
+
+/// @brief Replaces a node's transform relative to its parent; it and its subtree get recomputed at the next update.
+void scene_set_local(scene* s, int node, const mat4 local);
+
+/**
+ * @brief Brings world transforms and bounds up to date. Only nodes whose own transform changed, and their
+ * descendants, get their world matrix recomputed; if nothing changed since the last call, this returns at once.
+ * @return The number of nodes whose world transform was recomputed.
+ */
+int scene_update(scene* s);
+
+/**
+ * @brief Updates the scene, then draws every node with a surface that might be visible. Whole subtrees are skipped
+ * when their combined bounds are off screen or behind what has been drawn so far (see render_bounds_visible), so
+ * add big occluders, or groups of them, before the things they hide. Consecutive nodes that share a mesh and
+ * materials are drawn with one render_mesh_instanced call, so they hide things after them but not each other.
+ * @return The number of nodes drawn.
+ */
+int scene_render(scene* s, render_context* ctx, uint32_t* image, vec3f camera_pos, quat camera_rot);
+
+#endif // SCENE_H
@@ -0,0 +1,59 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// a frame that would need more simulation steps than this drops the rest of its time instead, so a long stall
+// (a breakpoint, a window drag) slows the simulation down rather than making every later frame slower still
+#define SCHEDULER_MAX_STEPS 8
+
+/**
+ * @brief Paces the main loop: measures how long each frame really took, says how many fixed-size simulation steps
+ * that time is worth, and sleeps off whatever is left of the frame budget.
+ *
+ * Frames are paced against a deadline that advances by one budget per frame, rather than by sleeping a fixed amount,
+ * so rendering time counts towards the budget instead of being added on top of it. A frame that overruns its budget
+ * is counted as dropped and the deadline restarts from there, without trying to catch up.
+ */
+typedef struct scheduler
+{
+    uint64_t step_ns; // fixed simulation timestep
+    uint64_t budget_ns; // target frame time; 0 = uncapped, never sleep
+    int lockstep; // exactly one simulation step per frame, whatever the clock says (headless runs, benchmarks)
+
+    uint64_t frame_start; // when the current frame began
+    uint64_t deadline; // when the current frame should end
+    uint64_t accumulator; // measured time not yet consumed by simulation steps
+    uint64_t last_frame_ns; // how long the previous frame took, sleep included
+
+    // totals since scheduler_init
+    int frames;
+    int dropped; // frames that took longer than the budget
+    uint64_t busy_ns; // time spent inside frames, not counting sleeps
+    uint64_t worst_ns; // longest frame, not counting sleeps
+} scheduler;
+
+/**
+ * @brief Sets up a scheduler.
+ * @param step_hz Simulation steps per second.
+ * @param target_fps Frames per second to pace to; 0 runs uncapped.
+ * @param lockstep Nonzero to run one simulation step per frame regardless of time, so runs are reproducible.
+ */
+void scheduler_init(scheduler* s, double step_hz, double target_fps, int lockstep);
+
+/**
+ * @brief Starts a frame.
+ * @return How many simulation steps to run this frame, at most SCHEDULER_MAX_STEPS: the time since the previous
+ * frame began, in whole steps. The remainder carries over to the next frame.
+ */
+int scheduler_begin_frame(scheduler* s);
+
+/**
+ * @brief Ends a frame: accounts for its time and sleeps until the frame's deadline, if there's any time left.
+ */
+void scheduler_end_frame(scheduler* s);
+
+/// @brief Prints the frame count, average and worst frame time, and dropped frames.
+void scheduler_print_summary(const scheduler* s);
+
+#endif // SCHEDULER_H
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
+#include "dirty.h"
 #include "drawer.h"
 #include "matrix.h"
 #include <stdlib.h>
@@ -23,15 +24,21 @@ typedef struct triangle
     vec4f c;
 } triangle;
 
+// points at the active render context's depth buffer; see render_begin_frame
 extern float* depth_buffer;
+// ...and at its drawn tiles, which screenspace_add_point_depth marks as it writes
+extern dirty_tiles* drawn_tiles;
 
 void screenspace_draw_triangle(uint32_t* image, triangle tri);
+/// @brief lines_draw into `image` and the active depth buffer, marking drawn_tiles; see lines.h.
 void screenspace_draw_line(uint32_t* image, vec4f p1, vec4f p2);
 void screenspace_draw_vertical_line(uint32_t* image, vec4f p1, vec4f p2);
 void screenspace_plot_point(uint32_t* image, screen_point p);
 void screenspace_from_ndc(vec4f* vertices, int num_vertices, float znear, float zfar, vec4f* out_vertices);
+/// @brief lines_draw_model into `image` and the active depth buffer, marking drawn_tiles.
 void screenspace_draw_model(vec4f* screen_vertices, int num_indices, int* ibo, uint32_t* image);
 void screenspace_add_point_depth(vec4f point, uint32_t* image);
+/// @brief Resets every entry of depth_buffer to the far plane. The buffer itself is owned by the render context.
 void screenspace_clear_depth_buffer(int width, int height);
 
 
@@ -0,0 +1,61 @@
+#ifndef SHADE_H
+#define SHADE_H
+
+#include <stdint.h>
+#include "matrix.h"
+
+/**
+ * @brief How a surface reflects light, from its .mtl: a diffuse color that multiplies the texture (or white), and a
+ * specular highlight added on top.
+ */
+typedef struct shade_material
+{
+    float diffuse[3];  // r, g, b, 1 keeps the texture as it is
+    float specular[3]; // r, g, b, 0 for no highlight
+    float shininess;   // the highlight's exponent, at least 1
+} shade_material;
+
+/**
+ * @brief One directional light and a viewer infinitely far away, both in world space. With both at infinity the
+ * half vector is the same for every pixel, so a highlight costs one dot product more than plain diffuse lighting.
+ */
+typedef struct shade_light
+{
+    vec3f direction; // unit length, towards the light
+    vec3f half;      // unit length, halfway between `direction` and towards the viewer
+    float ambient;   // how lit a surface facing away from the light still is, in [0, 1]
+} shade_light;
+
+/**
+ * @brief The lighting terms of a surface with normal `normal` (any nonzero length): `diffuse` is the ambient plus
+ * Lambert term, and `specular` the highlight, 0 on the side facing away from the light.
+ *
+ * The highlight uses Schlick's approximation of the Blinn-Phong power, x / (n - n * x + x) for x = N.H and exponent
+ * n, which has the same peak and about the same width but needs a division instead of pow(). The span functions
+ * below do exactly this arithmetic per pixel.
+ */
+void shade_terms(const shade_light* light, float shininess, vec3f normal, float* diffuse, float* specular);
+
+/**
+ * @brief Lights a span of pixels from lighting terms worked out per vertex (Gouraud shading).
+ * Pixel i's terms are (d + i * dd, s + i * ds) / (q + i * dq): like texture coordinates, the terms divided by w are
+ * what is affine in screen space, and q is 1 / w. Each color is `base[i]` times the diffuse color and term, plus the
+ * specular color times its term, clamped per channel; alpha is set to opaque.
+ * Runs 8 pixels at a time with AVX2 and 4 with SSE2, with the same arithmetic as the scalar path, so the result
+ * doesn't depend on the instruction set.
+ * @param base `count` ARGB8888 colors to light; may be the same array as `out`.
+ */
+void shade_span_vertex(const shade_material* m, float d, float s, float q, float dd, float ds, float dq, int count,
+                       const uint32_t* base, uint32_t* out);
+
+/**
+ * @brief Lights a span of pixels from a normal interpolated across the triangle (Phong shading): pixel i has normal
+ * n + i * dn, renormalized, and gets shade_terms of it. Costs a square root and two divisions per pixel over
+ * shade_span_vertex, but highlights and light falloff no longer depend on how finely the mesh is tessellated.
+ * The normal needn't be divided by w: only its direction matters, and 1 / w is positive.
+ * Same SIMD widths and same result on every instruction set as shade_span_vertex.
+ */
+void shade_span_pixel(const shade_material* m, const shade_light* light, vec3f n, vec3f dn, int count,
+                      const uint32_t* base, uint32_t* out);
+
+#endif // SHADE_H
@@ -0,0 +1,15 @@
+// picks the widest SIMD instruction set the compiler was told it may use (see SIMD in the Makefile)
+#ifndef SIMD_H
+#define SIMD_H
+
+#if !defined(RENDER_NO_SIMD) && defined(__AVX2__)
+#define RENDER_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if !defined(RENDER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define RENDER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#endif // SIMD_H
@@ -0,0 +1,60 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <stdint.h>
+#include "matrix.h"
+#include "mesh.h"
+
+/**
+ * @brief Quadric-error edge-collapse simplification (Garland and Heckbert, "Surface Simplification Using Quadric
+ * Error Metrics", 1997), run progressively: each simplify_run continues from where the last one stopped, so a whole
+ * chain of levels of detail costs about as much as simplifying once to the coarsest.
+ *
+ * Vertices only ever collapse onto other existing vertices, never onto new positions, so every level indexes the
+ * original positions array. Vertices with the same position are treated as one. Edges on open borders or shared by
+ * more than two triangles are never collapsed, and a collapse that would flip a triangle over is skipped.
+ */
+typedef struct simplifier
+{
+    const vec3f* positions; // the caller's, unchanged
+    int num_positions;
+    vec3f* unit; // positions scaled into the unit cube, so errors don't depend on the model's size
+    float scale; // model units per unit-cube unit
+
+    int* indices; // the current triangles, by canonical vertex
+    int num_indices;
+    float error; // largest collapse error so far, squared, in unit-cube units
+
+    struct simplify_quadric* quadrics; // per vertex
+    uint8_t* locked; // border and non-manifold vertices
+
+    // per pass scratch
+    int* adjacency_start;
+    int* adjacency;
+    int* collapse; // vertex -> what it collapses into this pass
+    uint8_t* touched;
+    struct simplify_candidate* candidates;
+} simplifier;
+
+/**
+ * @brief Takes a copy of the triangle list, which indexes the mesh's vertices, and prepares the quadrics. The mesh's
+ * positions must outlive the simplifier. Vertices that share a position but not texture coordinates, normals or
+ * material are kept apart, which makes seams, hard edges and material boundaries borders, so they are never
+ * collapsed and never tear open.
+ */
+void simplify_init(simplifier* s, const mesh* m, const int* indices, int num_indices);
+
+/**
+ * @brief Collapses edges, cheapest first, until at most `target_indices` indices are left or nothing more can be
+ * collapsed. The result is in `s->indices`.
+ * @return The number of indices left.
+ */
+int simplify_run(simplifier* s, int target_indices);
+
+/// @brief How far, in model units, the current result may be from the original surface (root mean square over the
+/// planes merged into the worst collapse so far); 0 before anything was collapsed.
+float simplify_error(const simplifier* s);
+
+void simplify_destroy(simplifier* s);
+
+#endif // SIMPLIFY_H
@@ -0,0 +1,35 @@
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include "material.h"
+#include "matrix.h"
+#include "mesh.h"
+
+/**
+ * @brief Something a scene node can draw: a mesh, the materials it is drawn with, and its model-space bounding box.
+ * Surfaces don't own their mesh, and any number of nodes can share one surface, so a thousand copies of a model
+ * cost one mesh in memory.
+ */
+typedef struct surface
+{
+    const mesh* mesh;
+    // one per material the mesh names (see material_bind), or NULL to draw the mesh in a flat color; not owned either
+    const material* const* materials;
+    vec3f bounds_min;
+    vec3f bounds_max;
+} surface;
+
+/// @brief Points `s` at `m`, with no materials, and takes the mesh's bounds. `m` must outlive every node that uses the
+/// surface.
+void surface_init(surface* s, const mesh* m);
+
+/**
+ * @brief Transforms an axis-aligned box by `m` and returns the axis-aligned box around the result.
+ * This is exact for the transformed box's corners (Arvo's method: the center is transformed, and each output half
+ * extent is the input half extents dotted with the absolute values of one row of the 3x3 part), and only costs
+ * one pass over the matrix instead of transforming eight corners.
+ * @note `m` must be affine; the projective row is ignored.
+ */
+void surface_transform_bounds(vec3f bounds_min, vec3f bounds_max, const mat4 m, vec3f* out_min, vec3f* out_max);
+
+#endif // SURFACE_H
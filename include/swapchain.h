@@ -0,0 +1,64 @@
+#ifndef SWAPCHAIN_H
+#define SWAPCHAIN_H
+
+#include <stdint.h>
+
+// more than this only adds latency: the render thread can't usefully get further ahead of the presenter
+#define SWAPCHAIN_MAX_BUFFERS 3
+
+/**
+ * @brief A small ring of framebuffers handed around between the thread that submits frames and presents them, and
+ * a render thread that draws them. Each frame goes through three steps in order, on a buffer of its own:
+ *
+ *     submitter: swapchain_acquire -> (fill in what to draw) -> swapchain_queue
+ *     renderer:  swapchain_wait_render -> (draw) -> swapchain_rendered
+ *     submitter: swapchain_wait_present -> (present, clear) -> swapchain_presented
+ *
+ * Frames are rendered and presented in the order they were queued, and buffers are reused round-robin, so the slot
+ * numbers the calls return can index per-frame data kept alongside the buffers. With two buffers, frame N+1 is drawn
+ * while frame N is being presented; a third lets the renderer get one more frame ahead when presenting is slow.
+ */
+typedef struct swapchain swapchain;
+
+/**
+ * @brief Creates `num_buffers` (2 to SWAPCHAIN_MAX_BUFFERS) framebuffers of `width * height` ARGB8888 pixels, all
+ * cleared to opaque black.
+ * @return The swap chain, or NULL if allocation failed.
+ */
+swapchain* swapchain_create(int num_buffers, int width, int height);
+void swapchain_destroy(swapchain* sc);
+
+/// @brief Returns the framebuffer of a slot.
+uint32_t* swapchain_buffer(const swapchain* sc, int slot);
+
+/**
+ * @brief Waits until a buffer is free for the next frame.
+ * @return Its slot. Nothing reads the slot until swapchain_queue, so per-frame data can be filled in first.
+ */
+int swapchain_acquire(swapchain* sc);
+
+/// @brief Hands the acquired buffer to the render thread.
+void swapchain_queue(swapchain* sc);
+
+/**
+ * @brief Render thread: waits for the next queued frame.
+ * @return Its slot, or -1 once swapchain_close has been called and every queued frame has been rendered.
+ */
+int swapchain_wait_render(swapchain* sc);
+
+/// @brief Render thread: marks the frame from swapchain_wait_render as finished.
+void swapchain_rendered(swapchain* sc);
+
+/// @brief Waits until the oldest frame not yet presented has been rendered, and returns its slot.
+int swapchain_wait_present(swapchain* sc);
+
+/// @brief Gives the presented buffer back for reuse. It should be cleared for the next frame by then.
+void swapchain_presented(swapchain* sc);
+
+/// @brief Returns the number of frames queued but not yet presented.
+int swapchain_in_flight(const swapchain* sc);
+
+/// @brief No more frames will be queued; lets the render thread finish what's queued and return from swapchain_wait_render.
+void swapchain_close(swapchain* sc);
+
+#endif // SWAPCHAIN_H
@@ -0,0 +1,78 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdint.h>
+
+// texels are stored in square tiles of this many on a side: 4 x 4 ARGB8888 texels are 64 bytes, one cache line, so a
+// bilinear footprint almost always lands in a single line instead of straddling two rows of the image
+#define TEXTURE_TILE 4
+// enough for a 32768 x 32768 texture, which is more than anything here will ever load
+#define TEXTURE_MAX_LEVELS 16
+// sub-texel precision of bilinear filtering, in bits; 7 keeps every blend step inside a signed 16-bit lane
+#define TEXTURE_FILTER_BITS 7
+
+/**
+ * @brief One level of a mip chain. Both sizes are powers of two, so wrapping a coordinate is a mask.
+ * Texel (x, y) is at texels[texture_texel_offset(level, x, y)]: tiles of TEXTURE_TILE x TEXTURE_TILE texels, row-major
+ * inside a tile and tiles row-major across the level. Levels smaller than a tile get one padded tile.
+ */
+typedef struct texture_level
+{
+    int width, height;
+    int tiles_x_shift; // tiles per row == 1 << tiles_x_shift
+    uint32_t* texels;
+} texture_level;
+
+/**
+ * @brief An ARGB8888 texture with its whole mip chain, down to 1 x 1, in one allocation.
+ * Row 0 of level 0 is the bottom of the image, so a .obj texture coordinate (u, v) is at texel (u * width, v * height)
+ * with no flipping. Coordinates wrap (repeat) in both directions.
+ */
+typedef struct texture
+{
+    int num_levels;
+    texture_level levels[TEXTURE_MAX_LEVELS];
+    void* block; // backs every level's texels
+} texture;
+
+/// @brief Where texel (x, y) of a level lives in its texel array; both must be inside the level.
+static inline int texture_texel_offset(const texture_level* level, int x, int y)
+{
+    return ((((y >> 2) << level->tiles_x_shift) + (x >> 2)) << 4) + ((y & 3) << 2) + (x & 3);
+}
+
+/**
+ * @brief Builds a texture from a top-down image of `width * height` ARGB8888 pixels, rows packed.
+ * Sizes that aren't powers of two are resampled up to the next power of two first. Every mip level is a 2 x 2 box
+ * filter of the one above, all built here, once, so nothing is filtered while drawing.
+ * @return 0 on success, nonzero if allocation failed or the size is out of range.
+ */
+int texture_init(texture* t, const uint32_t* pixels, int width, int height);
+
+/**
+ * @brief Loads an image file as a texture. Reads binary PPM (P6) and Truevision TGA (true color or grayscale,
+ * uncompressed or run-length encoded), which is what a renderer without an image library can sensibly take.
+ * @return 0 on success, nonzero if the file could not be read or isn't a supported format; the error is printed.
+ */
+int texture_load(const char* path, texture* t);
+
+void texture_destroy(texture* t);
+
+/**
+ * @brief Picks the mip level for a pixel whose footprint is `rho_squared` texels squared in level 0, i.e. the larger
+ * squared length of the texture coordinate's derivatives along x and along y, measured in level 0 texels.
+ * The level is the one where the footprint is about one texel: floor(log2(rho)), clamped to the chain.
+ */
+int texture_select_level(const texture* t, float rho_squared);
+
+/**
+ * @brief Bilinearly samples `count` pixels along a horizontal span of a perspective-correct triangle.
+ * Pixel i has texture coordinate (s + i * ds, t + i * dt) / (q + i * dq): s, t and q are u / w, v / w and 1 / w,
+ * which are affine in screen space. Runs 8 pixels at a time with AVX2 and 4 with SSE2, with the same arithmetic as
+ * the scalar path, so the result doesn't depend on the instruction set.
+ * @param out Receives `count` ARGB8888 colors.
+ */
+void texture_sample_span(const texture_level* level, float s, float t, float q, float ds, float dt, float dq,
+                         int count, uint32_t* out);
+
+#endif // TEXTURE_H
@@ -0,0 +1,43 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/**
+ * @brief One unit of work handed to the pool.
+ * @param data The pointer passed to threadpool_run.
+ * @param index Which item to process, in [0, count).
+ * @param worker Which thread is running it, in [0, threadpool_size()); the calling thread is always worker 0.
+ *               Handy for indexing per-thread scratch space.
+ */
+typedef void (*threadpool_job)(void* data, int index, int worker);
+
+/**
+ * @brief A fixed set of worker threads for parallel-for style work. Threads are created once and sleep between jobs,
+ * so handing out work every frame costs a wakeup, not a thread creation.
+ */
+typedef struct threadpool threadpool;
+
+/**
+ * @brief Creates a pool that runs jobs on `num_threads` threads in total, counting the caller of threadpool_run.
+ * `num_threads` <= 1 creates no threads at all and runs everything inline.
+ * @return The pool, or NULL if allocation failed.
+ */
+threadpool* threadpool_create(int num_threads);
+
+/**
+ * @brief Calls `job(data, i, worker)` once for every i in [0, count), spread over the pool, and returns once all of them
+ * have finished. Items are handed out one at a time in increasing order as threads become free, so uneven items balance
+ * themselves out. The calling thread works too.
+ * @note Not reentrant: a job must not call threadpool_run on the same pool.
+ */
+void threadpool_run(threadpool* pool, threadpool_job job, void* data, int count);
+
+/// @brief Returns the number of threads that run jobs, including the caller.
+int threadpool_size(const threadpool* pool);
+
+/// @brief Stops and joins every worker thread, then frees the pool. NULL is allowed.
+void threadpool_destroy(threadpool* pool);
+
+/// @brief Returns the number of logical CPUs, which is a sensible default pool size.
+int threadpool_default_size(void);
+
+#endif // THREADPOOL_H
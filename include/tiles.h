@@ -0,0 +1,47 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <stdint.h>
+#include "arena.h"
+#include "dirty.h"
+#include "matrix.h"
+#include "raster.h"
+#include "threadpool.h"
+
+// screen tiles are TILE_SIZE x TILE_SIZE pixels; a multiple of RASTER_BLOCK_SIZE so blocks never straddle two tiles
+#define TILE_SIZE 64
+
+/**
+ * @brief Screen-space triangles sorted into the tiles their bounding boxes touch.
+ * Tile t (row-major) owns triangles[offsets[t]] .. triangles[offsets[t + 1] - 1]. Each entry is a triangle number
+ * (its first index is 3 * entry), and every tile lists its triangles in submission order.
+ */
+typedef struct tile_bins
+{
+    int tiles_x;
+    int tiles_y;
+    int* offsets;   // tiles_x * tiles_y + 1 entries
+    int* triangles;
+} tile_bins;
+
+/**
+ * @brief Bins every triangle of an indexed screen-space mesh into TILE_SIZE tiles covering a width x height screen.
+ * Everything is allocated from `frame_arena`.
+ */
+void tiles_bin_triangles(arena* frame_arena, const vec4f* screen_vertices, const int* indices, int num_indices,
+                         int width, int height, tile_bins* out);
+
+/**
+ * @brief Rasterizes binned triangles with one job per tile, spread over `pool`. Each tile only writes its own pixels
+ * of the target, so tiles never contend and need no locking. Since each tile sees its triangles in submission order,
+ * the result is identical to raster_fill_model over the whole screen.
+ * @param target The whole screen; tiles are clipped against its rectangle.
+ * @param shading A flat color, or materials with the vertices' attributes, indexed like `screen_vertices`. Each
+ *        triangle is drawn with the material its first corner names.
+ * @param drawn Optional; every tile that gets a triangle drawn into it is marked. Must use the same TILE_SIZE grid.
+ */
+void tiles_fill_model(threadpool* pool, const tile_bins* bins, const raster_target* target,
+                      const vec4f* screen_vertices, const int* indices, const raster_shading* shading,
+                      dirty_tiles* drawn);
+
+#endif // TILES_H
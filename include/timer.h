@@ -0,0 +1,15 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds. Only differences between two calls are meaningful.
+ * @note Backed by SDL's high-resolution counter, which works without SDL_Init, so it is safe to use in headless builds.
+ */
+uint64_t timer_now_ns(void);
+
+/// @brief Converts a difference of two timer_now_ns() values to milliseconds.
+double timer_ns_to_ms(uint64_t ns);
+
+#endif // TIMER_H
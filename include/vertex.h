@@ -0,0 +1,70 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include "matrix.h"
+#include "quat.h"
+
+// alignment of each array in a vertex_stream; enough for aligned AVX loads and a whole cache line
+#define VERTEX_STREAM_ALIGN 64
+
+/**
+ * @brief Vertex positions stored as a structure of arrays: one float array per component, each VERTEX_STREAM_ALIGN-aligned.
+ * This is the layout the SIMD kernels want, since 4 or 8 consecutive x values are a single aligned load.
+ * Positions carry an implied w = 1, so there is no w array.
+ */
+typedef struct vertex_stream
+{
+    float* x;
+    float* y;
+    float* z;
+    int count;
+    void* block; // the single allocation backing x, y and z
+} vertex_stream;
+
+/**
+ * @brief Builds a structure-of-arrays copy of the given positions. Do this once at load, not per frame.
+ * @return 0 on success, nonzero if allocation failed.
+ */
+int vertex_stream_init(vertex_stream* stream, const vec3f* vertices, int num_vertices);
+void vertex_stream_destroy(vertex_stream* stream);
+
+/**
+ * @brief Concatenates projection * view * model into one matrix, so a vertex goes from model space to clip space in a single multiply.
+ * @param projection The camera's projection matrix (see projection_matrix).
+ * @param camera_pos The camera's position in world space.
+ * @param camera_rot The camera's orientation in world space.
+ * @param model The model's transform in world space.
+ * @param out Output model-view-projection matrix.
+ */
+void vertex_build_mvp(mat4 projection, vec3f camera_pos, quat camera_rot, mat4 model, mat4 out);
+
+/**
+ * @brief Transforms model-space positions straight to clip space in one streaming pass.
+ * The homogeneous w = 1 is implied rather than stored, so there is no intermediate vec4f array and only 12 of the 16 multiply-adds are needed.
+ * @param vertices Model-space positions.
+ * @param num_vertices Number of vertices.
+ * @param mvp The model-view-projection matrix from vertex_build_mvp.
+ * @param out_vertices Output clip-space positions.
+ */
+void vertex_transform_to_clip(const vec3f* vertices, int num_vertices, const mat4 mvp, vec4f* out_vertices);
+
+/**
+ * @brief Same as vertex_transform_to_clip, but for the vertices `remap[0..count)` of `vertices`, written densely to
+ * `out_vertices[0..count)`. This is how meshlets gather just their own vertices.
+ */
+void vertex_transform_indexed_to_clip(const vec3f* vertices, const int* remap, int count, const mat4 mvp, vec4f* out_vertices);
+
+/**
+ * @brief Same as vertex_transform_to_clip, but reads a structure-of-arrays stream, 8 vertices at a time with AVX2 or 4 with SSE2.
+ * The output stays an array of vec4f, since everything downstream fetches whole vertices by index.
+ */
+void vertex_stream_transform_to_clip(const vertex_stream* stream, const mat4 mvp, vec4f* out_vertices);
+
+/**
+ * @brief Perspective divide and viewport mapping in one pass, in place: clip space -> NDC -> screen space.
+ * x and y end up in pixels (y flipped so +y is down), z is NDC depth, and w keeps the clip-space w.
+ * Matches screenspace_from_ndc applied after the divide exactly; the SIMD paths do the same float operations in the same order.
+ */
+void vertex_project_to_screen(vec4f* vertices, int num_vertices, int width, int height);
+
+#endif // VERTEX_H
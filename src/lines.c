@@ -0,0 +1,320 @@
+// wireframe lines: Cohen-Sutherland clipping, then fixed-point stepping along the major axis with a depth test per pixel
+#include "lines.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "simd.h"
+
+// Cohen-Sutherland outcodes
+#define LINES_LEFT 1
+#define LINES_RIGHT 2
+#define LINES_TOP 4
+#define LINES_BOTTOM 8
+
+// the minor axis is stepped in 16.16 fixed point
+#define LINES_FIXED_BITS 16
+#define LINES_FIXED_ONE (1 << LINES_FIXED_BITS)
+
+static int lines_outcode(const raster_target* t, float x, float y)
+{
+    int code = 0;
+    if (x < t->x0) code |= LINES_LEFT;
+    else if (x > t->x1) code |= LINES_RIGHT;
+    if (y < t->y0) code |= LINES_TOP;
+    else if (y > t->y1) code |= LINES_BOTTOM;
+    return code;
+}
+
+// clips a-b, depth included, to the target rectangle (as a continuous area, [x0, x1] x [y0, y1]) in place;
+// 0 if none of it is inside
+static int lines_clip(const raster_target* t, vec4f* a, vec4f* b)
+{
+    int code_a = lines_outcode(t, a->x, a->y);
+    int code_b = lines_outcode(t, b->x, b->y);
+    for (;;)
+    {
+        if (!(code_a | code_b))
+            return 1;
+        if (code_a & code_b)
+            return 0;
+
+        // move an endpoint that is outside onto the edge it is outside of. The other endpoint is on the inner side
+        // of that edge, so the line really crosses it and the divide is safe
+        int code = code_a ? code_a : code_b;
+        float s;
+        vec4f p;
+        if (code & LINES_TOP)
+        {
+            s = (t->y0 - a->y) / (b->y - a->y);
+            p.x = a->x + s * (b->x - a->x);
+            p.y = (float)t->y0;
+        }
+        else if (code & LINES_BOTTOM)
+        {
+            s = (t->y1 - a->y) / (b->y - a->y);
+            p.x = a->x + s * (b->x - a->x);
+            p.y = (float)t->y1;
+        }
+        else if (code & LINES_LEFT)
+        {
+            s = (t->x0 - a->x) / (b->x - a->x);
+            p.x = (float)t->x0;
+            p.y = a->y + s * (b->y - a->y);
+        }
+        else
+        {
+            s = (t->x1 - a->x) / (b->x - a->x);
+            p.x = (float)t->x1;
+            p.y = a->y + s * (b->y - a->y);
+        }
+        p.z = a->z + s * (b->z - a->z);
+        p.w = 1.0f;
+
+        if (code == code_a)
+        {
+            *a = p;
+            code_a = lines_outcode(t, a->x, a->y);
+        }
+        else
+        {
+            *b = p;
+            code_b = lines_outcode(t, b->x, b->y);
+        }
+    }
+}
+
+static int lines_clamp(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// floorf without the libm call, which SSE2 has no instruction for; x is within the rectangle, give or take a pixel
+static int lines_floor(float x)
+{
+    int i = (int)x;
+    return i - (x < (float)i);
+}
+
+/*
+    Depth-tests and draws `count` consecutive pixels, pixel j at depth z0 + (k + j) * dz. That is the same expression
+    the per-pixel loop uses, so which path draws a pixel never changes its depth. Returns nonzero if any pixel was
+    drawn. The vector paths load and store whole groups of pixels, which is fine since lines are drawn on one thread.
+*/
+static int lines_span(uint32_t* color, float* depth, int count, float z0, float dz, int k, uint32_t value)
+{
+    int j = 0;
+    int any = 0;
+#ifdef RENDER_AVX2
+    {
+        __m256 vz0 = _mm256_set1_ps(z0);
+        __m256 vdz = _mm256_set1_ps(dz);
+        __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256 vcolor = _mm256_castsi256_ps(_mm256_set1_epi32((int)value));
+        for (; j + 8 <= count; j += 8)
+        {
+            __m256 step = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(k + j), lanes));
+            __m256 z = _mm256_add_ps(vz0, _mm256_mul_ps(step, vdz));
+            __m256 d = _mm256_loadu_ps(depth + j);
+            __m256 closer = _mm256_cmp_ps(z, d, _CMP_LT_OQ);
+            if (!_mm256_movemask_ps(closer))
+                continue;
+            any = 1;
+            _mm256_storeu_ps(depth + j, _mm256_blendv_ps(d, z, closer));
+            __m256 c = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)(color + j)));
+            _mm256_storeu_si256((__m256i*)(color + j), _mm256_castps_si256(_mm256_blendv_ps(c, vcolor, closer)));
+        }
+    }
+#endif
+#ifdef RENDER_SSE2
+    {
+        __m128 vz0 = _mm_set1_ps(z0);
+        __m128 vdz = _mm_set1_ps(dz);
+        __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+        __m128 vcolor = _mm_castsi128_ps(_mm_set1_epi32((int)value));
+        for (; j + 4 <= count; j += 4)
+        {
+            __m128 step = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(k + j), lanes));
+            __m128 z = _mm_add_ps(vz0, _mm_mul_ps(step, vdz));
+            __m128 d = _mm_loadu_ps(depth + j);
+            __m128 closer = _mm_cmplt_ps(z, d);
+            if (!_mm_movemask_ps(closer))
+                continue;
+            any = 1;
+            _mm_storeu_ps(depth + j, _mm_or_ps(_mm_and_ps(closer, z), _mm_andnot_ps(closer, d)));
+            __m128 c = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(color + j)));
+            c = _mm_or_ps(_mm_and_ps(closer, vcolor), _mm_andnot_ps(closer, c));
+            _mm_storeu_si128((__m128i*)(color + j), _mm_castps_si128(c));
+        }
+    }
+#endif
+    for (; j < count; j++)
+    {
+        float z = z0 + (float)(k + j) * dz;
+        if (z < depth[j])
+        {
+            depth[j] = z;
+            color[j] = value;
+            any = 1;
+        }
+    }
+    return any;
+}
+
+void lines_draw(const raster_target* target, vec4f a, vec4f b, uint32_t color, dirty_tiles* drawn)
+{
+    if (target->x0 >= target->x1 || target->y0 >= target->y1 || !lines_clip(target, &a, &b))
+        return;
+
+    uint32_t* pixels = target->color;
+    float* depth = target->depth;
+    int stride = target->stride;
+
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    if (dx < 1.0f && dx > -1.0f && dy < 1.0f && dy > -1.0f)
+    {
+        // less than a pixel either way, as most edges of a dense mesh are: the pixel under the midpoint is the one
+        // the walk below would pick along the major axis, and this way costs none of its setup
+        int x = lines_clamp(lines_floor((a.x + b.x) * 0.5f), target->x0, target->x1 - 1);
+        int y = lines_clamp(lines_floor((a.y + b.y) * 0.5f), target->y0, target->y1 - 1);
+        float z = (a.z + b.z) * 0.5f;
+        size_t index = (size_t)y * stride + x;
+        if (z < depth[index])
+        {
+            depth[index] = z;
+            pixels[index] = color;
+            if (drawn)
+            {
+                dirty_mark_pixel(drawn, x, y);
+            }
+        }
+        return;
+    }
+
+    // walk along whichever axis the line is longer in, in increasing order; the other one is the minor axis
+    int x_major = fabsf(dx) >= fabsf(dy);
+    float major_a = x_major ? a.x : a.y;
+    float major_b = x_major ? b.x : b.y;
+    float minor_a = x_major ? a.y : a.x;
+    float minor_b = x_major ? b.y : b.x;
+    float z_a = a.z, z_b = b.z;
+    if (major_a > major_b)
+    {
+        float tmp;
+        tmp = major_a; major_a = major_b; major_b = tmp;
+        tmp = minor_a; minor_a = minor_b; minor_b = tmp;
+        tmp = z_a; z_a = z_b; z_b = tmp;
+    }
+    int major_lo = x_major ? target->x0 : target->y0;
+    int major_hi = x_major ? target->x1 - 1 : target->y1 - 1;
+    int minor_lo = x_major ? target->y0 : target->x0;
+    int minor_hi = x_major ? target->y1 - 1 : target->x1 - 1;
+
+    // the pixels whose centers the line passes: first and last along the major axis
+    int first = lines_clamp(-lines_floor(0.5f - major_a), major_lo, major_hi);
+    int last = lines_clamp(lines_floor(major_b - 0.5f), major_lo, major_hi);
+    if (first > last)
+    {
+        // passes no pixel center: a pixel or so long, but slanted enough that it wasn't caught above
+        first = last = lines_clamp(lines_floor((major_a + major_b) * 0.5f), major_lo, major_hi);
+    }
+    int count = last - first + 1;
+
+    float length = major_b - major_a;
+    float inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+    float slope = (minor_b - minor_a) * inv_length;
+    float dz = (z_b - z_a) * inv_length;
+    float offset = first + 0.5f - major_a;
+    float z0 = z_a + offset * dz;
+
+    // minor coordinate at the first and last pixel, clamped into the rectangle; every pixel in between is then
+    // inside too, since the fixed-point step below can't overshoot either end
+    int32_t fixed_lo = minor_lo * LINES_FIXED_ONE;
+    int32_t fixed_hi = (minor_hi + 1) * LINES_FIXED_ONE - 1;
+    int32_t minor_first = lines_clamp((int32_t)((minor_a + offset * slope) * LINES_FIXED_ONE), fixed_lo, fixed_hi);
+    int32_t step = 0;
+    if (count > 1)
+    {
+        int32_t minor_last = lines_clamp((int32_t)((minor_a + (last + 0.5f - major_a) * slope) * LINES_FIXED_ONE), fixed_lo, fixed_hi);
+        step = (minor_last - minor_first) / (count - 1);
+    }
+
+    if (x_major && count >= 2 * LINES_SPAN_MIN && abs(step) * LINES_SPAN_MIN <= LINES_FIXED_ONE)
+    {
+        // shallow: the pixels come in horizontal runs, one per row crossed; draw each run in one go
+        int k = 0;
+        while (k < count)
+        {
+            int32_t minor = minor_first + k * step;
+            int row = minor >> LINES_FIXED_BITS;
+            int run;
+            if (step > 0)
+            {
+                // steps until the minor coordinate reaches the next row
+                run = ((row + 1) * LINES_FIXED_ONE - minor + step - 1) / step;
+            }
+            else if (step < 0)
+            {
+                // ...or drops below this one
+                run = (minor - row * LINES_FIXED_ONE) / -step + 1;
+            }
+            else
+            {
+                run = count - k;
+            }
+            if (run > count - k)
+            {
+                run = count - k;
+            }
+
+            int x = first + k;
+            size_t index = (size_t)row * stride + x;
+            if (lines_span(pixels + index, depth + index, run, z0, dz, k, color) && drawn)
+            {
+                dirty_mark_rect(drawn, x, row, x + run, row + 1);
+            }
+            k += run;
+        }
+        return;
+    }
+
+    int major_stride = x_major ? 1 : stride;
+    int minor_stride = x_major ? stride : 1;
+    int minor = minor_first >> LINES_FIXED_BITS;
+    size_t index = (size_t)first * major_stride + (size_t)minor * minor_stride;
+    for (int k = 0; k < count; k++)
+    {
+        // the minor coordinate moves by at most one pixel per step
+        int next = (minor_first + k * step) >> LINES_FIXED_BITS;
+        index += (ptrdiff_t)(next - minor) * minor_stride;
+        minor = next;
+
+        float z = z0 + (float)k * dz;
+        if (z < depth[index])
+        {
+            depth[index] = z;
+            pixels[index] = color;
+            if (drawn)
+            {
+                if (x_major) dirty_mark_pixel(drawn, first + k, minor);
+                else dirty_mark_pixel(drawn, minor, first + k);
+            }
+        }
+        index += major_stride;
+    }
+}
+
+void lines_draw_model(const raster_target* target, const vec4f* screen_vertices, const int* indices, int num_indices,
+                      uint32_t color, dirty_tiles* drawn)
+{
+    for (int i = 0; i + 2 < num_indices; i += 3)
+    {
+        vec4f a = screen_vertices[indices[i]];
+        vec4f b = screen_vertices[indices[i + 1]];
+        vec4f c = screen_vertices[indices[i + 2]];
+        lines_draw(target, a, b, color, drawn);
+        lines_draw(target, b, c, color, drawn);
+        lines_draw(target, c, a, color, drawn);
+    }
+}
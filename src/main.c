@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include <time.h>
 #include "drawer.h"
@@ -13,9 +14,73 @@
 #include "projection.h"
 #include <math.h>
 #include "io.h"
+#include "material.h"
+#include "mesh.h"
 #include "culling.h"
+#include "render.h"
+#include "scene.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "swapchain.h"
+#include "tiles.h"
+
+// simulation steps per second; model rotation and camera speeds are per step
+#define SIMULATION_HZ 60.0
+
+/**
+ * @brief What the render thread needs to draw one frame, one per swap chain slot. The main thread owns the
+ * simulation and fills this in; the render thread owns the scene and the render context.
+ */
+typedef struct frame_job
+{
+    mat4 root_transform;
+    vec3f camera_pos;
+    quat camera_rot;
+
+    // the main thread's last present and clear, handed over so the profiler (which is single-threaded and lives
+    // on the render thread) can record them too; 0 if there was none
+    uint64_t present_start, present_end;
+    uint64_t clear_start, clear_end;
+
+    // filled in by the render thread: the tiles this frame drew into, which are all that needs presenting and,
+    // once presented, all that needs clearing
+    dirty_tiles drawn;
+} frame_job;
+
+typedef struct render_thread_data
+{
+    swapchain* chain;
+    frame_job* jobs;
+    render_context* ctx;
+    scene* world;
+    int root;
+} render_thread_data;
+
+// draws every frame the main thread queues, until the swap chain is closed
+static int render_thread(void* data)
+{
+    render_thread_data* r = data;
+    int slot;
+    while ((slot = swapchain_wait_render(r->chain)) >= 0)
+    {
+        frame_job* job = &r->jobs[slot];
+        profiler_begin_frame();
+        if (profiler_enabled && job->present_end)
+        {
+            profiler_record(PROFILE_PRESENT, job->present_start, job->present_end);
+            profiler_record(PROFILE_CLEAR, job->clear_start, job->clear_end);
+        }
 
-# define M_PI 3.14159265358979323846
+        render_begin_frame(r->ctx);
+        scene_set_local(r->world, r->root, job->root_transform);
+        scene_render(r->world, r->ctx, swapchain_buffer(r->chain, slot), job->camera_pos, job->camera_rot);
+        dirty_copy(&job->drawn, &r->ctx->drawn);
+
+        profiler_end_frame();
+        swapchain_rendered(r->chain);
+    }
+    return 0;
+}
 
 void print_vertices(vec4f* screen_vertices, int num_vertices)
 {
@@ -25,41 +90,258 @@ void print_vertices(vec4f* screen_vertices, int num_vertices)
     }
 }
 
+static void print_usage(const char* prog)
+{
+    printf("Usage: %s <model.obj> [options]\n", prog);
+    printf("  --backend <sdl|null>  presentation backend (default: sdl)\n");
+    printf("  --headless            same as --backend null\n");
+    printf("  --frames <n>          stop after n frames (default: run until the window is closed)\n");
+    printf("  --fps <n>             frame rate to pace the window to, 0 for uncapped (default: 60)\n");
+    printf("  --dump <prefix>       write every frame to <prefix>_NNNNN.ppm (null backend only)\n");
+    printf("  --dump-raw <prefix>   same, but as raw ARGB8888 frames\n");
+    printf("  --solid               fill triangles instead of drawing the wireframe\n");
+    printf("  --shading <mode>      lighting of solid triangles: unlit, gouraud (per vertex) or phong (per pixel)\n");
+    printf("                        (default: gouraud)\n");
+    printf("  --threads <n>         rasterize on n threads (default: one per CPU)\n");
+    printf("  --buffers <n>         framebuffers in flight between rendering and presenting, 2 or 3 (default: 2)\n");
+    printf("  --grid <n>            draw an n x n grid of copies of the model (default: 1)\n");
+    printf("  --no-cache            always parse the .obj; don't read or write <model.obj>.meshcache\n");
+    printf("  --optimize            weld vertices and reorder triangles for the vertex cache and overdraw on load\n");
+    printf("  --lods                build simplified levels of detail on load and draw far copies with them\n");
+    printf("  --lod-error <px>      screen-space error a level of detail may have (default: 1)\n");
+    printf("  --trace <file.json>   profile every pipeline stage and write a Chrome trace on exit\n");
+    printf("  --trace-csv <file>    same, but as one CSV row per frame\n");
+}
+
 int main(int argc, char *argv[])
 {    
     if (argc < 2)
     {
-        printf("Usage: %s <model.obj>\n", argv[0]);
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const drawer_backend* backend = &drawer_sdl_backend;
+    int max_frames = 0; // 0 = no limit
+    double target_fps = 60.0;
+    const char* dump_prefix = NULL;
+    drawer_dump_format dump_format = DRAWER_DUMP_NONE;
+    char* model_path = NULL;
+    const char* trace_path = NULL;
+    const char* trace_csv_path = NULL;
+    render_mode mode = RENDER_MODE_WIREFRAME;
+    render_shading shading = RENDER_SHADING_GOURAUD;
+    int threads = 0; // 0 = one per CPU
+    int num_buffers = 2;
+    int load_flags = MESH_LOAD_CACHE;
+    int grid = 1;
+    float lod_error = 1.0f;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            backend = &drawer_null_backend;
+        }
+        else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+        {
+            backend = drawer_find_backend(argv[++i]);
+            if (!backend)
+            {
+                printf("Unknown backend: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            max_frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            target_fps = atof(argv[++i]);
+            if (target_fps < 0.0)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if ((strcmp(argv[i], "--dump") == 0 || strcmp(argv[i], "--dump-raw") == 0) && i + 1 < argc)
+        {
+            dump_format = strcmp(argv[i], "--dump") == 0 ? DRAWER_DUMP_PPM : DRAWER_DUMP_RAW;
+            dump_prefix = argv[++i];
+        }
+        else if (strcmp(argv[i], "--solid") == 0)
+        {
+            mode = RENDER_MODE_SOLID;
+        }
+        else if (strcmp(argv[i], "--shading") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if (strcmp(name, "unlit") == 0)
+            {
+                shading = RENDER_SHADING_UNLIT;
+            }
+            else if (strcmp(name, "gouraud") == 0)
+            {
+                shading = RENDER_SHADING_GOURAUD;
+            }
+            else if (strcmp(name, "phong") == 0)
+            {
+                shading = RENDER_SHADING_PHONG;
+            }
+            else
+            {
+                printf("Unknown shading: %s\n", name);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc)
+        {
+            num_buffers = atoi(argv[++i]);
+            if (num_buffers < 2 || num_buffers > SWAPCHAIN_MAX_BUFFERS)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc)
+        {
+            grid = atoi(argv[++i]);
+            if (grid < 1)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--no-cache") == 0)
+        {
+            load_flags &= ~MESH_LOAD_CACHE;
+        }
+        else if (strcmp(argv[i], "--optimize") == 0)
+        {
+            load_flags |= MESH_LOAD_OPTIMIZE;
+        }
+        else if (strcmp(argv[i], "--lods") == 0)
+        {
+            load_flags |= MESH_LOAD_LODS;
+        }
+        else if (strcmp(argv[i], "--lod-error") == 0 && i + 1 < argc)
+        {
+            lod_error = (float)atof(argv[++i]);
+            if (lod_error < 0.0f)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace-csv") == 0 && i + 1 < argc)
+        {
+            trace_csv_path = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !model_path)
+        {
+            model_path = argv[i];
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!model_path)
+    {
+        print_usage(argv[0]);
         return 1;
     }
 
-    SDL_Init(SDL_INIT_VIDEO);
+    int headless = backend == &drawer_null_backend;
+    if (dump_prefix && !headless)
+    {
+        printf("--dump only works with the null backend.\n");
+        return 1;
+    }
 
-    key_states = malloc(SDL_NUM_SCANCODES * sizeof(int));
+    key_states = calloc(SDL_NUM_SCANCODES, sizeof(int));
 
     int width = 800;
     int height = 600;
 
-    drawer_init(width, height);
+    drawer_set_backend(backend);
+    drawer_null_set_dump(dump_prefix, dump_format);
+    if (drawer_init(width, height) != 0)
+    {
+        return 1;
+    }
+
+    // frames are drawn on a render thread into a ring of buffers, and presented here while the next one is drawn
+    swapchain* chain = swapchain_create(num_buffers, width, height);
+    frame_job jobs[SWAPCHAIN_MAX_BUFFERS] = {0};
 
-    uint32_t* image = malloc(width * height * sizeof(uint32_t));
+    // what the window shows: starts out all dirty, since the window's texture starts out undefined
+    dirty_tiles shown;
+    int dirty_ok = dirty_init(&shown, width, height, TILE_SIZE) == 0;
+    for (int i = 0; i < SWAPCHAIN_MAX_BUFFERS && dirty_ok; i++)
+    {
+        dirty_ok = dirty_init(&jobs[i].drawn, width, height, TILE_SIZE) == 0;
+    }
 
-    if (!image)
+    render_context ctx;
+    if (!chain || !dirty_ok || render_context_init(&ctx, width, height) != 0)
     {
         printf("malloc failure.\n");
         return 1;
     }
+    ctx.mode = mode;
+    ctx.shading = shading;
+    ctx.lod_error_pixels = lod_error;
+    if (threads > 0 && render_context_set_threads(&ctx, threads) != 0)
+    {
+        return 1;
+    }
 
-    // read a model from file
-    vec3f* vertices;
-    int* indices;
-    int num_vertices, num_indices;
-    read_model(argv[1], &vertices, &indices, &num_vertices, &num_indices);
+    // read a model from file (or its binary cache)
+    mesh model;
+    if (mesh_load(model_path, load_flags, &model) != 0)
+    {
+        return 1;
+    }
+    vec3f* vertices = model.positions;
+    int num_vertices = model.num_positions;
+
+    // the model's materials, from the .mtl its `mtllib` names; a model that names none, or a library that can't be
+    // read, is just drawn untextured
+    material_library materials = {0};
+    const material** model_materials = NULL;
+    if (model.material_library[0])
+    {
+        char* library_path = material_resolve_path(model_path, model.material_library);
+        if (!library_path)
+        {
+            return 1;
+        }
+        if (material_load_library(library_path, &materials) == 0)
+        {
+            model_materials = material_bind(&materials, &model);
+        }
+        free(library_path);
+    }
 
-    printf("Read vertices:\n");
-    for (int i = 0; i < num_vertices; i++)
+    if (!headless)
     {
-        printf("Vertex %d: (%f, %f, %f)\n", i, vertices[i].x, vertices[i].y, vertices[i].z);
+        printf("Read vertices:\n");
+        for (int i = 0; i < num_vertices; i++)
+        {
+            printf("Vertex %d: (%f, %f, %f)\n", i, vertices[i].x, vertices[i].y, vertices[i].z);
+        }
     }
     mat4 transform;
     mat4_identity(transform);
@@ -67,7 +349,7 @@ int main(int argc, char *argv[])
     printf("Model transform:\n");
     mat4_print(transform);
 
-    // this is the delta every frame; this matrix is applied to the transform every frame
+    // this is the delta every simulation step; this matrix is applied to the transform every step
     mat4 change;
     mat4_rotate_y(change, 0.01f);
     
@@ -75,123 +357,138 @@ int main(int argc, char *argv[])
     vec3f camera_pos = {0.0f, 0.0f, 6.0f};
     quat camera_rot = {1.0f, 0.0f, 0.0f, 0.0f}; // identity quaternion
 
-    int running = 1;
-    SDL_Event event;
-    while (running)
+    // the scene: one spinning root, with the copies of the model laid out on a grid under it
+    surface model_surface;
+    surface_init(&model_surface, &model);
+    model_surface.materials = model_materials;
+    scene world;
+    scene_init(&world);
+    int root = scene_add_node(&world, SCENE_NO_PARENT, NULL, transform);
+    float spacing = 1.5f * fmaxf(model.bounds_max.x - model.bounds_min.x, model.bounds_max.z - model.bounds_min.z);
+    for (int gz = 0; gz < grid; gz++)
     {
-
-        while(SDL_PollEvent(&event))
+        for (int gx = 0; gx < grid; gx++)
         {
-            switch(event.type)
+            mat4 offset;
+            mat4_identity(offset);
+            if (grid > 1)
             {
-                case SDL_QUIT:
-                    running = 0;
-                    break;
-                case SDL_KEYDOWN:
-                    keydown(event.key.keysym.sym);
-                    break;
-                case SDL_KEYUP:
-                    keyup(event.key.keysym.sym);
-                    break;
-                default:
-                    break;
+                mat4_translate(offset, (gx - (grid - 1) * 0.5f) * spacing, 0.0f, (gz - (grid - 1) * 0.5f) * spacing);
             }
-        }        
-
-        SDL_Delay(16);
-
-        // basic render pipeline track, using the model defined above for testing
+            scene_add_node(&world, root, &model_surface, offset);
+        }
+    }
 
-        render_model(image, vertices, num_vertices, indices, num_indices, transform, camera_pos, camera_rot, width, height);
+    if (trace_path || trace_csv_path)
+    {
+        profiler_enable(1);
+    }
 
-        drawer_draw_buffer(image);
-        drawer_clear_buffer(image);
+    // the null backend has nothing to pace against and should give the same frames every run: one simulation
+    // step per frame, as fast as it goes. A window is paced to --fps, with the simulation on the real clock
+    scheduler clock;
+    scheduler_init(&clock, SIMULATION_HZ, headless ? 0.0 : target_fps, headless);
 
-        mat4_multiply(transform, change, transform);
+    render_thread_data render_data = {chain, jobs, &ctx, &world, root};
+    SDL_Thread* renderer = SDL_CreateThread(render_thread, "render", &render_data);
+    if (!renderer)
+    {
+        fprintf(stderr, "Failed to create the render thread: %s\n", SDL_GetError());
+        return 1;
+    }
 
-        // camera control
-        tick_transform(&camera_pos, &camera_rot);
+    int running = 1;
+    int frame = 0;
+    uint64_t present_start = 0, present_end = 0, clear_start = 0, clear_end = 0;
+    while (running)
+    {
+        int steps = scheduler_begin_frame(&clock);
+        running = drawer_poll_events();
+
+        // queue this frame for the render thread; this waits if it is already a whole swap chain ahead
+        int slot = swapchain_acquire(chain);
+        frame_job* job = &jobs[slot];
+        memcpy(job->root_transform, transform, sizeof(mat4));
+        job->camera_pos = camera_pos;
+        job->camera_rot = camera_rot;
+        job->present_start = present_start;
+        job->present_end = present_end;
+        job->clear_start = clear_start;
+        job->clear_end = clear_end;
+        swapchain_queue(chain);
+        frame++;
+        if (max_frames > 0 && frame >= max_frames)
+        {
+            running = 0;
+        }
 
-        // print stats
-        printf("Camera position: (%f, %f, %f)\n", camera_pos.x, camera_pos.y, camera_pos.z);
-        printf("Camera rotation: (%f, %f, %f, %f)\n", camera_rot.w, camera_rot.x, camera_rot.y, camera_rot.z);
-    }
+        // advance the simulation by however many fixed steps the last frame's time was worth
+        for (int step = 0; step < steps; step++)
+        {
+            mat4_multiply(transform, change, transform);
 
-    free(image);
-    drawer_cleanup();
-    SDL_Quit();
-    return 0;
-}
+            // camera control
+            tick_transform(&camera_pos, &camera_rot);
+        }
 
-void render_model(uint32_t* image, vec3f* vertices, int num_vertices, int* indices, int num_indices, mat4 transform, vec3f camera_pos, quat camera_rot, int width, int height)
-{
-    // 1. translate into world space
-    vec4f* world_vertices = malloc(num_vertices * sizeof(vec4f));
-    // (add homogenous component)
-    vec4f* vertices_w = malloc(num_vertices * sizeof(vec4f));
-    model_add_w(vertices, num_vertices, vertices_w);
-    world_from_model(vertices_w, num_vertices, transform, world_vertices);
-    
+        // present the previous frame while the render thread draws this one; clearing the buffer for reuse
+        // happens here too, off the render thread. On the way out, present everything still in flight
+        while (swapchain_in_flight(chain) > (running ? num_buffers - 1 : 0))
+        {
+            int ready = swapchain_wait_present(chain);
+            uint32_t* image = swapchain_buffer(chain, ready);
+            dirty_tiles* drawn = &jobs[ready].drawn;
+            present_start = timer_now_ns();
+            // the window changes where this frame drew, and where the frame it replaces had drawn
+            dirty_merge(&shown, drawn);
+            dirty_rect rects[DIRTY_MAX_RECTS];
+            drawer_draw_buffer_rects(image, rects, dirty_rects(&shown, rects));
+            dirty_copy(&shown, drawn);
+            present_end = clear_start = timer_now_ns();
+            // everything else in the buffer is still clear from its last use
+            dirty_clear_color(drawn, image, 0xFF000000);
+            clear_end = timer_now_ns();
+            swapchain_presented(chain);
+        }
 
-    // 2. transform into camera space
-    vec4f* camera_vertices = malloc(num_vertices * sizeof(vec4f));
-    camera_from_world(camera_pos, camera_rot, world_vertices, num_vertices, camera_vertices);
+        // print stats
+        if (!headless)
+        {
+            printf("Camera position: (%f, %f, %f)\n", camera_pos.x, camera_pos.y, camera_pos.z);
+            printf("Camera rotation: (%f, %f, %f, %f)\n", camera_rot.w, camera_rot.x, camera_rot.y, camera_rot.z);
+        }
 
-    
+        scheduler_end_frame(&clock);
+    }
+    swapchain_close(chain);
+    SDL_WaitThread(renderer, NULL);
+    scheduler_print_summary(&clock);
 
-    // 3. transform into clip space
-    // we need to decide on some camera constants too (znear, zfar, fov, aspect)
-    float znear = 0.1f;
-    float zfar = 50.0f;
-    float fov = M_PI / 2.0f; // 90 degrees
-    float aspect = (float)width / (float)height;
-    vec4f* clip_vertices = malloc(num_vertices * sizeof(vec4f));
-    clip_from_camera(camera_vertices, num_vertices, fov, aspect, znear, zfar, clip_vertices);
-
-    // culling!!
-    // 3.5. cull triangles that are outside the view frustum
-    vec4f* culled_vertices = NULL;
-    int* culled_indices = NULL;
-    int tmp_num_vertices = 0;
-    int tmp_num_indices = 0;
-    culling_cull_triangle(clip_vertices, num_vertices, indices, num_indices, 
-                            &culled_vertices, &tmp_num_vertices, 
-                            &culled_indices, &tmp_num_indices);
-    num_vertices = tmp_num_vertices;
-    num_indices = tmp_num_indices;
-
-    // 4. transform into NDC
-    // this is simple enough that we can do it in place
-    for (int i = 0; i < num_vertices; i++)
+    if (trace_path || trace_csv_path)
     {
-        culled_vertices[i].x /= culled_vertices[i].w;
-        culled_vertices[i].y /= culled_vertices[i].w;
-        culled_vertices[i].z /= culled_vertices[i].w;
+        profiler_print_summary(stdout);
+        if (trace_path) profiler_export_chrome_trace(trace_path);
+        if (trace_csv_path) profiler_export_csv(trace_csv_path);
+        profiler_cleanup();
     }
 
-    // free the original clip_vertices
-    free(clip_vertices);
-
-    // 5. transform into screen space
- 
-    vec4f* screen_vertices = malloc(num_vertices * sizeof(vec4f));
-    screenspace_from_ndc(culled_vertices, num_vertices, znear, zfar, screen_vertices);
-   
-
-    // finally, 6. assemble and draw triangles
-    screenspace_clear_depth_buffer(width, height);
-    screenspace_draw_model(screen_vertices, num_indices, culled_indices, image);
-    
-
-    // free everything
-    free(world_vertices);
-    free(vertices_w);
-    free(camera_vertices);
-    free(culled_vertices);
-    free(culled_indices);
-    free(screen_vertices);
-    // ATTN! We will free these as soon as we're done with them later... doing this for simplicity for now
+    if (headless)
+    {
+        printf("Rendered %d frames.\n", drawer_null_frame_count());
+    }
 
+    scene_destroy(&world);
+    render_context_destroy(&ctx);
+    swapchain_destroy(chain);
+    for (int i = 0; i < SWAPCHAIN_MAX_BUFFERS; i++)
+    {
+        dirty_destroy(&jobs[i].drawn);
+    }
+    dirty_destroy(&shown);
+    free(model_materials);
+    material_library_free(&materials);
+    mesh_free(&model);
+    free(key_states);
+    drawer_cleanup();
+    return 0;
 }
-
-
@@ -0,0 +1,216 @@
+// Wavefront .mtl material libraries
+#include "material.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int material_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+char* material_resolve_path(const char* base, const char* name)
+{
+    size_t dir_length = 0;
+    if (name[0] != '/' && name[0] != '\\')
+    {
+        const char* slash = strrchr(base, '/');
+        const char* backslash = strrchr(base, '\\');
+        if (backslash && (!slash || backslash > slash))
+            slash = backslash;
+        dir_length = slash ? (size_t)(slash - base) + 1 : 0;
+    }
+
+    size_t name_length = strlen(name);
+    char* path = malloc(dir_length + name_length + 1);
+    if (!path)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return NULL;
+    }
+    memcpy(path, base, dir_length);
+    memcpy(path + dir_length, name, name_length + 1);
+    return path;
+}
+
+// [p, end) trimmed, or only its last whitespace-separated word, NUL-terminated into `out`; 1 if it's empty
+static int material_text(const char* p, const char* end, int last_word, char* out, size_t size)
+{
+    while (end > p && material_is_space(end[-1]))
+    {
+        end--;
+    }
+    const char* start = end;
+    while (start > p && (!last_word || !material_is_space(start[-1])))
+    {
+        start--;
+    }
+    while (start < end && material_is_space(*start))
+    {
+        start++;
+    }
+    if (start == end)
+        return 1;
+    size_t length = (size_t)(end - start) < size - 1 ? (size_t)(end - start) : size - 1;
+    memcpy(out, start, length);
+    out[length] = '\0';
+    return 0;
+}
+
+// does the line start with this keyword, followed by a space?
+static int material_keyword(const char* s, const char* eol, const char* keyword)
+{
+    size_t length = strlen(keyword);
+    return (size_t)(eol - s) > length && memcmp(s, keyword, length) == 0 && material_is_space(s[length]);
+}
+
+// the color on a `Kd` or `Ks` line: three values, or one for gray, each at least 0; left alone if there are none
+static void material_color(const char* p, float out[3])
+{
+    float rgb[3];
+    int n = 0;
+    for (; n < 3; n++)
+    {
+        char* next;
+        rgb[n] = strtof(p, &next);
+        if (next == p)
+            break;
+        p = next;
+    }
+    if (n == 0)
+        return;
+    for (int k = 0; k < 3; k++)
+    {
+        float c = rgb[n == 3 ? k : 0];
+        out[k] = c > 0.0f ? c : 0.0f;
+    }
+}
+
+int material_load_library(const char* path, material_library* out)
+{
+    memset(out, 0, sizeof(*out));
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        perror("Failed to open material library");
+        return 1;
+    }
+
+    int alloc = 0;
+    char line[1024];
+    char word[MESH_NAME_MAX];
+    while (fgets(line, sizeof(line), file))
+    {
+        const char* eol = line + strlen(line);
+        const char* s = line;
+        while (s < eol && material_is_space(*s))
+        {
+            s++;
+        }
+
+        // names keep any spaces inside them, as the .obj loader keeps them for `usemtl`
+        if (material_keyword(s, eol, "newmtl"))
+        {
+            if (material_text(s + 6, eol, 0, word, sizeof(word)) != 0)
+                continue;
+            if (out->num_materials == alloc)
+            {
+                alloc = alloc ? alloc * 2 : 8;
+                material* grown = realloc(out->materials, (size_t)alloc * sizeof(material));
+                if (!grown)
+                {
+                    fprintf(stderr, "Memory allocation failed!\n");
+                    exit(1);
+                }
+                out->materials = grown;
+            }
+            material* m = &out->materials[out->num_materials++];
+            memset(m, 0, sizeof(*m));
+            memcpy(m->name, word, strlen(word) + 1);
+            m->diffuse[0] = m->diffuse[1] = m->diffuse[2] = 1.0f;
+            m->shininess = 1.0f;
+        }
+        else if (material_keyword(s, eol, "Kd") && out->num_materials > 0)
+        {
+            material_color(s + 2, out->materials[out->num_materials - 1].diffuse);
+        }
+        else if (material_keyword(s, eol, "Ks") && out->num_materials > 0)
+        {
+            material_color(s + 2, out->materials[out->num_materials - 1].specular);
+        }
+        else if (material_keyword(s, eol, "Ns") && out->num_materials > 0)
+        {
+            // an exponent under 1 would make the highlight wider than the lit side
+            float shininess = strtof(s + 2, NULL);
+            out->materials[out->num_materials - 1].shininess = shininess > 1.0f ? shininess : 1.0f;
+        }
+        else if (material_keyword(s, eol, "map_Kd") && out->num_materials > 0)
+        {
+            material* m = &out->materials[out->num_materials - 1];
+            if (m->diffuse_map || material_text(s + 6, eol, 1, word, sizeof(word)) != 0)
+                continue;
+            char* texture_path = material_resolve_path(path, word);
+            texture* t = malloc(sizeof(texture));
+            if (!texture_path || !t)
+            {
+                fprintf(stderr, "Memory allocation failed!\n");
+                exit(1);
+            }
+            if (texture_load(texture_path, t) == 0)
+            {
+                m->diffuse_map = t;
+            }
+            else
+            {
+                fprintf(stderr, "Material %s is drawn without its texture\n", m->name);
+                free(t);
+            }
+            free(texture_path);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+void material_library_free(material_library* lib)
+{
+    for (int i = 0; i < lib->num_materials; i++)
+    {
+        if (lib->materials[i].diffuse_map)
+        {
+            texture_destroy(lib->materials[i].diffuse_map);
+            free(lib->materials[i].diffuse_map);
+        }
+    }
+    free(lib->materials);
+    memset(lib, 0, sizeof(*lib));
+}
+
+const material* material_find(const material_library* lib, const char* name)
+{
+    for (int i = 0; i < lib->num_materials; i++)
+    {
+        if (strcmp(lib->materials[i].name, name) == 0)
+            return &lib->materials[i];
+    }
+    return NULL;
+}
+
+const material** material_bind(const material_library* lib, const mesh* m)
+{
+    int count = m->num_materials > 0 ? m->num_materials : 1;
+    const material** slots = malloc((size_t)count * sizeof(*slots));
+    if (!slots)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    const material* fallback = lib->num_materials > 0 ? &lib->materials[0] : NULL;
+    for (int i = 0; i < count; i++)
+    {
+        const material* found = i < m->num_materials ? material_find(lib, m->material_names[i]) : NULL;
+        slots[i] = found ? found : fallback;
+    }
+    return slots;
+}
@@ -0,0 +1,244 @@
+// loading meshes from .obj files, through the binary cache when there is an up-to-date one
+#define _POSIX_C_SOURCE 200809L // st_mtim
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE // st_mtimespec, Darwin's name for it
+#endif
+#include "mesh.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "obj.h"
+#include "meshcache.h"
+#include "meshopt.h"
+#include "simplify.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define MESH_CACHE_SUFFIX ".meshcache"
+
+void mesh_compute_bounds(mesh* m)
+{
+    if (m->num_positions == 0)
+    {
+        m->bounds_min = m->bounds_max = (vec3f){0.0f, 0.0f, 0.0f};
+        return;
+    }
+
+    vec3f lo = m->positions[0];
+    vec3f hi = m->positions[0];
+    for (int i = 1; i < m->num_positions; i++)
+    {
+        vec3f p = m->positions[i];
+        if (p.x < lo.x) lo.x = p.x;
+        if (p.y < lo.y) lo.y = p.y;
+        if (p.z < lo.z) lo.z = p.z;
+        if (p.x > hi.x) hi.x = p.x;
+        if (p.y > hi.y) hi.y = p.y;
+        if (p.z > hi.z) hi.z = p.z;
+    }
+    m->bounds_min = lo;
+    m->bounds_max = hi;
+}
+
+int mesh_total_indices(const mesh* m)
+{
+    if (m->num_lods == 0)
+        return m->num_indices;
+    const mesh_lod* last = &m->lods[m->num_lods - 1];
+    return (int)(last->index_offset + last->index_count);
+}
+
+// smooth normals for a file that has none: every triangle adds its area-weighted normal to its corners' positions, so
+// vertices that share a position (split by a texture seam, say) share a normal too and the seam doesn't show
+static void mesh_compute_normals(mesh* m)
+{
+    int n = m->num_positions;
+    int* canonical = malloc((size_t)(n ? n : 1) * sizeof(int));
+    m->normals = calloc((size_t)(n ? n : 1), sizeof(vec3f));
+    if (!canonical || !m->normals)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    meshopt_position_remap(m->positions, n, canonical);
+
+    for (int i = 0; i + 2 < m->num_indices; i += 3)
+    {
+        vec3f a = m->positions[m->indices[i]];
+        vec3f b = m->positions[m->indices[i + 1]];
+        vec3f c = m->positions[m->indices[i + 2]];
+        vec3f e1 = {b.x - a.x, b.y - a.y, b.z - a.z};
+        vec3f e2 = {c.x - a.x, c.y - a.y, c.z - a.z};
+        // the unnormalized cross product is already area-weighted
+        vec3f normal = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+        for (int k = 0; k < 3; k++)
+        {
+            vec3f* sum = &m->normals[canonical[m->indices[i + k]]];
+            sum->x += normal.x;
+            sum->y += normal.y;
+            sum->z += normal.z;
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        m->normals[v] = m->normals[canonical[v]];
+    }
+    free(canonical);
+}
+
+// appends coarser and coarser versions of level 0 to the index list, each about half the size of the one before;
+// with `optimize`, each gets the same vertex cache ordering as level 0 (the simplifier leaves them in no useful order)
+static void mesh_build_lods(mesh* m, int optimize)
+{
+    simplifier s;
+    simplify_init(&s, m, m->indices, m->num_indices);
+
+    int total = m->num_indices;
+    int previous = m->num_indices;
+    while (m->num_lods < MESH_MAX_LODS && previous / 3 >= MESH_LOD_MIN_TRIANGLES * 2)
+    {
+        int count = simplify_run(&s, previous / 6 * 3);
+        // stalled: what's left is mostly locked borders, or folds over if collapsed any further
+        if (count > previous / 4 * 3)
+            break;
+
+        int* indices = realloc(m->indices, (size_t)(total + count) * sizeof(int));
+        if (!indices)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+            exit(1);
+        }
+        m->indices = indices;
+        memcpy(m->indices + total, s.indices, (size_t)count * sizeof(int));
+        if (optimize)
+        {
+            meshopt_optimize_vertex_cache(m->indices + total, count, m->num_positions, NULL);
+        }
+        m->lods[m->num_lods++] = (mesh_lod){(uint32_t)total, (uint32_t)count, 0, 0, simplify_error(&s)};
+        total += count;
+        previous = count;
+    }
+    simplify_destroy(&s);
+}
+
+// the file's modification time in nanoseconds, so the cache notices an edit made within the second it was written
+static int64_t mesh_source_mtime(const struct stat* st)
+{
+#if defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000;
+#elif defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+int mesh_load(const char* path, int flags, mesh* out)
+{
+    memset(out, 0, sizeof(*out));
+
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        perror("Failed to open model file");
+        return 1;
+    }
+
+    uint32_t cache_flags = ((flags & MESH_LOAD_OPTIMIZE) ? MESHCACHE_FLAG_OPTIMIZED : 0) |
+                           ((flags & MESH_LOAD_LODS) ? MESHCACHE_FLAG_LODS : 0);
+    char* cache_path = NULL;
+    if (flags & MESH_LOAD_CACHE)
+    {
+        size_t length = strlen(path);
+        cache_path = malloc(length + sizeof(MESH_CACHE_SUFFIX));
+        if (!cache_path)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+            return 1;
+        }
+        memcpy(cache_path, path, length);
+        memcpy(cache_path + length, MESH_CACHE_SUFFIX, sizeof(MESH_CACHE_SUFFIX));
+
+        if (meshcache_map(cache_path, (uint64_t)st.st_size, mesh_source_mtime(&st), cache_flags, out) == 0)
+        {
+            free(cache_path);
+            return 0;
+        }
+    }
+
+    obj_mesh obj;
+    if (obj_load(path, &obj) != 0)
+    {
+        free(cache_path);
+        return 1;
+    }
+    out->positions = obj.positions;
+    out->uvs = obj.uvs;
+    out->normals = obj.normals;
+    out->material_ids = obj.material_ids;
+    out->num_positions = obj.num_positions;
+    out->indices = obj.indices;
+    out->num_indices = obj.num_indices;
+    memcpy(out->material_library, obj.material_library, MESH_NAME_MAX);
+    out->material_names = obj.materials;
+    out->num_materials = obj.num_materials;
+    if (!out->normals)
+    {
+        mesh_compute_normals(out);
+    }
+    if (flags & MESH_LOAD_OPTIMIZE)
+    {
+        meshopt_optimize(out); // also computes the bounds
+    }
+    else
+    {
+        mesh_compute_bounds(out);
+    }
+    out->lods[0] = (mesh_lod){0, (uint32_t)out->num_indices, 0, 0, 0.0f};
+    out->num_lods = 1;
+    if (flags & MESH_LOAD_LODS)
+    {
+        mesh_build_lods(out, flags & MESH_LOAD_OPTIMIZE);
+    }
+    meshlet_build(out);
+
+    if (cache_path)
+    {
+        if (meshcache_write(cache_path, out, (uint64_t)st.st_size, mesh_source_mtime(&st), cache_flags) != 0)
+        {
+            fprintf(stderr, "Couldn't write mesh cache %s; the model will be parsed again next time\n", cache_path);
+        }
+        free(cache_path);
+    }
+    return 0;
+}
+
+void mesh_free(mesh* m)
+{
+    if (m->mapping)
+    {
+#ifdef _WIN32
+        free(m->mapping);
+#else
+        munmap(m->mapping, m->mapping_size);
+#endif
+    }
+    else
+    {
+        free(m->positions);
+        free(m->uvs);
+        free(m->normals);
+        free(m->material_ids);
+        free(m->material_names);
+        free(m->indices);
+        free(m->meshlets);
+        free(m->meshlet_vertices);
+        free(m->meshlet_triangles);
+    }
+    memset(m, 0, sizeof(*m));
+}
@@ -0,0 +1,293 @@
+// binary mesh cache: positions and indices laid out exactly as they are used, so loading is one mmap
+#define _POSIX_C_SOURCE 200112L
+#include "meshcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint64_t meshcache_align(uint64_t offset)
+{
+    return (offset + MESHCACHE_ALIGN - 1) & ~(uint64_t)(MESHCACHE_ALIGN - 1);
+}
+
+// checks that a section of `count` elements at `offset` lies inside the file and is aligned
+static int meshcache_section_ok(uint64_t offset, uint64_t count, size_t element_size, uint64_t file_size)
+{
+    return offset % MESHCACHE_ALIGN == 0 && offset <= file_size && count <= (file_size - offset) / element_size;
+}
+
+// checks that every level of detail refers to indices and meshlets that are actually there
+static int meshcache_lods_ok(const meshcache_header* header)
+{
+    const mesh_lod* lods = (const mesh_lod*)((const char*)header + header->lods_offset);
+    for (uint32_t i = 0; i < header->num_lods; i++)
+    {
+        if ((uint64_t)lods[i].index_offset + lods[i].index_count > header->total_indices ||
+            (uint64_t)lods[i].meshlet_offset + lods[i].meshlet_count > header->num_meshlets)
+            return 0;
+    }
+    return 1;
+}
+
+// checks that every index and meshlet refers to vertices, indices and local vertices that are actually there, so a
+// damaged cache that passes the header checks is rebuilt instead of read out of bounds; one pass over the arrays
+static int meshcache_contents_ok(const meshcache_header* header)
+{
+    const char* base = (const char*)header;
+    const uint32_t* indices = (const uint32_t*)(base + header->indices_offset);
+    for (uint32_t i = 0; i < header->total_indices; i++)
+    {
+        if (indices[i] >= header->num_positions)
+            return 0;
+    }
+    const uint32_t* vertices = (const uint32_t*)(base + header->meshlet_vertices_offset);
+    for (uint32_t i = 0; i < header->num_meshlet_vertices; i++)
+    {
+        if (vertices[i] >= header->num_positions)
+            return 0;
+    }
+    const meshlet* meshlets = (const meshlet*)(base + header->meshlets_offset);
+    const uint8_t* triangles = (const uint8_t*)(base + header->meshlet_triangles_offset);
+    for (uint32_t i = 0; i < header->num_meshlets; i++)
+    {
+        const meshlet* ml = &meshlets[i];
+        if (ml->vertex_count > MESHLET_MAX_VERTICES || ml->triangle_count > MESHLET_MAX_TRIANGLES ||
+            (uint64_t)ml->vertex_offset + ml->vertex_count > header->num_meshlet_vertices ||
+            (uint64_t)ml->triangle_offset + 3 * (uint64_t)ml->triangle_count > header->total_indices)
+            return 0;
+        for (uint32_t k = 0; k < 3 * ml->triangle_count; k++)
+        {
+            if (triangles[ml->triangle_offset + k] >= ml->vertex_count)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+// checks that every material name is NUL-terminated
+static int meshcache_names_ok(const meshcache_header* header)
+{
+    const char* names = (const char*)header + header->material_names_offset;
+    for (uint32_t i = 0; i < header->num_materials; i++)
+    {
+        if (!memchr(names + (size_t)i * MESH_NAME_MAX, '\0', MESH_NAME_MAX))
+            return 0;
+    }
+    return 1;
+}
+
+int meshcache_map(const char* cache_path, uint64_t source_size, int64_t source_mtime, uint32_t flags, mesh* out)
+{
+    void* data = NULL;
+    size_t size = 0;
+
+#ifdef _WIN32
+    // no mmap; read the file into memory instead
+    FILE* file = fopen(cache_path, "rb");
+    if (!file)
+        return 1;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length < (long)sizeof(meshcache_header) || !(data = malloc(length)) ||
+        fread(data, 1, length, file) != (size_t)length)
+    {
+        free(data);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+    size = (size_t)length;
+#else
+    int fd = open(cache_path, O_RDONLY);
+    if (fd < 0)
+        return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(meshcache_header))
+    {
+        close(fd);
+        return 1;
+    }
+    size = (size_t)st.st_size;
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 1;
+#endif
+
+    const meshcache_header* header = data;
+    int valid = header->magic == MESHCACHE_MAGIC &&
+                header->version == MESHCACHE_VERSION &&
+                header->source_size == source_size &&
+                header->source_mtime == source_mtime &&
+                header->flags == flags &&
+                meshcache_section_ok(header->positions_offset, header->num_positions, sizeof(vec3f), size) &&
+                (header->uvs_offset == 0 || meshcache_section_ok(header->uvs_offset, header->num_positions, sizeof(vec2f), size)) &&
+                meshcache_section_ok(header->normals_offset, header->num_positions, sizeof(vec3f), size) &&
+                (header->material_ids_offset == 0 ||
+                 meshcache_section_ok(header->material_ids_offset, header->num_positions, sizeof(int32_t), size)) &&
+                meshcache_section_ok(header->material_names_offset, header->num_materials, MESH_NAME_MAX, size) &&
+                memchr(header->material_library, '\0', MESH_NAME_MAX) && meshcache_names_ok(header) &&
+                header->num_indices <= header->total_indices &&
+                meshcache_section_ok(header->indices_offset, header->total_indices, sizeof(int32_t), size) &&
+                header->meshlet_size == sizeof(meshlet) &&
+                meshcache_section_ok(header->meshlets_offset, header->num_meshlets, sizeof(meshlet), size) &&
+                meshcache_section_ok(header->meshlet_vertices_offset, header->num_meshlet_vertices, sizeof(int32_t), size) &&
+                meshcache_section_ok(header->meshlet_triangles_offset, header->total_indices, 1, size) &&
+                header->num_lods >= 1 && header->num_lods <= MESH_MAX_LODS &&
+                meshcache_section_ok(header->lods_offset, header->num_lods, sizeof(mesh_lod), size) &&
+                meshcache_lods_ok(header) && meshcache_contents_ok(header);
+    if (!valid)
+    {
+#ifdef _WIN32
+        free(data);
+#else
+        munmap(data, size);
+#endif
+        return 1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->positions = (vec3f*)((char*)data + header->positions_offset);
+    out->uvs = header->uvs_offset ? (vec2f*)((char*)data + header->uvs_offset) : NULL;
+    out->normals = (vec3f*)((char*)data + header->normals_offset);
+    out->material_ids = header->material_ids_offset ? (int*)((char*)data + header->material_ids_offset) : NULL;
+    out->num_positions = (int)header->num_positions;
+    out->indices = (int*)((char*)data + header->indices_offset);
+    out->num_indices = (int)header->num_indices;
+    out->bounds_min = (vec3f){header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]};
+    out->bounds_max = (vec3f){header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]};
+    out->meshlets = (meshlet*)((char*)data + header->meshlets_offset);
+    out->num_meshlets = (int)header->num_meshlets;
+    out->meshlet_vertices = (int*)((char*)data + header->meshlet_vertices_offset);
+    out->num_meshlet_vertices = (int)header->num_meshlet_vertices;
+    out->meshlet_triangles = (uint8_t*)data + header->meshlet_triangles_offset;
+    memcpy(out->material_library, header->material_library, MESH_NAME_MAX);
+    out->material_names = header->num_materials ? (char(*)[MESH_NAME_MAX])((char*)data + header->material_names_offset) : NULL;
+    out->num_materials = (int)header->num_materials;
+    out->num_lods = (int)header->num_lods;
+    memcpy(out->lods, (char*)data + header->lods_offset, header->num_lods * sizeof(mesh_lod));
+    out->mapping = data;
+    out->mapping_size = size;
+    return 0;
+}
+
+// writes `size` bytes at the current position, padded with zeros up to `offset` first
+static int meshcache_write_at(FILE* file, uint64_t* position, uint64_t offset, const void* data, size_t size)
+{
+    static const char zeros[MESHCACHE_ALIGN] = {0};
+    while (*position < offset)
+    {
+        size_t pad = offset - *position < sizeof(zeros) ? (size_t)(offset - *position) : sizeof(zeros);
+        if (fwrite(zeros, 1, pad, file) != pad)
+            return 1;
+        *position += pad;
+    }
+    if (size && fwrite(data, 1, size, file) != size)
+        return 1;
+    *position += size;
+    return 0;
+}
+
+int meshcache_write(const char* cache_path, const mesh* m, uint64_t source_size, int64_t source_mtime, uint32_t flags)
+{
+    meshcache_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESHCACHE_MAGIC;
+    header.version = MESHCACHE_VERSION;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.flags = flags;
+    header.num_positions = (uint32_t)m->num_positions;
+    header.num_indices = (uint32_t)m->num_indices;
+    header.bounds_min[0] = m->bounds_min.x;
+    header.bounds_min[1] = m->bounds_min.y;
+    header.bounds_min[2] = m->bounds_min.z;
+    header.bounds_max[0] = m->bounds_max.x;
+    header.bounds_max[1] = m->bounds_max.y;
+    header.bounds_max[2] = m->bounds_max.z;
+    header.positions_offset = meshcache_align(sizeof(header));
+    uint64_t positions_end = header.positions_offset + (uint64_t)m->num_positions * sizeof(vec3f);
+    if (m->uvs)
+    {
+        header.uvs_offset = meshcache_align(positions_end);
+        positions_end = header.uvs_offset + (uint64_t)m->num_positions * sizeof(vec2f);
+    }
+    header.normals_offset = meshcache_align(positions_end);
+    positions_end = header.normals_offset + (uint64_t)m->num_positions * sizeof(vec3f);
+    if (m->material_ids)
+    {
+        header.material_ids_offset = meshcache_align(positions_end);
+        positions_end = header.material_ids_offset + (uint64_t)m->num_positions * sizeof(int32_t);
+    }
+    header.indices_offset = meshcache_align(positions_end);
+    memcpy(header.material_library, m->material_library, MESH_NAME_MAX);
+    header.total_indices = (uint32_t)mesh_total_indices(m);
+    header.num_lods = (uint32_t)m->num_lods;
+    header.num_meshlets = (uint32_t)m->num_meshlets;
+    header.meshlet_size = sizeof(meshlet);
+    header.meshlets_offset = meshcache_align(header.indices_offset + (uint64_t)header.total_indices * sizeof(int32_t));
+    header.num_meshlet_vertices = (uint32_t)m->num_meshlet_vertices;
+    header.meshlet_vertices_offset = meshcache_align(header.meshlets_offset + (uint64_t)m->num_meshlets * sizeof(meshlet));
+    header.meshlet_triangles_offset = meshcache_align(header.meshlet_vertices_offset + (uint64_t)m->num_meshlet_vertices * sizeof(int32_t));
+    header.lods_offset = meshcache_align(header.meshlet_triangles_offset + header.total_indices);
+    header.num_materials = (uint32_t)m->num_materials;
+    header.material_names_offset = meshcache_align(header.lods_offset + (uint64_t)m->num_lods * sizeof(mesh_lod));
+
+    size_t path_length = strlen(cache_path);
+    char* temp_path = malloc(path_length + 5);
+    if (!temp_path)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+    memcpy(temp_path, cache_path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5);
+
+    FILE* file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        free(temp_path);
+        return 1;
+    }
+
+    uint64_t position = 0;
+    int failed = meshcache_write_at(file, &position, 0, &header, sizeof(header)) ||
+                 meshcache_write_at(file, &position, header.positions_offset, m->positions, m->num_positions * sizeof(vec3f)) ||
+                 (m->uvs && meshcache_write_at(file, &position, header.uvs_offset, m->uvs, m->num_positions * sizeof(vec2f))) ||
+                 meshcache_write_at(file, &position, header.normals_offset, m->normals, m->num_positions * sizeof(vec3f)) ||
+                 (m->material_ids && meshcache_write_at(file, &position, header.material_ids_offset, m->material_ids,
+                                                        m->num_positions * sizeof(int32_t))) ||
+                 meshcache_write_at(file, &position, header.indices_offset, m->indices, header.total_indices * sizeof(int32_t)) ||
+                 meshcache_write_at(file, &position, header.meshlets_offset, m->meshlets, m->num_meshlets * sizeof(meshlet)) ||
+                 meshcache_write_at(file, &position, header.meshlet_vertices_offset, m->meshlet_vertices,
+                                    m->num_meshlet_vertices * sizeof(int32_t)) ||
+                 meshcache_write_at(file, &position, header.meshlet_triangles_offset, m->meshlet_triangles, header.total_indices) ||
+                 meshcache_write_at(file, &position, header.lods_offset, m->lods, m->num_lods * sizeof(mesh_lod)) ||
+                 meshcache_write_at(file, &position, header.material_names_offset, m->material_names,
+                                    (size_t)m->num_materials * MESH_NAME_MAX);
+    failed = fclose(file) != 0 || failed;
+
+    // replace the old cache in one step; readers either see the old file or the complete new one
+    if (!failed)
+    {
+#ifdef _WIN32
+        remove(cache_path); // rename won't overwrite on Windows
+#endif
+        failed = rename(temp_path, cache_path) != 0;
+    }
+    if (failed)
+    {
+        remove(temp_path);
+    }
+    free(temp_path);
+    return failed;
+}
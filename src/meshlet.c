@@ -0,0 +1,196 @@
+// splitting meshes into small clusters with bounding spheres and normal cones, so they can be culled as a unit
+#include "meshlet.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mesh.h"
+
+static void* meshlet_alloc(size_t size)
+{
+    void* p = malloc(size ? size : 1);
+    if (!p)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    return p;
+}
+
+static vec3f meshlet_sub(vec3f a, vec3f b)
+{
+    return (vec3f){a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static float meshlet_dot(vec3f a, vec3f b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// bounding sphere and normal cone of a finished cluster
+static void meshlet_compute_bounds(meshlet* ml, const vec3f* positions, const int* vertices, const uint8_t* triangles)
+{
+    // sphere: around the box's center; not the tightest, but cheap and never too small
+    vec3f lo = positions[vertices[0]], hi = lo;
+    for (uint32_t i = 1; i < ml->vertex_count; i++)
+    {
+        vec3f p = positions[vertices[i]];
+        if (p.x < lo.x) lo.x = p.x;
+        if (p.y < lo.y) lo.y = p.y;
+        if (p.z < lo.z) lo.z = p.z;
+        if (p.x > hi.x) hi.x = p.x;
+        if (p.y > hi.y) hi.y = p.y;
+        if (p.z > hi.z) hi.z = p.z;
+    }
+    ml->center = (vec3f){(lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f};
+    float radius_sq = 0.0f;
+    for (uint32_t i = 0; i < ml->vertex_count; i++)
+    {
+        vec3f d = meshlet_sub(positions[vertices[i]], ml->center);
+        float r = meshlet_dot(d, d);
+        if (r > radius_sq)
+            radius_sq = r;
+    }
+    // a hair larger, so rounding in the sphere tests can't cut off a vertex on the surface
+    ml->radius = sqrtf(radius_sq) * 1.0001f;
+
+    // cone: the axis is the average unit normal, and the spread is the widest angle any normal makes with it
+    vec3f normals[MESHLET_MAX_TRIANGLES];
+    int num_normals = 0;
+    vec3f axis = {0.0f, 0.0f, 0.0f};
+    for (uint32_t t = 0; t < ml->triangle_count; t++)
+    {
+        vec3f a = positions[vertices[triangles[t * 3]]];
+        vec3f b = positions[vertices[triangles[t * 3 + 1]]];
+        vec3f c = positions[vertices[triangles[t * 3 + 2]]];
+        vec3f e1 = meshlet_sub(b, a), e2 = meshlet_sub(c, a);
+        vec3f n = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+        float length = sqrtf(meshlet_dot(n, n));
+        if (length == 0.0f)
+            continue; // degenerate triangles face nowhere and can't be seen anyway
+        n = (vec3f){n.x / length, n.y / length, n.z / length};
+        normals[num_normals++] = n;
+        axis = (vec3f){axis.x + n.x, axis.y + n.y, axis.z + n.z};
+    }
+
+    float axis_length = sqrtf(meshlet_dot(axis, axis));
+    ml->cone_axis = (vec3f){0.0f, 0.0f, 0.0f};
+    ml->cone_cutoff = 1.0f;
+    if (num_normals == 0 || axis_length == 0.0f)
+        return;
+    axis = (vec3f){axis.x / axis_length, axis.y / axis_length, axis.z / axis_length};
+
+    float min_dot = 1.0f;
+    for (int i = 0; i < num_normals; i++)
+    {
+        float d = meshlet_dot(axis, normals[i]);
+        if (d < min_dot)
+            min_dot = d;
+    }
+    ml->cone_axis = axis;
+    // a cone of 90 degrees or more can be seen from the front from anywhere
+    if (min_dot > 0.0f)
+    {
+        ml->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+    }
+}
+
+void meshlet_build(mesh* m)
+{
+    if (m->num_lods == 0)
+    {
+        m->lods[0] = (mesh_lod){0, (uint32_t)m->num_indices, 0, 0, 0.0f};
+        m->num_lods = 1;
+    }
+    int total_indices = mesh_total_indices(m);
+
+    // a triangle adds at most 3 vertices, so a cluster only fills up after 21 triangles or more; and every vertex
+    // slot of every cluster is a corner of some triangle
+    size_t max_meshlets = (size_t)total_indices / 3 / (MESHLET_MAX_VERTICES / 3) + (size_t)m->num_lods;
+    meshlet* meshlets = meshlet_alloc(max_meshlets * sizeof(meshlet));
+    int* vertices = meshlet_alloc((size_t)total_indices * sizeof(int));
+    uint8_t* triangles = meshlet_alloc((size_t)total_indices);
+
+    // mesh vertex -> local number in the cluster being built, or 0xff
+    uint8_t* local = meshlet_alloc((size_t)m->num_positions);
+    memset(local, 0xff, (size_t)m->num_positions);
+
+    int num_meshlets = 0;
+    int num_vertices = 0;
+    for (int l = 0; l < m->num_lods; l++)
+    {
+        // clusters never span two levels; triangle offsets are positions in the whole index list
+        mesh_lod* lod = &m->lods[l];
+        lod->meshlet_offset = (uint32_t)num_meshlets;
+        int first = (int)lod->index_offset / 3;
+        int end = first + (int)lod->index_count / 3;
+
+        meshlet* current = &meshlets[num_meshlets];
+        memset(current, 0, sizeof(*current));
+        current->vertex_offset = (uint32_t)num_vertices;
+        current->triangle_offset = (uint32_t)(first * 3);
+
+        for (int t = first; t < end; t++)
+        {
+            const int* tri = &m->indices[t * 3];
+            int new_vertices = (local[tri[0]] == 0xff) + (local[tri[1]] == 0xff && tri[1] != tri[0]) +
+                               (local[tri[2]] == 0xff && tri[2] != tri[0] && tri[2] != tri[1]);
+
+            // close the cluster when this triangle doesn't fit
+            if (current->vertex_count + new_vertices > MESHLET_MAX_VERTICES || current->triangle_count == MESHLET_MAX_TRIANGLES)
+            {
+                meshlet_compute_bounds(current, m->positions, vertices + current->vertex_offset, triangles + current->triangle_offset);
+                for (uint32_t i = 0; i < current->vertex_count; i++)
+                {
+                    local[vertices[current->vertex_offset + i]] = 0xff;
+                }
+                current = &meshlets[++num_meshlets];
+                memset(current, 0, sizeof(*current));
+                current->vertex_offset = (uint32_t)num_vertices;
+                current->triangle_offset = (uint32_t)(t * 3);
+            }
+
+            for (int k = 0; k < 3; k++)
+            {
+                int v = tri[k];
+                if (local[v] == 0xff)
+                {
+                    local[v] = (uint8_t)current->vertex_count++;
+                    vertices[num_vertices++] = v;
+                }
+                triangles[t * 3 + k] = local[v];
+            }
+            current->triangle_count++;
+        }
+        if (current->triangle_count > 0)
+        {
+            meshlet_compute_bounds(current, m->positions, vertices + current->vertex_offset, triangles + current->triangle_offset);
+            for (uint32_t i = 0; i < current->vertex_count; i++)
+            {
+                local[vertices[current->vertex_offset + i]] = 0xff;
+            }
+            num_meshlets++;
+        }
+        lod->meshlet_count = (uint32_t)num_meshlets - lod->meshlet_offset;
+    }
+    free(local);
+
+    // give back what the worst-case sizing didn't use; if shrinking fails, the bigger block is still fine
+    meshlet* shrunk_meshlets = realloc(meshlets, ((size_t)num_meshlets + 1) * sizeof(meshlet));
+    int* shrunk_vertices = realloc(vertices, ((size_t)num_vertices + 1) * sizeof(int));
+    m->meshlets = shrunk_meshlets ? shrunk_meshlets : meshlets;
+    m->num_meshlets = num_meshlets;
+    m->meshlet_vertices = shrunk_vertices ? shrunk_vertices : vertices;
+    m->num_meshlet_vertices = num_vertices;
+    m->meshlet_triangles = triangles;
+}
+
+int meshlet_backfacing(const meshlet* ml, vec3f camera)
+{
+    // the cone apex could be anywhere in the sphere, so the test is against the whole sphere: the camera has to be
+    // behind every plane through the sphere whose normal lies in the cone
+    vec3f to_center = meshlet_sub(ml->center, camera);
+    float distance = sqrtf(meshlet_dot(to_center, to_center));
+    return meshlet_dot(to_center, ml->cone_axis) >= ml->cone_cutoff * distance + ml->radius;
+}
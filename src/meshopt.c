@@ -0,0 +1,503 @@
+// load-time mesh optimization: welding, vertex cache ordering, overdraw ordering and vertex fetch ordering
+#include "meshopt.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// allocation that exits on failure, like the rest of the loaders
+static void* meshopt_alloc(size_t size)
+{
+    void* p = malloc(size ? size : 1);
+    if (!p)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    return p;
+}
+
+// murmur3's finalizer: every input bit affects every output bit
+static uint32_t meshopt_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t meshopt_hash_position(vec3f p)
+{
+    // + 0.0f turns -0 into +0 so both hash (and compare) the same
+    float f[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+    uint32_t bits[3];
+    memcpy(bits, f, sizeof(bits));
+    // mix after every coordinate; grid-aligned positions differ in only a few bits, and combining them before mixing
+    // makes different positions collide outright, which linear probing punishes badly
+    return meshopt_mix(meshopt_mix(meshopt_mix(bits[0]) ^ bits[1]) ^ bits[2]);
+}
+
+static int meshopt_same_position(vec3f a, vec3f b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// texture coordinates compare bit for bit, after the same -0 folding as positions
+static int meshopt_same_uv(const vec2f* uvs, int a, int b)
+{
+    return !uvs || (uvs[a].x == uvs[b].x && uvs[a].y == uvs[b].y);
+}
+
+static uint32_t meshopt_hash_uv(vec2f t)
+{
+    float f[2] = { t.x + 0.0f, t.y + 0.0f };
+    uint32_t bits[2];
+    memcpy(bits, f, sizeof(bits));
+    return meshopt_mix(meshopt_mix(bits[0]) ^ bits[1]);
+}
+
+// everything besides the position that keeps two vertices apart: texture coordinates, normals and materials
+static int meshopt_same_attributes(const vec2f* uvs, const vec3f* normals, const int* material_ids, int a, int b)
+{
+    return meshopt_same_uv(uvs, a, b) && (!normals || meshopt_same_position(normals[a], normals[b])) &&
+           (!material_ids || material_ids[a] == material_ids[b]);
+}
+
+static int meshopt_remap(const vec3f* positions, const vec2f* uvs, const vec3f* normals, const int* material_ids,
+                         int num_positions, int* remap)
+{
+    if (num_positions == 0)
+        return 0;
+
+    // open addressing, at most half full; slots hold the first vertex seen with each position
+    int table_size = 1;
+    while (table_size < num_positions * 2)
+    {
+        table_size <<= 1;
+    }
+    int* table = meshopt_alloc(table_size * sizeof(int));
+    for (int i = 0; i < table_size; i++)
+    {
+        table[i] = -1;
+    }
+
+    int unique = 0;
+    for (int i = 0; i < num_positions; i++)
+    {
+        vec3f p = positions[i];
+        uint32_t hash = meshopt_hash_position(p);
+        if (uvs)
+        {
+            hash = meshopt_mix(hash ^ meshopt_hash_uv(uvs[i]));
+        }
+        if (normals)
+        {
+            hash = meshopt_mix(hash ^ meshopt_hash_position(normals[i]));
+        }
+        if (material_ids)
+        {
+            hash = meshopt_mix(hash ^ (uint32_t)material_ids[i]);
+        }
+        uint32_t slot = hash & (table_size - 1);
+        while (table[slot] >= 0 && !(meshopt_same_position(positions[table[slot]], p) &&
+                                     meshopt_same_attributes(uvs, normals, material_ids, table[slot], i)))
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] < 0)
+        {
+            table[slot] = i;
+            unique++;
+        }
+        remap[i] = table[slot];
+    }
+
+    free(table);
+    return unique;
+}
+
+int meshopt_position_remap(const vec3f* positions, int num_positions, int* remap)
+{
+    return meshopt_remap(positions, NULL, NULL, NULL, num_positions, remap);
+}
+
+int meshopt_vertex_remap(const mesh* m, int* remap)
+{
+    return meshopt_remap(m->positions, m->uvs, m->normals, m->material_ids, m->num_positions, remap);
+}
+
+void meshopt_weld(mesh* m)
+{
+    int n = m->num_positions;
+    if (n == 0)
+        return;
+
+    int* remap = meshopt_alloc(n * sizeof(int));
+    meshopt_vertex_remap(m, remap);
+
+    // first occurrences move down to their place among the unique positions; duplicates follow their first
+    // occurrence, which always comes earlier and so has already moved
+    int unique = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (remap[i] == i)
+        {
+            m->positions[unique] = m->positions[i];
+            if (m->uvs)
+            {
+                m->uvs[unique] = m->uvs[i];
+            }
+            if (m->normals)
+            {
+                m->normals[unique] = m->normals[i];
+            }
+            if (m->material_ids)
+            {
+                m->material_ids[unique] = m->material_ids[i];
+            }
+            remap[i] = unique++;
+        }
+        else
+        {
+            remap[i] = remap[remap[i]];
+        }
+    }
+
+    for (int i = 0; i < m->num_indices; i++)
+    {
+        m->indices[i] = remap[m->indices[i]];
+    }
+    m->num_positions = unique;
+
+    free(remap);
+}
+
+/*
+    Tipsify, more or less as in the paper. The output is grown by "fanning" around one vertex at a time: every
+    triangle still unemitted around it gets emitted. The next fanning vertex is picked among the vertices just touched,
+    preferring ones that will still be in the cache after their remaining triangles are emitted; if none qualifies,
+    the most recently touched vertex with triangles left is used (the dead-end stack), and failing that, the next
+    vertex in input order. The last two are jumps across the mesh, and that's where clusters are split.
+*/
+int meshopt_optimize_vertex_cache(int* indices, int num_indices, int num_vertices, int* clusters)
+{
+    int num_triangles = num_indices / 3;
+    if (num_triangles == 0 || num_vertices == 0)
+    {
+        if (clusters)
+            clusters[0] = num_triangles;
+        return 0;
+    }
+
+    // vertex -> triangles adjacency, as offsets into one array
+    int* live = calloc(num_vertices, sizeof(int));      // triangles not yet emitted, per vertex
+    int* adjacency_start = meshopt_alloc((num_vertices + 1) * sizeof(int));
+    int* adjacency = meshopt_alloc(num_indices * sizeof(int));
+    int* timestamp = calloc(num_vertices, sizeof(int)); // when the vertex last entered the cache
+    char* emitted = calloc(num_triangles, 1);
+    int* dead_end = meshopt_alloc(num_indices * sizeof(int)); // every vertex is pushed at most once per corner
+    int* candidates = meshopt_alloc(num_indices * sizeof(int));
+    int* output = meshopt_alloc(num_indices * sizeof(int));
+    if (!live || !timestamp || !emitted)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < num_indices; i++)
+    {
+        live[indices[i]]++;
+    }
+    adjacency_start[0] = 0;
+    for (int v = 0; v < num_vertices; v++)
+    {
+        adjacency_start[v + 1] = adjacency_start[v] + live[v];
+    }
+    int* fill = meshopt_alloc(num_vertices * sizeof(int));
+    memcpy(fill, adjacency_start, num_vertices * sizeof(int));
+    for (int i = 0; i < num_indices; i++)
+    {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+    free(fill);
+
+    const int cache = MESHOPT_CACHE_SIZE;
+    int time = cache + 1;
+    int cursor = 0;         // scan position for the "next vertex in input order" fallback
+    int dead_end_top = 0;
+    int out = 0;
+    int num_clusters = 0;
+    int fanning = 0;
+    if (clusters)
+        clusters[num_clusters] = 0;
+    num_clusters++;
+
+    while (fanning >= 0)
+    {
+        int num_candidates = 0;
+        for (int a = adjacency_start[fanning]; a < adjacency_start[fanning + 1]; a++)
+        {
+            int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = 1;
+
+            for (int k = 0; k < 3; k++)
+            {
+                int v = indices[t * 3 + k];
+                output[out++] = v;
+                dead_end[dead_end_top++] = v;
+                candidates[num_candidates++] = v;
+                live[v]--;
+                if (time - timestamp[v] > cache)
+                {
+                    timestamp[v] = time++;
+                }
+            }
+        }
+
+        // best candidate: still has triangles, and fanning it now keeps it in the cache; older is better
+        int best = -1;
+        int best_priority = -1;
+        for (int c = 0; c < num_candidates; c++)
+        {
+            int v = candidates[c];
+            if (live[v] <= 0)
+                continue;
+            int priority = 0;
+            if (time - timestamp[v] + 2 * live[v] <= cache)
+            {
+                priority = time - timestamp[v];
+            }
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                best = v;
+            }
+        }
+
+        if (best < 0)
+        {
+            // dead end: jump to whatever we touched most recently that still has work, or failing that, anywhere
+            while (dead_end_top > 0 && best < 0)
+            {
+                int v = dead_end[--dead_end_top];
+                if (live[v] > 0)
+                    best = v;
+            }
+            while (best < 0 && cursor < num_vertices)
+            {
+                if (live[cursor] > 0)
+                    best = cursor;
+                else
+                    cursor++;
+            }
+            if (best >= 0 && out / 3 > (clusters ? clusters[num_clusters - 1] : 0))
+            {
+                if (clusters)
+                    clusters[num_clusters] = out / 3;
+                num_clusters++;
+            }
+        }
+        fanning = best;
+    }
+
+    memcpy(indices, output, num_indices * sizeof(int));
+    if (clusters)
+        clusters[num_clusters] = num_triangles;
+
+    free(output);
+    free(candidates);
+    free(dead_end);
+    free(emitted);
+    free(timestamp);
+    free(adjacency);
+    free(adjacency_start);
+    free(live);
+    return num_clusters;
+}
+
+typedef struct meshopt_cluster_key
+{
+    float key;
+    int cluster;
+} meshopt_cluster_key;
+
+static int meshopt_compare_keys(const void* a, const void* b)
+{
+    const meshopt_cluster_key* x = a;
+    const meshopt_cluster_key* y = b;
+    // descending by key; ties keep their original order so the result doesn't depend on qsort
+    if (x->key != y->key)
+        return x->key < y->key ? 1 : -1;
+    return x->cluster - y->cluster;
+}
+
+void meshopt_optimize_overdraw(const vec3f* positions, int* indices, int num_indices, const int* clusters, int num_clusters)
+{
+    if (num_clusters <= 1)
+        return;
+
+    // the mesh's center, weighted by triangle area
+    double center[3] = {0, 0, 0};
+    double total_area = 0.0;
+    int num_triangles = num_indices / 3;
+    for (int t = 0; t < num_triangles; t++)
+    {
+        vec3f a = positions[indices[t * 3]], b = positions[indices[t * 3 + 1]], c = positions[indices[t * 3 + 2]];
+        vec3f e1 = {b.x - a.x, b.y - a.y, b.z - a.z};
+        vec3f e2 = {c.x - a.x, c.y - a.y, c.z - a.z};
+        vec3f n = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+        double area = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+        center[0] += area * (a.x + b.x + c.x) / 3.0;
+        center[1] += area * (a.y + b.y + c.y) / 3.0;
+        center[2] += area * (a.z + b.z + c.z) / 3.0;
+        total_area += area;
+    }
+    if (total_area > 0.0)
+    {
+        center[0] /= total_area;
+        center[1] /= total_area;
+        center[2] /= total_area;
+    }
+
+    // per cluster: how far its centroid sits out from the center along its average normal
+    meshopt_cluster_key* keys = meshopt_alloc(num_clusters * sizeof(meshopt_cluster_key));
+    for (int c = 0; c < num_clusters; c++)
+    {
+        double centroid[3] = {0, 0, 0}, normal[3] = {0, 0, 0}, area_sum = 0.0;
+        for (int t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            vec3f a = positions[indices[t * 3]], b = positions[indices[t * 3 + 1]], d = positions[indices[t * 3 + 2]];
+            vec3f e1 = {b.x - a.x, b.y - a.y, b.z - a.z};
+            vec3f e2 = {d.x - a.x, d.y - a.y, d.z - a.z};
+            // the unnormalized cross product is already area-weighted
+            double n[3] = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+            double area = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            centroid[0] += area * (a.x + b.x + d.x) / 3.0;
+            centroid[1] += area * (a.y + b.y + d.y) / 3.0;
+            centroid[2] += area * (a.z + b.z + d.z) / 3.0;
+            normal[0] += n[0];
+            normal[1] += n[1];
+            normal[2] += n[2];
+            area_sum += area;
+        }
+
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        if (area_sum > 0.0 && length > 0.0)
+        {
+            key = (float)(((centroid[0] / area_sum - center[0]) * normal[0] +
+                           (centroid[1] / area_sum - center[1]) * normal[1] +
+                           (centroid[2] / area_sum - center[2]) * normal[2]) / length);
+        }
+        keys[c].key = key;
+        keys[c].cluster = c;
+    }
+    qsort(keys, num_clusters, sizeof(meshopt_cluster_key), meshopt_compare_keys);
+
+    int* sorted = meshopt_alloc(num_indices * sizeof(int));
+    int out = 0;
+    for (int k = 0; k < num_clusters; k++)
+    {
+        int c = keys[k].cluster;
+        int count = (clusters[c + 1] - clusters[c]) * 3;
+        memcpy(sorted + out, indices + clusters[c] * 3, count * sizeof(int));
+        out += count;
+    }
+    memcpy(indices, sorted, num_indices * sizeof(int));
+
+    free(sorted);
+    free(keys);
+}
+
+void meshopt_optimize_vertex_fetch(mesh* m)
+{
+    int n = m->num_positions;
+    int* remap = meshopt_alloc(n * sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        remap[i] = -1;
+    }
+
+    vec3f* positions = meshopt_alloc(n * sizeof(vec3f));
+    vec2f* uvs = m->uvs ? meshopt_alloc(n * sizeof(vec2f)) : NULL;
+    vec3f* normals = m->normals ? meshopt_alloc(n * sizeof(vec3f)) : NULL;
+    int* material_ids = m->material_ids ? meshopt_alloc(n * sizeof(int)) : NULL;
+    int next = 0;
+    for (int i = 0; i < m->num_indices; i++)
+    {
+        int v = m->indices[i];
+        if (remap[v] < 0)
+        {
+            remap[v] = next;
+            if (uvs)
+            {
+                uvs[next] = m->uvs[v];
+            }
+            if (normals)
+            {
+                normals[next] = m->normals[v];
+            }
+            if (material_ids)
+            {
+                material_ids[next] = m->material_ids[v];
+            }
+            positions[next++] = m->positions[v];
+        }
+        m->indices[i] = remap[v];
+    }
+
+    free(m->positions);
+    free(m->uvs);
+    free(m->normals);
+    free(m->material_ids);
+    m->positions = positions;
+    m->uvs = uvs;
+    m->normals = normals;
+    m->material_ids = material_ids;
+    m->num_positions = next;
+    free(remap);
+}
+
+float meshopt_acmr(const int* indices, int num_indices, int num_vertices)
+{
+    if (num_indices < 3)
+        return 0.0f;
+
+    // FIFO cache: a vertex is a hit if it entered the cache fewer than MESHOPT_CACHE_SIZE misses ago
+    int* entered = meshopt_alloc(num_vertices * sizeof(int));
+    for (int i = 0; i < num_vertices; i++)
+    {
+        entered[i] = -MESHOPT_CACHE_SIZE - 1;
+    }
+    int misses = 0;
+    for (int i = 0; i < num_indices; i++)
+    {
+        int v = indices[i];
+        if (misses - entered[v] > MESHOPT_CACHE_SIZE)
+        {
+            entered[v] = misses;
+            misses++;
+        }
+    }
+    free(entered);
+    return (float)misses / (num_indices / 3);
+}
+
+void meshopt_optimize(mesh* m)
+{
+    meshopt_weld(m);
+
+    int* clusters = meshopt_alloc((m->num_indices / 3 + 1) * sizeof(int));
+    int num_clusters = meshopt_optimize_vertex_cache(m->indices, m->num_indices, m->num_positions, clusters);
+    meshopt_optimize_overdraw(m->positions, m->indices, m->num_indices, clusters, num_clusters);
+    free(clusters);
+
+    meshopt_optimize_vertex_fetch(m);
+    mesh_compute_bounds(m);
+}
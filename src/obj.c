@@ -0,0 +1,1001 @@
+// Wavefront .obj loading: memory-mapped, hand-parsed, and split across threads for big files
+/*
+    The file is cut into one chunk per thread, each ending on a line boundary, and every chunk is parsed on its own
+    into local arrays. The only thing a chunk can't know is how many vertices come before it, which matters for
+    relative (negative) face indices; those are recorded as relative to the chunk's start and patched up once a
+    prefix sum over the chunks' vertex counts has given every chunk its base. Absolute indices need no patching.
+    The chunks are then concatenated in file order, so the result doesn't depend on the thread count.
+    Texture coordinate and normal indices go through the same steps, against their own bases.
+
+    Faces index positions, texture coordinates and normals separately, and `usemtl` switches materials between
+    faces, but the pipeline wants one index per vertex; so once everything is merged, each distinct (position,
+    texture coordinate, normal, material) combination is made a vertex of its own.
+*/
+// mmap and posix_madvise are POSIX, not C99
+#define _POSIX_C_SOURCE 200112L
+#include "obj.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threadpool.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// files smaller than this are parsed on one thread; splitting them isn't worth waking the others
+#define OBJ_MIN_CHUNK_BYTES (4 * 1024 * 1024)
+// texture coordinate or normal index of a corner that has none; nothing relative can come out as this
+#define OBJ_NO_REF INT_MIN
+
+// the per-corner attributes faces index separately from positions
+#define OBJ_TEXCOORDS 0 // `vt`
+#define OBJ_NORMALS 1   // `vn`
+#define OBJ_STREAMS 2
+static const int obj_stream_width[OBJ_STREAMS] = { 2, 3 };
+static const char* const obj_stream_name[OBJ_STREAMS] = { "Texture coordinate", "Normal" };
+
+// one of those attributes, as one chunk parsed it
+typedef struct obj_stream
+{
+    float* values; // obj_stream_width floats each
+    int num_values;
+    int value_alloc;
+
+    // index into `values` per entry of the chunk's `indices`; only allocated once a corner in the chunk has one, so
+    // files without this attribute don't pay for it
+    int* corners;
+    int corner_alloc;
+
+    // entries of `corners` counted from the first value of this chunk
+    int* relative;
+    int num_relative;
+    int relative_alloc;
+} obj_stream;
+
+typedef struct obj_chunk
+{
+    const char* begin;
+    const char* end;
+
+    vec3f* positions;
+    int num_positions;
+    int position_alloc;
+
+    int* indices;
+    int num_indices;
+    int index_alloc;
+
+    // entries of `indices` that hold relative indices, i.e. counted from the first vertex of this chunk
+    int* relative;
+    int num_relative;
+    int relative_alloc;
+
+    obj_stream streams[OBJ_STREAMS];
+
+    char material_library[OBJ_NAME_MAX];
+    // the chunk's `usemtl` lines: each name, and the entry of `indices` from which on it applies
+    char (*materials)[OBJ_NAME_MAX];
+    int* material_starts;
+    int num_materials;
+    int material_alloc;
+
+    int line;  // line number of the first line that failed, or 0
+    int error;
+} obj_chunk;
+
+// doubles an array until it fits `needed` elements; exits on failure like the rest of the loaders
+static void* obj_reserve(void* array, int* capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
+        return array;
+    int grown = *capacity ? *capacity : 1024;
+    while (grown < needed)
+    {
+        grown *= 2;
+    }
+    array = realloc(array, (size_t)grown * element_size);
+    if (!array)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    *capacity = grown;
+    return array;
+}
+
+static inline int obj_is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static inline int obj_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static const char* obj_skip_space(const char* p, const char* end)
+{
+    while (p < end && obj_is_space(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+// exact powers of ten; every one of them is representable in a double
+static const double obj_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+    Parses a decimal float ([+-]digits[.digits][(e|E)[+-]digits]). Digits are gathered into a 64-bit integer and
+    scaled by an exact power of ten, which is exact or within an ulp for anything an .obj exporter writes, and far
+    faster than strtof. Returns the position after the number, or NULL if there isn't one.
+*/
+static const char* obj_parse_float(const char* p, const char* end, float* out)
+{
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && obj_is_digit(*p); p++, digits++)
+    {
+        if (mantissa < 100000000000000000ull)
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        else
+            exponent++; // past 17 significant digits, only the magnitude matters
+    }
+    if (p < end && *p == '.')
+    {
+        p++;
+        for (; p < end && obj_is_digit(*p); p++, digits++)
+        {
+            if (mantissa < 100000000000000000ull)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0)
+        return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        int exp_negative = 0;
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            exp_negative = *q == '-';
+            q++;
+        }
+        if (q < end && obj_is_digit(*q))
+        {
+            int e = 0;
+            for (; q < end && obj_is_digit(*q); q++)
+            {
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+            }
+            exponent += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0)
+        value = exponent >= -22 ? value / obj_pow10[-exponent] : value * pow(10.0, exponent);
+    else if (exponent > 0)
+        value = exponent <= 22 ? value * obj_pow10[exponent] : value * pow(10.0, exponent);
+
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+// parses a signed decimal integer of at most INT_MAX in magnitude; returns the position after it, or NULL if there
+// isn't one or it is bigger, so an index too big for an int is malformed instead of wrapping onto a real vertex
+static const char* obj_parse_int(const char* p, const char* end, long* out)
+{
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+    if (p >= end || !obj_is_digit(*p))
+        return NULL;
+
+    long value = 0;
+    for (; p < end && obj_is_digit(*p); p++)
+    {
+        int digit = *p - '0';
+        if (value > (INT_MAX - digit) / 10)
+            return NULL;
+        value = value * 10 + digit;
+    }
+    *out = negative ? -value : value;
+    return p;
+}
+
+// records which value of a stream corner `corner` uses; `ref` is the .obj index, or 0 if the corner has none
+static void obj_stream_add_corner(obj_stream* stream, int corner, long ref, int index_alloc)
+{
+    if (ref == 0 && !stream->corners)
+        return;
+    if (!stream->corners)
+    {
+        // the first corner with one; the ones before it had none
+        stream->corners = obj_reserve(NULL, &stream->corner_alloc, index_alloc, sizeof(int));
+        for (int i = 0; i < corner; i++)
+        {
+            stream->corners[i] = OBJ_NO_REF;
+        }
+    }
+    stream->corners = obj_reserve(stream->corners, &stream->corner_alloc, corner + 1, sizeof(int));
+    if (ref == 0)
+    {
+        stream->corners[corner] = OBJ_NO_REF;
+    }
+    else if (ref > 0)
+    {
+        stream->corners[corner] = (int)(ref - 1);
+    }
+    else
+    {
+        stream->relative = obj_reserve(stream->relative, &stream->relative_alloc, stream->num_relative + 1, sizeof(int));
+        stream->relative[stream->num_relative++] = corner;
+        stream->corners[corner] = (int)(stream->num_values + ref);
+    }
+}
+
+// appends one triangle corner, resolving the .obj indices to 0-based; `refs` holds its texture coordinate and normal
+// indices, 0 for the ones it doesn't have
+static int obj_add_corner(obj_chunk* chunk, long index, const long refs[OBJ_STREAMS])
+{
+    if (index == 0)
+        return 1; // .obj indices start at 1; 0 is never valid
+
+    int corner = chunk->num_indices;
+    chunk->indices = obj_reserve(chunk->indices, &chunk->index_alloc, corner + 1, sizeof(int));
+    if (index > 0)
+    {
+        chunk->indices[corner] = (int)(index - 1);
+    }
+    else
+    {
+        // -1 is the most recent vertex; store it counted from this chunk's first vertex and fix it up after the merge
+        chunk->relative = obj_reserve(chunk->relative, &chunk->relative_alloc, chunk->num_relative + 1, sizeof(int));
+        chunk->relative[chunk->num_relative++] = corner;
+        chunk->indices[corner] = (int)(chunk->num_positions + index);
+    }
+    chunk->num_indices++;
+
+    for (int k = 0; k < OBJ_STREAMS; k++)
+    {
+        obj_stream_add_corner(&chunk->streams[k], corner, refs[k], chunk->index_alloc);
+    }
+    return 0;
+}
+
+// one of the "/vt" and "/vn" parts of a face corner; `p` is just past the slash. An empty part is fine ("v//vn")
+static const char* obj_parse_ref(const char* p, const char* end, long* out)
+{
+    *out = 0;
+    if (p >= end || !(obj_is_digit(*p) || *p == '-' || *p == '+'))
+        return p;
+    p = obj_parse_int(p, end, out);
+    return p && *out != 0 ? p : NULL;
+}
+
+// parses an `f` line (after the "f"), fan-triangulating it into the chunk's index list
+static int obj_parse_face(obj_chunk* chunk, const char* p, const char* end)
+{
+    long first = 0, previous = 0;
+    long first_refs[OBJ_STREAMS] = {0}, previous_refs[OBJ_STREAMS] = {0};
+    int corners = 0;
+
+    for (;;)
+    {
+        p = obj_skip_space(p, end);
+        if (p >= end || *p == '#')
+            break;
+
+        long v;
+        p = obj_parse_int(p, end, &v);
+        if (!p)
+            return 1;
+        // "v/vt", "v//vn" and "v/vt/vn"
+        long refs[OBJ_STREAMS] = {0};
+        if (p < end && *p == '/')
+        {
+            p = obj_parse_ref(p + 1, end, &refs[OBJ_TEXCOORDS]);
+            if (p && p < end && *p == '/')
+                p = obj_parse_ref(p + 1, end, &refs[OBJ_NORMALS]);
+            if (!p)
+                return 1;
+        }
+        if (p < end && !obj_is_space(*p))
+            return 1;
+
+        if (corners == 0)
+        {
+            first = v;
+            memcpy(first_refs, refs, sizeof(refs));
+        }
+        else if (corners >= 2)
+        {
+            if (obj_add_corner(chunk, first, first_refs) || obj_add_corner(chunk, previous, previous_refs) ||
+                obj_add_corner(chunk, v, refs))
+                return 1;
+        }
+        previous = v;
+        memcpy(previous_refs, refs, sizeof(refs));
+        corners++;
+    }
+    return corners < 3;
+}
+
+static int obj_parse_vertex(obj_chunk* chunk, const char* p, const char* end)
+{
+    vec3f v;
+    p = obj_parse_float(obj_skip_space(p, end), end, &v.x);
+    if (p) p = obj_parse_float(obj_skip_space(p, end), end, &v.y);
+    if (p) p = obj_parse_float(obj_skip_space(p, end), end, &v.z);
+    if (!p)
+        return 1;
+    // an optional w (or vertex color) may follow; it isn't used
+
+    chunk->positions = obj_reserve(chunk->positions, &chunk->position_alloc, chunk->num_positions + 1, sizeof(vec3f));
+    chunk->positions[chunk->num_positions++] = v;
+    return 0;
+}
+
+// a `vt` (u, optional v, optional w) or `vn` (x, y, z) line; only the first obj_stream_width values are kept
+static int obj_parse_stream_value(obj_stream* stream, int kind, const char* p, const char* end)
+{
+    float value[3] = {0.0f, 0.0f, 0.0f};
+    int width = obj_stream_width[kind];
+    for (int i = 0; i < width; i++)
+    {
+        const char* next = obj_parse_float(obj_skip_space(p, end), end, &value[i]);
+        if (!next)
+        {
+            // a texture coordinate's v is optional
+            if (kind == OBJ_TEXCOORDS && i > 0)
+                break;
+            return 1;
+        }
+        p = next;
+    }
+
+    stream->values = obj_reserve(stream->values, &stream->value_alloc, (stream->num_values + 1) * width, sizeof(float));
+    memcpy(stream->values + (size_t)stream->num_values * width, value, width * sizeof(float));
+    stream->num_values++;
+    return 0;
+}
+
+// copies the rest of a line, trimmed, into `name`; 1 if there's nothing there
+static int obj_parse_name(char* name, const char* p, const char* end)
+{
+    p = obj_skip_space(p, end);
+    while (end > p && obj_is_space(end[-1]))
+    {
+        end--;
+    }
+    if (p == end)
+        return 1;
+    size_t length = (size_t)(end - p) < OBJ_NAME_MAX - 1 ? (size_t)(end - p) : OBJ_NAME_MAX - 1;
+    memcpy(name, p, length);
+    name[length] = '\0';
+    return 0;
+}
+
+// a `usemtl` line: the faces after it use this material
+static int obj_parse_usemtl(obj_chunk* chunk, const char* p, const char* end)
+{
+    int n = chunk->num_materials;
+    if (n == chunk->material_alloc)
+    {
+        // files switch materials a handful of times, not once per face, so this starts small
+        chunk->material_alloc = n ? n * 2 : 8;
+        chunk->materials = realloc(chunk->materials, (size_t)chunk->material_alloc * OBJ_NAME_MAX);
+        chunk->material_starts = realloc(chunk->material_starts, (size_t)chunk->material_alloc * sizeof(int));
+        if (!chunk->materials || !chunk->material_starts)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    if (obj_parse_name(chunk->materials[n], p, end) != 0)
+        return 1;
+    chunk->material_starts[n] = chunk->num_indices;
+    chunk->num_materials++;
+    return 0;
+}
+
+// does the line start with this keyword, followed by a space?
+static int obj_keyword(const char* s, const char* eol, const char* keyword, size_t length)
+{
+    return (size_t)(eol - s) > length && memcmp(s, keyword, length) == 0 && obj_is_space(s[length]);
+}
+
+static void obj_parse_chunk(void* data, int index, int worker)
+{
+    (void)worker;
+    obj_chunk* chunk = &((obj_chunk*)data)[index];
+
+    int line = 0;
+    const char* p = chunk->begin;
+    while (p < chunk->end)
+    {
+        const char* eol = memchr(p, '\n', chunk->end - p);
+        if (!eol)
+            eol = chunk->end;
+        line++;
+
+        const char* s = obj_skip_space(p, eol);
+        int failed = 0;
+        if (eol - s >= 2 && s[0] == 'v' && obj_is_space(s[1]))
+            failed = obj_parse_vertex(chunk, s + 2, eol);
+        else if (eol - s >= 2 && s[0] == 'f' && obj_is_space(s[1]))
+            failed = obj_parse_face(chunk, s + 2, eol);
+        else if (eol - s >= 3 && s[0] == 'v' && s[1] == 't' && obj_is_space(s[2]))
+            failed = obj_parse_stream_value(&chunk->streams[OBJ_TEXCOORDS], OBJ_TEXCOORDS, s + 3, eol);
+        else if (eol - s >= 3 && s[0] == 'v' && s[1] == 'n' && obj_is_space(s[2]))
+            failed = obj_parse_stream_value(&chunk->streams[OBJ_NORMALS], OBJ_NORMALS, s + 3, eol);
+        else if (obj_keyword(s, eol, "mtllib", 6))
+        {
+            // the first one wins
+            char name[OBJ_NAME_MAX];
+            failed = obj_parse_name(name, s + 7, eol);
+            if (!failed && !chunk->material_library[0])
+                memcpy(chunk->material_library, name, OBJ_NAME_MAX);
+        }
+        else if (obj_keyword(s, eol, "usemtl", 6))
+            failed = obj_parse_usemtl(chunk, s + 7, eol);
+
+        if (failed && !chunk->error)
+        {
+            chunk->error = 1;
+            chunk->line = line;
+        }
+        p = eol + 1;
+    }
+}
+
+// number of lines in [begin, end), to turn a chunk-relative line number into a file one for error messages
+static int obj_count_lines(const char* begin, const char* end)
+{
+    int lines = 0;
+    for (const char* p = begin; p < end && (p = memchr(p, '\n', end - p)); p++)
+    {
+        lines++;
+    }
+    return lines;
+}
+
+// murmur3's finalizer, to spread vertex keys over the hash table
+static uint32_t obj_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 16;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// per-corner keys that, along with the position, tell vertices apart: texture coordinate, normal and material
+#define OBJ_KEYS 3
+
+static int obj_same_keys(const int* const keys[OBJ_KEYS], int a, int b)
+{
+    for (int k = 0; k < OBJ_KEYS; k++)
+    {
+        if (keys[k] && keys[k][a] != keys[k][b])
+            return 0;
+    }
+    return 1;
+}
+
+/*
+    Makes every distinct combination of position and keys the faces use into a vertex, numbered in order of first
+    use, and points the indices at them. A mesh where no position is used with two different sets of keys, which is
+    common, keeps its vertices as they are. Either way, returns for every vertex a corner that uses it (or -1 if none
+    does), to take its attributes from.
+*/
+static int* obj_split_vertices(obj_mesh* out, const int* const keys[OBJ_KEYS])
+{
+    int n = out->num_indices;
+
+    int* vertex_corner = malloc((size_t)(out->num_positions ? out->num_positions : 1) * sizeof(int));
+    if (!vertex_corner)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    for (int v = 0; v < out->num_positions; v++)
+    {
+        vertex_corner[v] = -1;
+    }
+    int seams = 0;
+    for (int i = 0; i < n && !seams; i++)
+    {
+        int* first = &vertex_corner[out->indices[i]];
+        if (*first < 0)
+            *first = i;
+        seams = !obj_same_keys(keys, *first, i);
+    }
+    if (!seams)
+        return vertex_corner;
+
+    // open addressing, at most half full; slots hold the vertex made for each combination
+    int table_size = 1;
+    while (table_size < n * 2)
+    {
+        table_size <<= 1;
+    }
+    int* table = malloc((size_t)table_size * sizeof(int));
+    int* vertex_position = malloc((size_t)(n ? n : 1) * sizeof(int));
+    vertex_corner = realloc(vertex_corner, (size_t)(n ? n : 1) * sizeof(int));
+    if (!table || !vertex_position || !vertex_corner)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    for (int i = 0; i < table_size; i++)
+    {
+        table[i] = -1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int p = out->indices[i];
+        uint32_t h = obj_mix((uint32_t)p);
+        for (int k = 0; k < OBJ_KEYS; k++)
+        {
+            if (keys[k])
+                h = obj_mix(h ^ (uint32_t)keys[k][i]);
+        }
+        uint32_t slot = h & (table_size - 1);
+        while (table[slot] >= 0 &&
+               (vertex_position[table[slot]] != p || !obj_same_keys(keys, vertex_corner[table[slot]], i)))
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] < 0)
+        {
+            table[slot] = count;
+            vertex_position[count] = p;
+            vertex_corner[count] = i;
+            count++;
+        }
+        out->indices[i] = table[slot];
+    }
+
+    vec3f* positions = malloc((size_t)(count ? count : 1) * sizeof(vec3f));
+    if (!positions)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    for (int v = 0; v < count; v++)
+    {
+        positions[v] = out->positions[vertex_position[v]];
+    }
+    free(out->positions);
+    out->positions = positions;
+    out->num_positions = count;
+
+    free(table);
+    free(vertex_position);
+    return vertex_corner;
+}
+
+// the values of one stream for every vertex, from the corners obj_split_vertices picked; missing ones are zero
+static float* obj_gather_stream(const float* values, int width, const int* corners, const int* vertex_corner,
+                                int num_vertices)
+{
+    float* out = malloc((size_t)(num_vertices ? num_vertices : 1) * width * sizeof(float));
+    if (!out)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    for (int v = 0; v < num_vertices; v++)
+    {
+        int ref = vertex_corner[v] < 0 ? OBJ_NO_REF : corners[vertex_corner[v]];
+        for (int k = 0; k < width; k++)
+        {
+            out[(size_t)v * width + k] = ref == OBJ_NO_REF ? 0.0f : values[(size_t)ref * width + k];
+        }
+    }
+    return out;
+}
+
+// the material table's index for `name`, adding it if it's new
+static int obj_material_index(obj_mesh* out, int* alloc, const char* name)
+{
+    for (int m = 0; m < out->num_materials; m++)
+    {
+        if (strcmp(out->materials[m], name) == 0)
+            return m;
+    }
+    if (out->num_materials == *alloc)
+    {
+        *alloc = *alloc ? *alloc * 2 : 8;
+        out->materials = realloc(out->materials, (size_t)*alloc * OBJ_NAME_MAX);
+        if (!out->materials)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    memcpy(out->materials[out->num_materials], name, OBJ_NAME_MAX);
+    return out->num_materials++;
+}
+
+int obj_parse(const char* text, size_t length, int num_threads, obj_mesh* out)
+{
+    memset(out, 0, sizeof(*out));
+    if (num_threads <= 0)
+        num_threads = threadpool_default_size();
+
+    int num_chunks = (int)(length / OBJ_MIN_CHUNK_BYTES);
+    if (num_chunks > num_threads) num_chunks = num_threads;
+    if (num_chunks < 1) num_chunks = 1;
+
+    obj_chunk* chunks = calloc(num_chunks, sizeof(obj_chunk));
+    if (!chunks)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+
+    // cut at roughly equal sizes, then push every cut forward to just past the next newline
+    const char* end = text + length;
+    const char* cut = text;
+    for (int c = 0; c < num_chunks; c++)
+    {
+        chunks[c].begin = cut;
+        if (c == num_chunks - 1)
+        {
+            cut = end;
+        }
+        else
+        {
+            const char* target = text + length / num_chunks * (c + 1);
+            if (target < cut) target = cut;
+            const char* eol = memchr(target, '\n', end - target);
+            cut = eol ? eol + 1 : end;
+        }
+        chunks[c].end = cut;
+    }
+
+    if (num_chunks == 1)
+    {
+        obj_parse_chunk(chunks, 0, 0);
+    }
+    else
+    {
+        threadpool* pool = threadpool_create(num_chunks);
+        if (!pool)
+        {
+            free(chunks);
+            return 1;
+        }
+        threadpool_run(pool, obj_parse_chunk, chunks, num_chunks);
+        threadpool_destroy(pool);
+    }
+
+    int result = 0;
+    for (int c = 0; c < num_chunks; c++)
+    {
+        if (chunks[c].error)
+        {
+            fprintf(stderr, "Malformed .obj line %d\n", obj_count_lines(text, chunks[c].begin) + chunks[c].line);
+            result = 1;
+            break;
+        }
+    }
+
+    // every `usemtl` name into one table, in order of first use; each chunk's switches are rewritten as indices
+    // into it, stored in place of the start of the name
+    int material_alloc = 0;
+    for (int c = 0; c < num_chunks && result == 0; c++)
+    {
+        for (int m = 0; m < chunks[c].num_materials; m++)
+        {
+            if (!out->material_library[0] && chunks[c].material_library[0])
+                memcpy(out->material_library, chunks[c].material_library, OBJ_NAME_MAX);
+            int index = obj_material_index(out, &material_alloc, chunks[c].materials[m]);
+            memcpy(chunks[c].materials[m], &index, sizeof(index));
+        }
+        if (!out->material_library[0])
+            memcpy(out->material_library, chunks[c].material_library, OBJ_NAME_MAX);
+    }
+
+    // concatenate in file order; relative indices get their chunk's base added on the way
+    float* values[OBJ_STREAMS] = {NULL};
+    int* corners[OBJ_STREAMS] = {NULL};
+    int num_values[OBJ_STREAMS] = {0};
+    // with two or more materials, each corner's material; faces before the first `usemtl` get the first material
+    int* corner_materials = NULL;
+    if (result == 0)
+    {
+        long total_positions = 0, total_indices = 0;
+        long total_values[OBJ_STREAMS] = {0};
+        int used[OBJ_STREAMS] = {0};
+        for (int c = 0; c < num_chunks; c++)
+        {
+            total_positions += chunks[c].num_positions;
+            total_indices += chunks[c].num_indices;
+            for (int k = 0; k < OBJ_STREAMS; k++)
+            {
+                total_values[k] += chunks[c].streams[k].num_values;
+                used[k] |= chunks[c].streams[k].corners != NULL;
+            }
+        }
+        out->positions = malloc((total_positions ? total_positions : 1) * sizeof(vec3f));
+        out->indices = malloc((total_indices ? total_indices : 1) * sizeof(int));
+        if (!out->positions || !out->indices)
+            result = 1;
+        for (int k = 0; k < OBJ_STREAMS; k++)
+        {
+            if (!used[k])
+                continue;
+            corners[k] = malloc((total_indices ? total_indices : 1) * sizeof(int));
+            values[k] = malloc((total_values[k] ? total_values[k] : 1) * obj_stream_width[k] * sizeof(float));
+            if (!corners[k] || !values[k])
+                result = 1;
+        }
+        if (out->num_materials > 1)
+        {
+            corner_materials = malloc((total_indices ? total_indices : 1) * sizeof(int));
+            if (!corner_materials)
+                result = 1;
+        }
+        if (result != 0)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+        }
+
+        int base = 0;
+        int stream_base[OBJ_STREAMS] = {0};
+        int material = 0;
+        for (int c = 0; c < num_chunks && result == 0; c++)
+        {
+            obj_chunk* chunk = &chunks[c];
+            for (int r = 0; r < chunk->num_relative; r++)
+            {
+                chunk->indices[chunk->relative[r]] += base;
+            }
+            if (chunk->num_positions)
+                memcpy(out->positions + out->num_positions, chunk->positions, chunk->num_positions * sizeof(vec3f));
+            if (chunk->num_indices)
+                memcpy(out->indices + out->num_indices, chunk->indices, chunk->num_indices * sizeof(int));
+
+            for (int k = 0; k < OBJ_STREAMS; k++)
+            {
+                obj_stream* stream = &chunk->streams[k];
+                if (!corners[k])
+                    continue;
+                for (int r = 0; r < stream->num_relative; r++)
+                {
+                    stream->corners[stream->relative[r]] += stream_base[k];
+                }
+                for (int i = 0; i < chunk->num_indices; i++)
+                {
+                    corners[k][out->num_indices + i] = stream->corners ? stream->corners[i] : OBJ_NO_REF;
+                }
+                if (stream->num_values)
+                {
+                    memcpy(values[k] + (size_t)num_values[k] * obj_stream_width[k], stream->values,
+                           (size_t)stream->num_values * obj_stream_width[k] * sizeof(float));
+                }
+                num_values[k] += stream->num_values;
+                stream_base[k] += stream->num_values;
+            }
+
+            if (corner_materials)
+            {
+                int next = 0;
+                for (int i = 0; i < chunk->num_indices; i++)
+                {
+                    while (next < chunk->num_materials && chunk->material_starts[next] <= i)
+                    {
+                        memcpy(&material, chunk->materials[next++], sizeof(material));
+                    }
+                    corner_materials[out->num_indices + i] = material;
+                }
+            }
+            else if (chunk->num_materials > 0)
+            {
+                memcpy(&material, chunk->materials[chunk->num_materials - 1], sizeof(material));
+            }
+
+            out->num_positions += chunk->num_positions;
+            out->num_indices += chunk->num_indices;
+            base += chunk->num_positions;
+        }
+    }
+
+    for (int c = 0; c < num_chunks; c++)
+    {
+        free(chunks[c].positions);
+        free(chunks[c].indices);
+        free(chunks[c].relative);
+        for (int k = 0; k < OBJ_STREAMS; k++)
+        {
+            free(chunks[c].streams[k].values);
+            free(chunks[c].streams[k].corners);
+            free(chunks[c].streams[k].relative);
+        }
+        free(chunks[c].materials);
+        free(chunks[c].material_starts);
+    }
+    free(chunks);
+
+    // a face pointing past the vertex list used to read garbage; refuse it instead
+    for (int i = 0; result == 0 && i < out->num_indices; i++)
+    {
+        if (out->indices[i] < 0 || out->indices[i] >= out->num_positions)
+        {
+            fprintf(stderr, "Face index %d is out of range (the file has %d vertices)\n",
+                    out->indices[i] + 1, out->num_positions);
+            result = 1;
+        }
+    }
+    for (int k = 0; k < OBJ_STREAMS; k++)
+    {
+        for (int i = 0; result == 0 && corners[k] && i < out->num_indices; i++)
+        {
+            int ref = corners[k][i];
+            if (ref != OBJ_NO_REF && (ref < 0 || ref >= num_values[k]))
+            {
+                fprintf(stderr, "%s index %d is out of range (the file has %d)\n", obj_stream_name[k], ref + 1,
+                        num_values[k]);
+                result = 1;
+            }
+        }
+    }
+
+    if (result == 0 && (corners[OBJ_TEXCOORDS] || corners[OBJ_NORMALS] || corner_materials))
+    {
+        const int* keys[OBJ_KEYS] = { corners[OBJ_TEXCOORDS], corners[OBJ_NORMALS], corner_materials };
+        int* vertex_corner = obj_split_vertices(out, keys);
+        if (corners[OBJ_TEXCOORDS])
+        {
+            out->uvs = (vec2f*)obj_gather_stream(values[OBJ_TEXCOORDS], 2, corners[OBJ_TEXCOORDS], vertex_corner,
+                                                 out->num_positions);
+        }
+        if (corners[OBJ_NORMALS])
+        {
+            out->normals = (vec3f*)obj_gather_stream(values[OBJ_NORMALS], 3, corners[OBJ_NORMALS], vertex_corner,
+                                                     out->num_positions);
+        }
+        if (corner_materials)
+        {
+            out->material_ids = malloc((size_t)(out->num_positions ? out->num_positions : 1) * sizeof(int));
+            if (!out->material_ids)
+            {
+                fprintf(stderr, "Memory allocation failed!\n");
+                exit(1);
+            }
+            for (int v = 0; v < out->num_positions; v++)
+            {
+                out->material_ids[v] = vertex_corner[v] < 0 ? 0 : corner_materials[vertex_corner[v]];
+            }
+        }
+        free(vertex_corner);
+    }
+    for (int k = 0; k < OBJ_STREAMS; k++)
+    {
+        free(values[k]);
+        free(corners[k]);
+    }
+    free(corner_materials);
+
+    if (result != 0)
+    {
+        obj_free(out);
+    }
+    return result;
+}
+
+int obj_load(const char* path, obj_mesh* out)
+{
+    memset(out, 0, sizeof(*out));
+
+#ifdef _WIN32
+    // no mmap; read the whole file in one go instead
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        perror("Failed to open model file");
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = malloc(length > 0 ? length : 1);
+    if (!text || fread(text, 1, length, file) != (size_t)length)
+    {
+        fprintf(stderr, "Failed to read model file\n");
+        free(text);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+    int result = obj_parse(text, length, 0, out);
+    free(text);
+    return result;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Failed to open model file");
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        perror("Failed to stat model file");
+        close(fd);
+        return 1;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return obj_parse("", 0, 1, out);
+    }
+
+    void* text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (text == MAP_FAILED)
+    {
+        perror("Failed to map model file");
+        return 1;
+    }
+    // every byte is read exactly once, front to back within each chunk
+    posix_madvise(text, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    int result = obj_parse(text, st.st_size, 0, out);
+    munmap(text, st.st_size);
+    return result;
+#endif
+}
+
+void obj_free(obj_mesh* mesh)
+{
+    free(mesh->positions);
+    free(mesh->uvs);
+    free(mesh->normals);
+    free(mesh->material_ids);
+    free(mesh->materials);
+    free(mesh->indices);
+    mesh->positions = NULL;
+    mesh->uvs = NULL;
+    mesh->normals = NULL;
+    mesh->material_ids = NULL;
+    mesh->materials = NULL;
+    mesh->indices = NULL;
+    mesh->num_positions = 0;
+    mesh->num_indices = 0;
+    mesh->num_materials = 0;
+}
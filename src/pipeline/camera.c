@@ -1,9 +1,7 @@
 #include "camera.h"
 
-void camera_from_world(vec3f camera_pos, quat camera_rot, vec4f* vertices, int num_vertices, vec4f* out_vertices)
+void camera_view_matrix(vec3f camera_pos, quat camera_rot, mat4 out)
 {
-    mat4 inverse_camera_transform;
-
     // Step 1: Get inverse rotation (conjugate of the quaternion)
     quat inverse_rot = quat_conjugate(camera_rot);
 
@@ -17,9 +15,15 @@ void camera_from_world(vec3f camera_pos, quat camera_rot, vec4f* vertices, int n
     mat4_translate(trans_matrix, -camera_pos.x, -camera_pos.y, -camera_pos.z);
 
     // Step 4: Combine: inverse_transform = rot_matrix * trans_matrix
-    mat4_multiply(rot_matrix, trans_matrix, inverse_camera_transform);
+    mat4_multiply(rot_matrix, trans_matrix, out);
+}
+
+void camera_from_world(vec3f camera_pos, quat camera_rot, vec4f* vertices, int num_vertices, vec4f* out_vertices)
+{
+    mat4 inverse_camera_transform;
+    camera_view_matrix(camera_pos, camera_rot, inverse_camera_transform);
 
-    // Step 5: Transform each vertex
+    // Transform each vertex
     for (int i = 0; i < num_vertices; i++)
     {
         mat4_transform_vec4f(inverse_camera_transform, vertices[i], &out_vertices[i]);
@@ -16,65 +16,385 @@
     vertex array, and valid indices go into a new index array.    
 */
 
+#include <string.h>
 #include "matrix.h"
 #include "culling.h"
 
 
-void culling_cull_triangle(vec4f* vertices, int num_vertices, int* indices, int num_indices,
-                           vec4f** out_vertices, int* out_num_vertices,
-                           int** out_indices, int* out_num_indices)
+// grows an arena-backed output array; the old copy is simply abandoned until the arena is reset
+static void* culling_grow(arena* frame_arena, void* old, int count, int* capacity, size_t element_size)
+{
+    *capacity *= 2;
+    void* fresh = arena_alloc(frame_arena, *capacity * element_size, ARENA_ALIGN);
+    memcpy(fresh, old, count * element_size);
+    return fresh;
+}
+
+uint16_t culling_outcode(vec4f v)
 {
-    int vertex_alloc = num_vertices * 3;
-    int index_alloc = num_indices * 3;
+    uint16_t code = 0;
+    if (v.x < -v.w) code |= CULLING_OUT_LEFT;
+    if (v.x > v.w)  code |= CULLING_OUT_RIGHT;
+    if (v.y < -v.w) code |= CULLING_OUT_BOTTOM;
+    if (v.y > v.w)  code |= CULLING_OUT_TOP;
+    if (v.z < -v.w) code |= CULLING_OUT_NEAR;
+    if (v.z > v.w)  code |= CULLING_OUT_FAR;
+
+    float guard = CULLING_GUARD_BAND * v.w;
+    if (v.x < -guard) code |= CULLING_OUT_GUARD_LEFT;
+    if (v.x > guard)  code |= CULLING_OUT_GUARD_RIGHT;
+    if (v.y < -guard) code |= CULLING_OUT_GUARD_BOTTOM;
+    if (v.y > guard)  code |= CULLING_OUT_GUARD_TOP;
+    return code;
+}
 
-    *out_vertices = malloc(vertex_alloc * sizeof(vec4f));
-    *out_indices = malloc(index_alloc * sizeof(int));
-    *out_num_vertices = 0;
-    *out_num_indices = 0;
+void culling_frustum_planes(const mat4 mvp, vec4f planes[6])
+{
+    // clip space is inside when -w <= x, y, z <= w, i.e. row3 + rowk >= 0 and row3 - rowk >= 0; each row of the
+    // matrix is a linear function of the model-space position, so those sums are model-space planes
+    for (int k = 0; k < 3; k++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            vec4f p = {
+                mvp[3] + sign * mvp[k],
+                mvp[7] + sign * mvp[4 + k],
+                mvp[11] + sign * mvp[8 + k],
+                mvp[15] + sign * mvp[12 + k]
+            };
+            float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+            if (length > 0.0f)
+            {
+                p.x /= length;
+                p.y /= length;
+                p.z /= length;
+                p.w /= length;
+            }
+            planes[k * 2 + side] = p;
+        }
+    }
+}
 
-    if (!*out_vertices || !*out_indices) {
-        fprintf(stderr, "Memory allocation failed!\n");
-        exit(1);
+int culling_sphere_outside(const vec4f planes[6], vec3f center, float radius)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (planes[i].x * center.x + planes[i].y * center.y + planes[i].z * center.z + planes[i].w < -radius)
+            return 1;
     }
+    return 0;
+}
+
+// small direct-mapped cache of the clip-generated vertices emitted recently, so neighbouring clipped triangles that
+// produce the very same point (which intersect() guarantees for a shared edge) share one output vertex, as long as
+// their other attributes came out the same too
+#define CULLING_CACHE_SIZE 64
+
+typedef struct culling_cache
+{
+    vec4f vertex[CULLING_CACHE_SIZE];
+    int index[CULLING_CACHE_SIZE]; // -1 = empty
+} culling_cache;
+
+static unsigned culling_hash(const vec4f* v)
+{
+    uint32_t bits[4];
+    memcpy(bits, v, sizeof(bits));
+    uint32_t h = bits[0] * 0x9e3779b1u ^ bits[1] * 0x85ebca77u ^ bits[2] * 0xc2b2ae3du ^ bits[3] * 0x27d4eb2fu;
+    return (h >> 16) % CULLING_CACHE_SIZE;
+}
+
+// output of one run of the clipper. Indices below the input vertex count refer straight to the input vertices;
+// index num_input + k refers to new_vertices[k].
+typedef struct culling_output
+{
+    vec4f* new_vertices;
+    float* new_attributes; // attribute_count per new vertex
+    int num_new_vertices;
+    int new_alloc;
+    int* indices;
+    int num_indices;
+    int index_alloc;
+} culling_output;
+
+// the serial clipper: clips triangles [first, last) (as triangle numbers) into arrays allocated from `out_arena`
+static void culling_cull_range(arena* out_arena, const vec4f* vertices, int num_vertices, const float* attributes,
+                               int attribute_count, const uint16_t* outcodes, const int* indices, int first, int last,
+                               culling_output* out)
+{
+    // unclipped triangles only add 3 indices each, so size for that; new vertices only come from actual clipping
+    out->index_alloc = (last - first) * 3 + 3 * MAX_VERTS_PER_TRI;
+    out->new_alloc = 16 * MAX_VERTS_PER_TRI;
+    out->indices = arena_alloc_array(out_arena, int, out->index_alloc);
+    out->new_vertices = arena_alloc_array(out_arena, vec4f, out->new_alloc);
+    out->new_attributes = attribute_count > 0 ? arena_alloc_array(out_arena, float, out->new_alloc * attribute_count) : NULL;
+    out->num_indices = 0;
+    out->num_new_vertices = 0;
+
+    culling_cache cache;
 
-    for (int i = 0; i < num_indices; i += 3)
+    for (int t = first; t < last; t++)
     {
-        vec4f v0 = vertices[indices[i + 0]];
-        vec4f v1 = vertices[indices[i + 1]];
-        vec4f v2 = vertices[indices[i + 2]];
+        // the cache starts empty on every run boundary, so the serial and parallel paths make the same choices
+        if ((t - first) % CULLING_CHUNK_TRIANGLES == 0)
+        {
+            for (int c = 0; c < CULLING_CACHE_SIZE; c++)
+            {
+                cache.index[c] = -1;
+            }
+        }
+
+        const int* tri = &indices[t * 3];
+        uint16_t c0 = outcodes[tri[0]];
+        uint16_t c1 = outcodes[tri[1]];
+        uint16_t c2 = outcodes[tri[2]];
+
+        // trivial reject: all three vertices are outside the same plane
+        if (c0 & c1 & c2 & CULLING_OUT_FRUSTUM)
+            continue;
+
+        // trivial accept: nothing the rasterizer can't handle on its own, so keep pointing at the shared vertices
+        if (((c0 | c1 | c2) & CULLING_OUT_NEEDS_CLIP) == 0)
+        {
+            // the initial allocation covers every unclipped triangle, but earlier clipped ones may have used it up
+            if (out->num_indices + 3 > out->index_alloc) {
+                out->indices = culling_grow(out_arena, out->indices, out->num_indices, &out->index_alloc, sizeof(int));
+            }
+            int* dst = out->indices + out->num_indices;
+            dst[0] = tri[0];
+            dst[1] = tri[1];
+            dst[2] = tri[2];
+            out->num_indices += 3;
+            continue;
+        }
 
+        vec4f v[3] = { vertices[tri[0]], vertices[tri[1]], vertices[tri[2]] };
         vec4f clipped[MAX_VERTS_PER_TRI];
+        vec3f weights[MAX_VERTS_PER_TRI];
         int clipped_count = 0;
-        clip_triangle(v0, v1, v2, clipped, &clipped_count);
+        clip_triangle_weights(v[0], v[1], v[2], clipped, weights, &clipped_count);
 
         if (clipped_count == 0)
             continue;
 
-        int base = *out_num_vertices;
-        for (int j = 0; j < clipped_count; j++) {
-            if (*out_num_vertices >= vertex_alloc) {
-                vertex_alloc *= 2;
-                *out_vertices = realloc(*out_vertices, vertex_alloc * sizeof(vec4f));
-                if (!*out_vertices) { fprintf(stderr, "Realloc vertices failed!\n"); exit(1); }
+        // make sure the worst case for this triangle fits before writing anything
+        if (out->num_new_vertices + clipped_count > out->new_alloc) {
+            int new_alloc = out->new_alloc;
+            out->new_vertices = culling_grow(out_arena, out->new_vertices, out->num_new_vertices, &out->new_alloc, sizeof(vec4f));
+            if (attribute_count > 0) {
+                out->new_attributes = culling_grow(out_arena, out->new_attributes, out->num_new_vertices, &new_alloc,
+                                                   attribute_count * sizeof(float));
+            }
+        }
+        if (out->num_indices + 3 * (clipped_count - 2) > out->index_alloc) {
+            out->indices = culling_grow(out_arena, out->indices, out->num_indices, &out->index_alloc, sizeof(int));
+        }
+
+        // work out an output index for every corner of the clipped polygon: corners that survived clipping are the
+        // original vertices, bit for bit; the rest are new, unless the cache has just seen the same point
+        int corner[MAX_VERTS_PER_TRI];
+        for (int j = 0; j < clipped_count; j++)
+        {
+            corner[j] = -1;
+            for (int k = 0; k < 3; k++)
+            {
+                if (memcmp(&clipped[j], &v[k], sizeof(vec4f)) == 0)
+                {
+                    corner[j] = tri[k];
+                    break;
+                }
+            }
+            if (corner[j] >= 0)
+                continue;
+
+            // the new vertex's attributes, straight into place; they only count once the vertex is kept
+            float* attr = attribute_count > 0 ? out->new_attributes + out->num_new_vertices * attribute_count : NULL;
+            for (int a = 0; a < attribute_count; a++)
+            {
+                attr[a] = weights[j].x * attributes[tri[0] * attribute_count + a]
+                        + weights[j].y * attributes[tri[1] * attribute_count + a]
+                        + weights[j].z * attributes[tri[2] * attribute_count + a];
+            }
+
+            unsigned slot = culling_hash(&clipped[j]);
+            if (cache.index[slot] >= 0 && memcmp(&cache.vertex[slot], &clipped[j], sizeof(vec4f)) == 0 &&
+                (attribute_count == 0 ||
+                 memcmp(out->new_attributes + (cache.index[slot] - num_vertices) * attribute_count, attr,
+                        attribute_count * sizeof(float)) == 0))
+            {
+                corner[j] = cache.index[slot];
+                continue;
             }
-            (*out_vertices)[*out_num_vertices] = clipped[j];
-            (*out_num_vertices)++;
+
+            corner[j] = num_vertices + out->num_new_vertices;
+            out->new_vertices[out->num_new_vertices++] = clipped[j];
+            cache.vertex[slot] = clipped[j];
+            cache.index[slot] = corner[j];
+        }
+
+        // fan triangulation, as triangulate_polygon does, but over the remapped corners
+        for (int j = 1; j < clipped_count - 1; j++)
+        {
+            int* dst = out->indices + out->num_indices;
+            dst[0] = corner[0];
+            dst[1] = corner[j];
+            dst[2] = corner[j + 1];
+            out->num_indices += 3;
+        }
+    }
+}
+
+// one chunk of the parallel clipper: its slice of the input, and where its output ended up
+typedef struct culling_chunk
+{
+    int first, last; // triangle numbers
+    culling_output out;
+    int vertex_offset; // where this chunk's new vertices start among all new vertices
+    int index_offset;  // where this chunk's indices start in the merged index array
+} culling_chunk;
+
+typedef struct culling_job
+{
+    const vec4f* vertices;
+    int num_vertices;
+    const float* attributes;
+    int attribute_count;
+    const uint16_t* outcodes;
+    const int* indices;
+    culling_chunk* chunks;
+    arena* scratch; // one per worker
+    vec4f* out_vertices;
+    float* out_attributes;
+    int* out_indices;
+} culling_job;
+
+static void culling_clip_chunk(void* data, int index, int worker)
+{
+    culling_job* job = data;
+    culling_chunk* chunk = &job->chunks[index];
+    culling_cull_range(&job->scratch[worker], job->vertices, job->num_vertices, job->attributes, job->attribute_count,
+                       job->outcodes, job->indices, chunk->first, chunk->last, &chunk->out);
+}
+
+static void culling_merge_chunk(void* data, int index, int worker)
+{
+    (void)worker;
+    culling_job* job = data;
+    culling_chunk* chunk = &job->chunks[index];
+
+    memcpy(job->out_vertices + job->num_vertices + chunk->vertex_offset, chunk->out.new_vertices,
+           chunk->out.num_new_vertices * sizeof(vec4f));
+    if (job->attribute_count > 0)
+    {
+        memcpy(job->out_attributes + (size_t)(job->num_vertices + chunk->vertex_offset) * job->attribute_count,
+               chunk->out.new_attributes, chunk->out.num_new_vertices * job->attribute_count * sizeof(float));
+    }
+    // shared vertices keep their index; new ones move past the new vertices of earlier chunks
+    int* out = job->out_indices + chunk->index_offset;
+    for (int i = 0; i < chunk->out.num_indices; i++)
+    {
+        int v = chunk->out.indices[i];
+        out[i] = v < job->num_vertices ? v : v + chunk->vertex_offset;
+    }
+}
+
+void culling_cull_triangle(arena* frame_arena, threadpool* pool, arena* scratch,
+                           vec4f* vertices, int num_vertices, const float* attributes, int attribute_count,
+                           int* indices, int num_indices,
+                           vec4f** out_vertices, int* out_num_vertices, float** out_attributes,
+                           int** out_indices, int* out_num_indices)
+{
+    if (!attributes)
+        attribute_count = 0;
+
+    int num_triangles = num_indices / 3;
+    int num_chunks = (num_triangles + CULLING_CHUNK_TRIANGLES - 1) / CULLING_CHUNK_TRIANGLES;
+
+    // outcodes once per vertex rather than once per triangle corner
+    uint16_t* outcodes = arena_alloc_array(frame_arena, uint16_t, num_vertices > 0 ? num_vertices : 1);
+    for (int i = 0; i < num_vertices; i++)
+    {
+        outcodes[i] = culling_outcode(vertices[i]);
+    }
+
+    if (!pool || threadpool_size(pool) == 1 || num_chunks <= 1)
+    {
+        culling_output out;
+        culling_cull_range(frame_arena, vertices, num_vertices, attributes, attribute_count, outcodes, indices, 0,
+                           num_triangles, &out);
+        *out_indices = out.indices;
+        *out_num_indices = out.num_indices;
+        *out_num_vertices = num_vertices + out.num_new_vertices;
+        if (out.num_new_vertices == 0)
+        {
+            // nothing was clipped, so the input vertices are the output as they are
+            *out_vertices = vertices;
+            *out_attributes = (float*)attributes;
+            return;
+        }
+        *out_vertices = arena_alloc_array(frame_arena, vec4f, *out_num_vertices);
+        memcpy(*out_vertices, vertices, num_vertices * sizeof(vec4f));
+        memcpy(*out_vertices + num_vertices, out.new_vertices, out.num_new_vertices * sizeof(vec4f));
+        *out_attributes = NULL;
+        if (attribute_count > 0)
+        {
+            *out_attributes = arena_alloc_array(frame_arena, float, *out_num_vertices * attribute_count);
+            memcpy(*out_attributes, attributes, (size_t)num_vertices * attribute_count * sizeof(float));
+            memcpy(*out_attributes + (size_t)num_vertices * attribute_count, out.new_attributes,
+                   (size_t)out.num_new_vertices * attribute_count * sizeof(float));
         }
+        return;
+    }
+
+    // 1. every chunk clips its own run of triangles into its worker's scratch arena
+    culling_chunk* chunks = arena_alloc_array(frame_arena, culling_chunk, num_chunks);
+    for (int c = 0; c < num_chunks; c++)
+    {
+        chunks[c].first = c * CULLING_CHUNK_TRIANGLES;
+        chunks[c].last = chunks[c].first + CULLING_CHUNK_TRIANGLES < num_triangles
+                       ? chunks[c].first + CULLING_CHUNK_TRIANGLES : num_triangles;
+    }
+    culling_job job = { vertices, num_vertices, attributes, attribute_count, outcodes, indices, chunks, scratch,
+                        NULL, NULL, NULL };
+    threadpool_run(pool, culling_clip_chunk, &job, num_chunks);
 
-        int index_start = *out_num_indices;
-        int index_count = 0;
-        triangulate_polygon(clipped, clipped_count, *out_indices + index_start, &index_count, base);
-        *out_num_indices += index_count;
+    // 2. a prefix sum over the chunk sizes gives each chunk its place in the output, in the original triangle order
+    int total_new = 0;
+    int total_indices = 0;
+    for (int c = 0; c < num_chunks; c++)
+    {
+        chunks[c].vertex_offset = total_new;
+        chunks[c].index_offset = total_indices;
+        total_new += chunks[c].out.num_new_vertices;
+        total_indices += chunks[c].out.num_indices;
+    }
 
-        if (*out_num_indices >= index_alloc) {
-            index_alloc *= 2;
-            *out_indices = realloc(*out_indices, index_alloc * sizeof(int));
-            if (!*out_indices) { fprintf(stderr, "Realloc indices failed!\n"); exit(1); }
+    // 3. copy the chunks into place after the shared vertices, rebasing their indices; the result is exactly what
+    // the serial path produces
+    job.out_indices = arena_alloc_array(frame_arena, int, total_indices > 0 ? total_indices : 1);
+    if (total_new == 0)
+    {
+        job.out_vertices = vertices;
+        job.out_attributes = (float*)attributes;
+    }
+    else
+    {
+        job.out_vertices = arena_alloc_array(frame_arena, vec4f, num_vertices + total_new);
+        memcpy(job.out_vertices, vertices, num_vertices * sizeof(vec4f));
+        if (attribute_count > 0)
+        {
+            job.out_attributes = arena_alloc_array(frame_arena, float, (num_vertices + total_new) * attribute_count);
+            memcpy(job.out_attributes, attributes, (size_t)num_vertices * attribute_count * sizeof(float));
         }
     }
+    threadpool_run(pool, culling_merge_chunk, &job, num_chunks);
 
-    *out_vertices = realloc(*out_vertices, *out_num_vertices * sizeof(vec4f));
-    *out_indices = realloc(*out_indices, *out_num_indices * sizeof(int));
+    *out_vertices = job.out_vertices;
+    *out_attributes = job.out_attributes;
+    *out_num_vertices = num_vertices + total_new;
+    *out_indices = job.out_indices;
+    *out_num_indices = total_indices;
 }
 
 
@@ -149,6 +469,11 @@ int inside(vec4f v, int axis, float sign) {
 }
 
 vec4f intersect(vec4f a, vec4f b, int axis, float sign) {
+    // always interpolate a given edge in the same direction, so the two triangles sharing it get bit-identical
+    // intersection points: no cracks along the seam, and the clipper's vertex cache can merge them
+    if (memcmp(&a, &b, sizeof(vec4f)) > 0) {
+        vec4f tmp = a; a = b; b = tmp;
+    }
     float a_c = (axis == 0 ? a.x : axis == 1 ? a.y : a.z) * sign;
     float b_c = (axis == 0 ? b.x : axis == 1 ? b.y : b.z) * sign;
 
@@ -161,28 +486,58 @@ vec4f intersect(vec4f a, vec4f b, int axis, float sign) {
     return r;
 }
 
+// the intersection of edge (prev, curr) of `in` with a plane, weights and all; the position is exactly intersect()'s
+static void culling_intersect(const polygon4f* in, int prev, int curr, int axis, float sign, polygon4f* out)
+{
+    vec4f a = in->verts[prev], b = in->verts[curr];
+    vec3f wa = in->weights[prev], wb = in->weights[curr];
+    if (memcmp(&a, &b, sizeof(vec4f)) > 0) {
+        vec4f tmp = a; a = b; b = tmp;
+        vec3f wtmp = wa; wa = wb; wb = wtmp;
+    }
+    float a_c = (axis == 0 ? a.x : axis == 1 ? a.y : a.z) * sign;
+    float b_c = (axis == 0 ? b.x : axis == 1 ? b.y : b.z) * sign;
+
+    float t = (a.w - a_c) / ((a.w - a_c) - (b.w - b_c));
+    vec4f* r = &out->verts[out->count];
+    r->x = a.x + t * (b.x - a.x);
+    r->y = a.y + t * (b.y - a.y);
+    r->z = a.z + t * (b.z - a.z);
+    r->w = a.w + t * (b.w - a.w);
+    vec3f* w = &out->weights[out->count];
+    w->x = wa.x + t * (wb.x - wa.x);
+    w->y = wa.y + t * (wb.y - wa.y);
+    w->z = wa.z + t * (wb.z - wa.z);
+    out->count++;
+}
+
 void clip_polygon_against_plane(polygon4f* in, polygon4f* out, int axis, float sign) {
     out->count = 0;
     for (int i = 0; i < in->count; i++) {
-        vec4f curr = in->verts[i];
-        vec4f prev = in->verts[(i - 1 + in->count) % in->count];
+        int prev = (i - 1 + in->count) % in->count;
 
-        int curr_in = inside(curr, axis, sign);
-        int prev_in = inside(prev, axis, sign);
+        int curr_in = inside(in->verts[i], axis, sign);
+        int prev_in = inside(in->verts[prev], axis, sign);
 
-        if (curr_in && prev_in)
-            out->verts[out->count++] = curr;
-        else if (!prev_in && curr_in) {
-            out->verts[out->count++] = intersect(prev, curr, axis, sign);
-            out->verts[out->count++] = curr;
+        if (curr_in && prev_in) {
+            out->verts[out->count] = in->verts[i];
+            out->weights[out->count++] = in->weights[i];
+        } else if (!prev_in && curr_in) {
+            culling_intersect(in, prev, i, axis, sign, out);
+            out->verts[out->count] = in->verts[i];
+            out->weights[out->count++] = in->weights[i];
         } else if (prev_in && !curr_in) {
-            out->verts[out->count++] = intersect(prev, curr, axis, sign);
+            culling_intersect(in, prev, i, axis, sign, out);
         }
     }
 }
 
-void clip_triangle(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, int* out_vert_count) {
-    polygon4f bufferA = { .verts = { v0, v1, v2 }, .count = 3 };
+void clip_triangle_weights(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, vec3f* out_weights, int* out_vert_count) {
+    polygon4f bufferA = {
+        .verts = { v0, v1, v2 },
+        .weights = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        .count = 3
+    };
     polygon4f bufferB;
 
     polygon4f* in = &bufferA;
@@ -201,9 +556,15 @@ void clip_triangle(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, int* out_vert
     *out_vert_count = in->count;
     for (int i = 0; i < in->count; i++) {
         out_verts[i] = in->verts[i];
+        if (out_weights)
+            out_weights[i] = in->weights[i];
     }
 }
 
+void clip_triangle(vec4f v0, vec4f v1, vec4f v2, vec4f* out_verts, int* out_vert_count) {
+    clip_triangle_weights(v0, v1, v2, out_verts, NULL, out_vert_count);
+}
+
 void triangulate_polygon(vec4f* verts, int count, int* out_indices, int* out_index_count, int base_index) {
     *out_index_count = 0;
     for (int i = 1; i < count - 1; i++) {
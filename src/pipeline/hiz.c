@@ -0,0 +1,121 @@
+// hierarchical depth bounds for early rejection in the rasterizer and for occlusion tests
+#include "hiz.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// blocks per tile along each axis
+#define HIZ_TILE_BLOCKS (TILE_SIZE / RASTER_BLOCK_SIZE)
+
+int hiz_init(hiz_buffer* hiz, int width, int height)
+{
+    hiz->width = width;
+    hiz->height = height;
+    hiz->blocks_x = (width + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE;
+    hiz->blocks_y = (height + RASTER_BLOCK_SIZE - 1) / RASTER_BLOCK_SIZE;
+    hiz->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    hiz->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    size_t blocks = (size_t)hiz->blocks_x * hiz->blocks_y;
+    size_t tiles = (size_t)hiz->tiles_x * hiz->tiles_y;
+    hiz->block_min = malloc(blocks * sizeof(float));
+    hiz->block_max = malloc(blocks * sizeof(float));
+    hiz->tile_min = malloc(tiles * sizeof(float));
+    hiz->tile_max = malloc(tiles * sizeof(float));
+    if (!hiz->block_min || !hiz->block_max || !hiz->tile_min || !hiz->tile_max)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        hiz_destroy(hiz);
+        return 1;
+    }
+    hiz_clear(hiz, 1.0f);
+    return 0;
+}
+
+void hiz_destroy(hiz_buffer* hiz)
+{
+    free(hiz->block_min);
+    free(hiz->block_max);
+    free(hiz->tile_min);
+    free(hiz->tile_max);
+    hiz->block_min = hiz->block_max = NULL;
+    hiz->tile_min = hiz->tile_max = NULL;
+}
+
+void hiz_clear(hiz_buffer* hiz, float depth)
+{
+    int blocks = hiz->blocks_x * hiz->blocks_y;
+    for (int i = 0; i < blocks; i++)
+    {
+        hiz->block_min[i] = depth;
+        hiz->block_max[i] = depth;
+    }
+    int tiles = hiz->tiles_x * hiz->tiles_y;
+    for (int i = 0; i < tiles; i++)
+    {
+        hiz->tile_min[i] = depth;
+        hiz->tile_max[i] = depth;
+    }
+}
+
+void hiz_update_tile(hiz_buffer* hiz, int tile)
+{
+    int bx0 = (tile % hiz->tiles_x) * HIZ_TILE_BLOCKS;
+    int by0 = (tile / hiz->tiles_x) * HIZ_TILE_BLOCKS;
+    int bx1 = bx0 + HIZ_TILE_BLOCKS < hiz->blocks_x ? bx0 + HIZ_TILE_BLOCKS : hiz->blocks_x;
+    int by1 = by0 + HIZ_TILE_BLOCKS < hiz->blocks_y ? by0 + HIZ_TILE_BLOCKS : hiz->blocks_y;
+
+    float lo = hiz->block_min[by0 * hiz->blocks_x + bx0];
+    float hi = hiz->block_max[by0 * hiz->blocks_x + bx0];
+    for (int by = by0; by < by1; by++)
+    {
+        for (int bx = bx0; bx < bx1; bx++)
+        {
+            int b = by * hiz->blocks_x + bx;
+            if (hiz->block_min[b] < lo) lo = hiz->block_min[b];
+            if (hiz->block_max[b] > hi) hi = hiz->block_max[b];
+        }
+    }
+    hiz->tile_min[tile] = lo;
+    hiz->tile_max[tile] = hi;
+}
+
+int hiz_rect_visible(const hiz_buffer* hiz, int x0, int y0, int x1, int y1, float min_z)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > hiz->width) x1 = hiz->width;
+    if (y1 > hiz->height) y1 = hiz->height;
+    if (x0 >= x1 || y0 >= y1)
+        return 0;
+
+    int bx0 = x0 / RASTER_BLOCK_SIZE, bx1 = (x1 - 1) / RASTER_BLOCK_SIZE;
+    int by0 = y0 / RASTER_BLOCK_SIZE, by1 = (y1 - 1) / RASTER_BLOCK_SIZE;
+
+    for (int ty = by0 / HIZ_TILE_BLOCKS; ty <= by1 / HIZ_TILE_BLOCKS; ty++)
+    {
+        for (int tx = bx0 / HIZ_TILE_BLOCKS; tx <= bx1 / HIZ_TILE_BLOCKS; tx++)
+        {
+            int tile = ty * hiz->tiles_x + tx;
+            // everything already in this tile is nearer than the rectangle
+            if (min_z >= hiz->tile_max[tile])
+                continue;
+
+            // the tile as a whole can't rule it out; try the blocks the rectangle covers
+            int tbx0 = tx * HIZ_TILE_BLOCKS, tby0 = ty * HIZ_TILE_BLOCKS;
+            int sx0 = bx0 > tbx0 ? bx0 : tbx0;
+            int sy0 = by0 > tby0 ? by0 : tby0;
+            int sx1 = bx1 < tbx0 + HIZ_TILE_BLOCKS - 1 ? bx1 : tbx0 + HIZ_TILE_BLOCKS - 1;
+            int sy1 = by1 < tby0 + HIZ_TILE_BLOCKS - 1 ? by1 : tby0 + HIZ_TILE_BLOCKS - 1;
+            for (int by = sy0; by <= sy1; by++)
+            {
+                for (int bx = sx0; bx <= sx1; bx++)
+                {
+                    if (min_z < hiz->block_max[by * hiz->blocks_x + bx])
+                        return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
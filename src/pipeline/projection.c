@@ -1,6 +1,6 @@
 #include "projection.h"
 
-void clip_from_camera(vec4f* vertices, int num_vertices, float fov, float aspect, float znear, float zfar, vec4f* out_vertices)
+void projection_matrix(float fov, float aspect, float znear, float zfar, mat4 out)
 {
     // Calculate the projection matrix
     // mat4_identity(projection_matrix);
@@ -16,15 +16,26 @@ void clip_from_camera(vec4f* vertices, int num_vertices, float fov, float aspect
     float zRange = znear - zfar;
 
     // column major! This looks kinda wrong but it's correct
-    mat4 projection_matrix = {
+    mat4 m = {
         f / aspect, 0,              0,                                0,
         0,          f,              0,                                0,
         0,          0,    (zfar + znear) / zRange,                   -1,
         0,          0,  (2 * zfar * znear) / zRange,                  0
     };
 
+    for (int i = 0; i < 16; i++)
+    {
+        out[i] = m[i];
+    }
+}
+
+void clip_from_camera(vec4f* vertices, int num_vertices, float fov, float aspect, float znear, float zfar, vec4f* out_vertices)
+{
+    mat4 projection;
+    projection_matrix(fov, aspect, znear, zfar, projection);
+
     for (int i = 0; i < num_vertices; i++)
     {
-        mat4_transform_vec4f(projection_matrix, vertices[i], &out_vertices[i]);
+        mat4_transform_vec4f(projection, vertices[i], &out_vertices[i]);
     }
-}
\ No newline at end of file
+}
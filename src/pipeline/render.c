@@ -0,0 +1,673 @@
+// the full render pipeline, from model-space vertices to pixels in the framebuffer
+#include "render.h"
+
+#include <string.h>
+
+#include "screenspace.h"
+#include "raster.h"
+#include "lines.h"
+#include "tiles.h"
+#include "projection.h"
+#include "vertex.h"
+#include "culling.h"
+#include "material.h"
+#include "profiler.h"
+
+#define M_PI 3.14159265358979323846
+
+// starting size of the per-frame arena; it grows to fit the largest frame seen
+#define FRAME_ARENA_SIZE (4 * 1024 * 1024)
+// starting size of each worker thread's scratch arena
+#define WORKER_ARENA_SIZE (1024 * 1024)
+// instanced draws gather about this many vertices' worth of visible meshlets, across instances, before sending them
+// through the vertex stage and the rest of the pipeline together: enough that culling, binning and waking the
+// thread pool are paid once for many small instances, few enough that the clip-space vertices are still in cache
+// when they get culled and binned
+#define RENDER_BATCH_VERTICES (64 * 1024)
+// ...and at most this many instances per batch, which bounds the per-instance matrices
+#define RENDER_BATCH_INSTANCES 1024
+// the flat color of untextured solid triangles and of wireframe lines
+#define RENDER_COLOR 0xFF00FF00
+// where the light comes from unless the caller says otherwise: above, and over the default camera's right shoulder
+#define RENDER_LIGHT_DIRECTION ((vec3f){0.3f, 0.6f, 0.75f})
+#define RENDER_AMBIENT 0.15f
+
+// one visible meshlet of one batched instance
+typedef struct render_batch_entry
+{
+    int meshlet;
+    int instance; // into render_batch.mvps
+} render_batch_entry;
+
+// visible meshlets waiting for the vertex stage, for render_mesh_instanced
+typedef struct render_batch
+{
+    const mesh* mesh;
+    raster_shading shading; // everything but the attributes, which are gathered per flush
+    mat4* mvps;
+    float* normal_matrices; // nine per instance, when lit: model to world for normals, row by row
+    int num_instances;
+    render_batch_entry* entries;
+    int num_entries;
+    int num_vertices; // the entries' vertex counts, added up
+    uint64_t cull_start; // when gathering for this batch started, for the profiler
+} render_batch;
+
+// swaps in a pool of `num_threads` threads, along with one scratch arena per thread
+static int render_create_pool(render_context* ctx, int num_threads)
+{
+    threadpool* pool = threadpool_create(num_threads);
+    if (!pool)
+        return 1;
+
+    int size = threadpool_size(pool);
+    arena* worker_arenas = malloc(size * sizeof(arena));
+    if (!worker_arenas)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        threadpool_destroy(pool);
+        return 1;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        arena_init(&worker_arenas[i], WORKER_ARENA_SIZE);
+    }
+
+    if (ctx->pool)
+    {
+        for (int i = 0; i < threadpool_size(ctx->pool); i++)
+        {
+            arena_destroy(&ctx->worker_arenas[i]);
+        }
+        free(ctx->worker_arenas);
+        threadpool_destroy(ctx->pool);
+    }
+    ctx->pool = pool;
+    ctx->worker_arenas = worker_arenas;
+    return 0;
+}
+
+int render_context_init(render_context* ctx, int width, int height)
+{
+    ctx->width = width;
+    ctx->height = height;
+    // we need to decide on some camera constants too (znear, zfar, fov)
+    ctx->znear = 0.1f;
+    ctx->zfar = 50.0f;
+    ctx->fov = M_PI / 2.0f; // 90 degrees
+    projection_matrix(ctx->fov, (float)width / (float)height, ctx->znear, ctx->zfar, ctx->projection);
+    ctx->mode = RENDER_MODE_WIREFRAME;
+    ctx->lod_error_pixels = 1.0f;
+    ctx->shading = RENDER_SHADING_GOURAUD;
+    ctx->light_direction = RENDER_LIGHT_DIRECTION;
+    ctx->ambient = RENDER_AMBIENT;
+
+    ctx->depth_buffer = malloc((size_t)width * height * sizeof(float));
+    if (!ctx->depth_buffer)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+    if (hiz_init(&ctx->hiz, width, height) != 0)
+    {
+        free(ctx->depth_buffer);
+        return 1;
+    }
+    // starts out all dirty, so the first frame clears the whole depth buffer
+    if (dirty_init(&ctx->drawn, width, height, TILE_SIZE) != 0)
+    {
+        hiz_destroy(&ctx->hiz);
+        free(ctx->depth_buffer);
+        return 1;
+    }
+    ctx->pool = NULL;
+    ctx->worker_arenas = NULL;
+    if (render_create_pool(ctx, threadpool_default_size()) != 0)
+    {
+        dirty_destroy(&ctx->drawn);
+        hiz_destroy(&ctx->hiz);
+        free(ctx->depth_buffer);
+        return 1;
+    }
+    arena_init(&ctx->frame_arena, FRAME_ARENA_SIZE);
+    return 0;
+}
+
+int render_context_set_threads(render_context* ctx, int num_threads)
+{
+    return render_create_pool(ctx, num_threads);
+}
+
+void render_context_destroy(render_context* ctx)
+{
+    if (depth_buffer == ctx->depth_buffer)
+    {
+        depth_buffer = NULL;
+        drawn_tiles = NULL;
+    }
+    for (int i = 0; i < threadpool_size(ctx->pool); i++)
+    {
+        arena_destroy(&ctx->worker_arenas[i]);
+    }
+    free(ctx->worker_arenas);
+    ctx->worker_arenas = NULL;
+    threadpool_destroy(ctx->pool);
+    ctx->pool = NULL;
+    arena_destroy(&ctx->frame_arena);
+    dirty_destroy(&ctx->drawn);
+    hiz_destroy(&ctx->hiz);
+    free(ctx->depth_buffer);
+    ctx->depth_buffer = NULL;
+}
+
+void render_begin_frame(render_context* ctx)
+{
+    arena_reset(&ctx->frame_arena);
+    for (int i = 0; i < threadpool_size(ctx->pool); i++)
+    {
+        arena_reset(&ctx->worker_arenas[i]);
+    }
+
+    PROFILE_BEGIN(PROFILE_CLEAR);
+    depth_buffer = ctx->depth_buffer;
+    drawn_tiles = &ctx->drawn;
+    // nothing outside last frame's tiles was written, so the rest is still clear
+    dirty_clear_depth(&ctx->drawn, ctx->depth_buffer, 1.0f);
+    dirty_reset(&ctx->drawn);
+    hiz_clear(&ctx->hiz, 1.0f);
+    PROFILE_END(PROFILE_CLEAR);
+}
+
+// everything after the vertex stage, shared by the AoS and SoA entry points. `shading` says how solid triangles are
+// colored; its attributes, if any, are per clip vertex and get clipped along with them.
+static void render_clip_vertices(render_context* ctx, uint32_t* image, vec4f* clip_vertices, int num_vertices, int* indices, int num_indices,
+                                 raster_shading shading)
+{
+    arena* frame = &ctx->frame_arena;
+
+    // culling!!
+    // 3.5. cull triangles that are outside the view frustum
+    PROFILE_BEGIN(PROFILE_CULL);
+    vec4f* culled_vertices = NULL;
+    int* culled_indices = NULL;
+    int tmp_num_vertices = 0;
+    int tmp_num_indices = 0;
+    float* culled_attributes = NULL;
+    culling_cull_triangle(frame, ctx->pool, ctx->worker_arenas, clip_vertices, num_vertices,
+                            shading.attributes, shading.attribute_count, indices, num_indices,
+                            &culled_vertices, &tmp_num_vertices, &culled_attributes,
+                            &culled_indices, &tmp_num_indices);
+    shading.attributes = culled_attributes;
+    num_vertices = tmp_num_vertices;
+    num_indices = tmp_num_indices;
+    PROFILE_END(PROFILE_CULL);
+
+    // 4-5. perspective divide into NDC and viewport mapping into screen space, fused and done in place
+    PROFILE_BEGIN(PROFILE_PROJECT);
+    vertex_project_to_screen(culled_vertices, num_vertices, ctx->width, ctx->height);
+    PROFILE_END(PROFILE_PROJECT);
+
+    // finally, 6. assemble and draw triangles
+    if (ctx->mode == RENDER_MODE_SOLID)
+    {
+        // sort-middle: bin triangles into tiles, then rasterize the tiles in parallel
+        PROFILE_BEGIN(PROFILE_BIN);
+        tile_bins bins;
+        tiles_bin_triangles(frame, culled_vertices, culled_indices, num_indices, ctx->width, ctx->height, &bins);
+        PROFILE_END(PROFILE_BIN);
+
+        PROFILE_BEGIN(PROFILE_RASTER);
+        raster_target target = { image, ctx->depth_buffer, ctx->width, 0, 0, ctx->width, ctx->height, &ctx->hiz };
+        tiles_fill_model(ctx->pool, &bins, &target, culled_vertices, culled_indices, &shading, &ctx->drawn);
+        PROFILE_END(PROFILE_RASTER);
+    }
+    else
+    {
+        PROFILE_BEGIN(PROFILE_RASTER);
+        raster_target target = { image, ctx->depth_buffer, ctx->width, 0, 0, ctx->width, ctx->height, NULL };
+        lines_draw_model(&target, culled_vertices, culled_indices, num_indices, RENDER_COLOR, &ctx->drawn);
+        PROFILE_END(PROFILE_RASTER);
+    }
+
+    // everything above lives in the frame arena and goes away at the next render_begin_frame
+}
+
+// render_bounds_visible, with the MVP already built
+static int render_box_visible(render_context* ctx, vec3f bounds_min, vec3f bounds_max, mat4 mvp)
+{
+    uint16_t all_out = CULLING_OUT_FRUSTUM;
+    float x0 = (float)ctx->width, y0 = (float)ctx->height, x1 = 0.0f, y1 = 0.0f;
+    float min_z = 1.0f;
+    for (int i = 0; i < 8; i++)
+    {
+        vec4f corner = {
+            (i & 1) ? bounds_max.x : bounds_min.x,
+            (i & 2) ? bounds_max.y : bounds_min.y,
+            (i & 4) ? bounds_max.z : bounds_min.z,
+            1.0f
+        };
+        vec4f clip;
+        mat4_transform_vec4f(mvp, corner, &clip);
+
+        uint16_t code = culling_outcode(clip);
+        all_out &= code;
+        // a corner behind the near plane has no meaningful screen position; assume the box reaches the camera
+        if (code & CULLING_OUT_NEAR)
+        {
+            x0 = y0 = 0.0f;
+            x1 = (float)ctx->width;
+            y1 = (float)ctx->height;
+            min_z = -1.0f;
+            continue;
+        }
+
+        vec4f screen = clip;
+        vertex_project_to_screen(&screen, 1, ctx->width, ctx->height);
+        x0 = fminf(x0, screen.x);
+        y0 = fminf(y0, screen.y);
+        x1 = fmaxf(x1, screen.x);
+        y1 = fmaxf(y1, screen.y);
+        min_z = fminf(min_z, screen.z);
+    }
+
+    // every corner is outside the same frustum plane
+    if (all_out)
+        return 0;
+
+    // a corner just in front of the near plane can land far outside the screen, further than an int reaches
+    x0 = fminf(fmaxf(x0, -1.0f), (float)ctx->width + 1.0f);
+    x1 = fminf(fmaxf(x1, -1.0f), (float)ctx->width + 1.0f);
+    y0 = fminf(fmaxf(y0, -1.0f), (float)ctx->height + 1.0f);
+    y1 = fminf(fmaxf(y1, -1.0f), (float)ctx->height + 1.0f);
+    return hiz_rect_visible(&ctx->hiz, (int)floorf(x0), (int)floorf(y0), (int)ceilf(x1) + 1, (int)ceilf(y1) + 1, min_z);
+}
+
+int render_bounds_visible(render_context* ctx, vec3f bounds_min, vec3f bounds_max, mat4 transform, vec3f camera_pos, quat camera_rot)
+{
+    mat4 mvp;
+    vertex_build_mvp(ctx->projection, camera_pos, camera_rot, transform, mvp);
+    return render_box_visible(ctx, bounds_min, bounds_max, mvp);
+}
+
+// solid triangles in RENDER_COLOR, with no attributes
+static raster_shading render_flat_shading(void)
+{
+    raster_shading flat = {0};
+    flat.color = RENDER_COLOR;
+    flat.lighting = RASTER_LIGHTING_NONE;
+    flat.uv_offset = flat.lighting_offset = flat.material_offset = -1;
+    return flat;
+}
+
+void render_model(render_context* ctx, uint32_t* image, vec3f* vertices, int num_vertices, int* indices, int num_indices, mat4 transform, vec3f camera_pos, quat camera_rot)
+{
+    // 1-3. model -> world -> camera -> clip, fused into one matrix and one pass over the vertices
+    PROFILE_BEGIN(PROFILE_VERTEX);
+    mat4 mvp;
+    vertex_build_mvp(ctx->projection, camera_pos, camera_rot, transform, mvp);
+    vec4f* clip_vertices = arena_alloc_array(&ctx->frame_arena, vec4f, num_vertices);
+    vertex_transform_to_clip(vertices, num_vertices, mvp, clip_vertices);
+    PROFILE_END(PROFILE_VERTEX);
+
+    raster_shading flat = render_flat_shading();
+    render_clip_vertices(ctx, image, clip_vertices, num_vertices, indices, num_indices, flat);
+}
+
+void render_model_stream(render_context* ctx, uint32_t* image, const vertex_stream* positions, int* indices, int num_indices, mat4 transform, vec3f camera_pos, quat camera_rot)
+{
+    PROFILE_BEGIN(PROFILE_VERTEX);
+    mat4 mvp;
+    vertex_build_mvp(ctx->projection, camera_pos, camera_rot, transform, mvp);
+    vec4f* clip_vertices = arena_alloc_array(&ctx->frame_arena, vec4f, positions->count);
+    vertex_stream_transform_to_clip(positions, mvp, clip_vertices);
+    PROFILE_END(PROFILE_VERTEX);
+
+    raster_shading flat = render_flat_shading();
+    render_clip_vertices(ctx, image, clip_vertices, positions->count, indices, num_indices, flat);
+}
+
+int render_select_lod(const render_context* ctx, const mesh* m, mat4 transform, vec3f camera_pos)
+{
+    if (m->num_lods <= 1)
+        return 0;
+
+    // the bounding sphere in world space; a non-uniform scale grows it by the largest axis scale
+    vec3f center = {
+        (m->bounds_min.x + m->bounds_max.x) * 0.5f,
+        (m->bounds_min.y + m->bounds_max.y) * 0.5f,
+        (m->bounds_min.z + m->bounds_max.z) * 0.5f
+    };
+    vec3f half = {m->bounds_max.x - center.x, m->bounds_max.y - center.y, m->bounds_max.z - center.z};
+    float scale = 0.0f;
+    for (int col = 0; col < 3; col++)
+    {
+        float s = sqrtf(transform[col * 4] * transform[col * 4] + transform[col * 4 + 1] * transform[col * 4 + 1] +
+                        transform[col * 4 + 2] * transform[col * 4 + 2]);
+        if (s > scale)
+            scale = s;
+    }
+    vec4f world;
+    mat4_transform_vec4f(transform, (vec4f){center.x, center.y, center.z, 1.0f}, &world);
+    float radius = sqrtf(half.x * half.x + half.y * half.y + half.z * half.z) * scale;
+    vec3f d = {world.x - camera_pos.x, world.y - camera_pos.y, world.z - camera_pos.z};
+    float distance = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z) - radius;
+    if (distance <= ctx->znear)
+        return 0;
+
+    // a length of one model unit at that distance covers this many pixels
+    float pixels = scale * (ctx->height * 0.5f) / (tanf(ctx->fov * 0.5f) * distance);
+    for (int l = m->num_lods - 1; l > 0; l--)
+    {
+        if (m->lods[l].error * pixels <= ctx->lod_error_pixels)
+            return l;
+    }
+    return 0;
+}
+
+// one meshlet's vertex attributes for one instance, laid out as b->shading says
+static void render_gather_attributes(const render_batch* b, const int* vertices, int count, int instance, float* out)
+{
+    const mesh* m = b->mesh;
+    const raster_shading* shading = &b->shading;
+    int stride = shading->attribute_count;
+    const float* normal_matrix = b->normal_matrices ? b->normal_matrices + (size_t)instance * 9 : NULL;
+    for (int k = 0; k < count; k++)
+    {
+        int v = vertices[k];
+        float* attributes = out + (size_t)k * stride;
+        int id = m->material_ids ? m->material_ids[v] : 0;
+        if (id < 0 || id >= shading->num_materials)
+            id = 0;
+        if (shading->uv_offset >= 0)
+        {
+            attributes[shading->uv_offset] = m->uvs[v].x;
+            attributes[shading->uv_offset + 1] = m->uvs[v].y;
+        }
+        if (shading->material_offset >= 0)
+        {
+            attributes[shading->material_offset] = (float)id;
+        }
+        if (shading->lighting == RASTER_LIGHTING_NONE)
+            continue;
+
+        vec3f n = m->normals[v];
+        vec3f world = {
+            normal_matrix[0] * n.x + normal_matrix[1] * n.y + normal_matrix[2] * n.z,
+            normal_matrix[3] * n.x + normal_matrix[4] * n.y + normal_matrix[5] * n.z,
+            normal_matrix[6] * n.x + normal_matrix[7] * n.y + normal_matrix[8] * n.z
+        };
+        float* lighting = attributes + shading->lighting_offset;
+        if (shading->lighting == RASTER_LIGHTING_VERTEX)
+        {
+            shade_terms(&shading->light, shading->materials[id].shade.shininess, world, &lighting[0], &lighting[1]);
+        }
+        else
+        {
+            // unit length, so every corner pulls the interpolated normal equally hard
+            float length2 = world.x * world.x + world.y * world.y + world.z * world.z;
+            float scale = length2 > 0.0f ? 1.0f / sqrtf(length2) : 0.0f;
+            lighting[0] = world.x * scale;
+            lighting[1] = world.y * scale;
+            lighting[2] = world.z * scale;
+        }
+    }
+}
+
+// transforms the first `count` entries of the batch into one clip-space array and draws them
+static void render_flush_batch(render_context* ctx, uint32_t* image, render_batch* b, int count)
+{
+    const mesh* m = b->mesh;
+    int num_vertices = 0;
+    int num_indices = 0;
+    for (int e = 0; e < count; e++)
+    {
+        const meshlet* ml = &m->meshlets[b->entries[e].meshlet];
+        num_vertices += (int)ml->vertex_count;
+        num_indices += (int)ml->triangle_count * 3;
+    }
+    if (profiler_enabled)
+    {
+        profiler_record(PROFILE_CULL, b->cull_start, timer_now_ns());
+    }
+
+    // 1-3. transform only the visible meshlets' vertices, each into its own run of the clip array. Instances of the
+    // same meshlet come one after the other, so its positions are still in cache for the next one
+    PROFILE_BEGIN(PROFILE_VERTEX);
+    vec4f* clip_vertices = arena_alloc_array(&ctx->frame_arena, vec4f, num_vertices);
+    int* indices = arena_alloc_array(&ctx->frame_arena, int, num_indices);
+    // the attributes the clipper carries along with the positions: texture coordinates, lighting and material,
+    // whichever the draw needs, interleaved per vertex
+    raster_shading shading = b->shading;
+    float* attributes = NULL;
+    if (shading.attribute_count > 0)
+    {
+        attributes = arena_alloc_array(&ctx->frame_arena, float, (size_t)num_vertices * shading.attribute_count);
+    }
+    int vertex_base = 0;
+    int index_count = 0;
+    for (int e = 0; e < count; e++)
+    {
+        const meshlet* ml = &m->meshlets[b->entries[e].meshlet];
+        vertex_transform_indexed_to_clip(m->positions, m->meshlet_vertices + ml->vertex_offset, (int)ml->vertex_count,
+                                         b->mvps[b->entries[e].instance], clip_vertices + vertex_base);
+        if (attributes)
+        {
+            render_gather_attributes(b, m->meshlet_vertices + ml->vertex_offset, (int)ml->vertex_count,
+                                     b->entries[e].instance, attributes + (size_t)vertex_base * shading.attribute_count);
+        }
+        const uint8_t* local = m->meshlet_triangles + ml->triangle_offset;
+        for (uint32_t k = 0; k < ml->triangle_count * 3; k++)
+        {
+            indices[index_count++] = vertex_base + local[k];
+        }
+        vertex_base += (int)ml->vertex_count;
+    }
+    PROFILE_END(PROFILE_VERTEX);
+
+    shading.attributes = attributes;
+    render_clip_vertices(ctx, image, clip_vertices, num_vertices, indices, num_indices, shading);
+    b->cull_start = profiler_enabled ? timer_now_ns() : 0;
+}
+
+static vec3f render_normalize(vec3f v)
+{
+    float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+    if (length == 0.0f)
+        return v;
+    return (vec3f){v.x / length, v.y / length, v.z / length};
+}
+
+// the materials, light and attribute layout of one solid draw of b->mesh
+static void render_setup_shading(render_context* ctx, render_batch* b, const material* const* materials, quat camera_rot)
+{
+    const mesh* m = b->mesh;
+    raster_shading* shading = &b->shading;
+    *shading = render_flat_shading();
+
+    int num_materials = m->num_materials > 0 ? m->num_materials : 1;
+    raster_material* table = arena_alloc_array(&ctx->frame_arena, raster_material, num_materials);
+    int textured = 0;
+    for (int i = 0; i < num_materials; i++)
+    {
+        const material* mat = materials ? materials[i] : NULL;
+        raster_material* r = &table[i];
+        r->texture = mat && mat->diffuse_map && m->uvs ? mat->diffuse_map : NULL;
+        textured |= r->texture != NULL;
+        if (mat)
+        {
+            memcpy(r->shade.diffuse, mat->diffuse, sizeof(r->shade.diffuse));
+            memcpy(r->shade.specular, mat->specular, sizeof(r->shade.specular));
+            r->shade.shininess = mat->shininess;
+        }
+        else
+        {
+            r->shade.diffuse[0] = ((RENDER_COLOR >> 16) & 0xFF) / 255.0f;
+            r->shade.diffuse[1] = ((RENDER_COLOR >> 8) & 0xFF) / 255.0f;
+            r->shade.diffuse[2] = (RENDER_COLOR & 0xFF) / 255.0f;
+            r->shade.specular[0] = r->shade.specular[1] = r->shade.specular[2] = 0.0f;
+            r->shade.shininess = 1.0f;
+        }
+    }
+    shading->materials = table;
+    shading->num_materials = num_materials;
+
+    if (m->normals && ctx->shading != RENDER_SHADING_UNLIT)
+    {
+        shading->lighting = ctx->shading == RENDER_SHADING_PHONG ? RASTER_LIGHTING_PIXEL : RASTER_LIGHTING_VERTEX;
+        // the viewer looks down the camera's -z, from infinitely far away
+        vec3f to_light = render_normalize(ctx->light_direction);
+        vec3f to_viewer = quat_rotate_vector(camera_rot, (vec3f){0.0f, 0.0f, 1.0f});
+        shading->light.direction = to_light;
+        shading->light.half = render_normalize((vec3f){to_light.x + to_viewer.x, to_light.y + to_viewer.y,
+                                                       to_light.z + to_viewer.z});
+        shading->light.ambient = ctx->ambient < 0.0f ? 0.0f : ctx->ambient > 1.0f ? 1.0f : ctx->ambient;
+    }
+
+    // texture coordinates, then lighting, then the material; only what this draw uses
+    int count = 0;
+    if (textured)
+    {
+        shading->uv_offset = count;
+        count += 2;
+    }
+    if (shading->lighting != RASTER_LIGHTING_NONE)
+    {
+        shading->lighting_offset = count;
+        count += shading->lighting == RASTER_LIGHTING_PIXEL ? 3 : 2;
+    }
+    if (m->material_ids && num_materials > 1 && (textured || shading->lighting != RASTER_LIGHTING_NONE))
+    {
+        shading->material_offset = count;
+        count += 1;
+    }
+    shading->attribute_count = count;
+}
+
+// the inverse transpose of the transform's 3x3 part, which takes normals to world space even through non-uniform
+// scaling, row by row
+static void render_normal_matrix(const float* transform, float out[9])
+{
+    // column-major: the inverse's element (row, col) is inverse[col * 4 + row], and transposing swaps the two
+    mat4 inverse;
+    mat4_inverse(transform, inverse);
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++)
+        {
+            out[row * 3 + col] = inverse[row * 4 + col];
+        }
+    }
+}
+
+void render_mesh_instanced(render_context* ctx, uint32_t* image, const mesh* m, const material* const* materials, const mat4* transforms, int num_instances, vec3f camera_pos, quat camera_rot)
+{
+    if (m->num_meshlets == 0 || num_instances <= 0)
+        return;
+
+    // room for a whole batch, or for everything if that's less; and always for one whole instance
+    size_t max_entries = (size_t)num_instances * (size_t)m->num_meshlets;
+    if (max_entries > RENDER_BATCH_VERTICES)
+        max_entries = RENDER_BATCH_VERTICES;
+    render_batch b = {0};
+    b.mesh = m;
+    int max_instances = num_instances < RENDER_BATCH_INSTANCES ? num_instances : RENDER_BATCH_INSTANCES;
+    if (ctx->mode == RENDER_MODE_SOLID)
+    {
+        render_setup_shading(ctx, &b, materials, camera_rot);
+    }
+    else
+    {
+        b.shading = render_flat_shading();
+    }
+    if (b.shading.lighting != RASTER_LIGHTING_NONE)
+    {
+        b.normal_matrices = arena_alloc_array(&ctx->frame_arena, float, (size_t)max_instances * 9);
+    }
+    b.mvps = arena_alloc_array(&ctx->frame_arena, mat4, max_instances);
+    b.entries = arena_alloc_array(&ctx->frame_arena, render_batch_entry, max_entries + (size_t)m->num_meshlets);
+    b.cull_start = profiler_enabled ? timer_now_ns() : 0;
+
+    for (int i = 0; i < num_instances; i++)
+    {
+        // 0. the whole instance, then its meshlets, all in model space: the frustum planes come straight out of the
+        // MVP, and the camera is moved into model space for the cone test
+        float* transform = (float*)transforms[i];
+        mat4 mvp;
+        vertex_build_mvp(ctx->projection, camera_pos, camera_rot, transform, mvp);
+        if (!render_box_visible(ctx, m->bounds_min, m->bounds_max, mvp))
+            continue;
+        const mesh_lod* lod = &m->lods[render_select_lod(ctx, m, transform, camera_pos)];
+        vec4f planes[6];
+        culling_frustum_planes(mvp, planes);
+
+        // a mirroring transform turns front faces into back faces, and the cone test would get it backwards
+        float det = transform[0] * (transform[5] * transform[10] - transform[9] * transform[6]) -
+                    transform[4] * (transform[1] * transform[10] - transform[9] * transform[2]) +
+                    transform[8] * (transform[1] * transform[6] - transform[5] * transform[2]);
+        int cone_cull = ctx->mode == RENDER_MODE_SOLID && det > 0.0f;
+        vec3f camera = {0.0f, 0.0f, 0.0f};
+        if (cone_cull)
+        {
+            mat4 inverse;
+            mat4_inverse(transform, inverse);
+            vec4f c;
+            mat4_transform_vec4f(inverse, (vec4f){camera_pos.x, camera_pos.y, camera_pos.z, 1.0f}, &c);
+            camera = (vec3f){c.x, c.y, c.z};
+        }
+
+        int first = b.num_entries;
+        int num_vertices = 0;
+        for (int k = (int)lod->meshlet_offset; k < (int)(lod->meshlet_offset + lod->meshlet_count); k++)
+        {
+            const meshlet* ml = &m->meshlets[k];
+            if (culling_sphere_outside(planes, ml->center, ml->radius))
+                continue;
+            if (cone_cull && meshlet_backfacing(ml, camera))
+                continue;
+            // behind what has already been drawn: the box around the bounding sphere against the Hi-Z buffer
+            vec3f box_min = {ml->center.x - ml->radius, ml->center.y - ml->radius, ml->center.z - ml->radius};
+            vec3f box_max = {ml->center.x + ml->radius, ml->center.y + ml->radius, ml->center.z + ml->radius};
+            if (!render_box_visible(ctx, box_min, box_max, mvp))
+                continue;
+            b.entries[b.num_entries++] = (render_batch_entry){k, b.num_instances};
+            num_vertices += (int)ml->vertex_count;
+        }
+        if (b.num_entries == first)
+            continue;
+
+        // this instance would overflow the batch: draw what came before it, and start the next batch with it
+        if (first > 0 && b.num_vertices + num_vertices > RENDER_BATCH_VERTICES)
+        {
+            render_flush_batch(ctx, image, &b, first);
+            b.num_entries -= first;
+            memmove(b.entries, b.entries + first, (size_t)b.num_entries * sizeof(render_batch_entry));
+            for (int e = 0; e < b.num_entries; e++)
+            {
+                b.entries[e].instance = 0;
+            }
+            b.num_instances = 0;
+            b.num_vertices = 0;
+        }
+        if (b.normal_matrices)
+        {
+            render_normal_matrix(transform, b.normal_matrices + (size_t)b.num_instances * 9);
+        }
+        memcpy(b.mvps[b.num_instances++], mvp, sizeof(mat4));
+        b.num_vertices += num_vertices;
+
+        if (b.num_instances == RENDER_BATCH_INSTANCES)
+        {
+            render_flush_batch(ctx, image, &b, b.num_entries);
+            b.num_instances = b.num_entries = b.num_vertices = 0;
+        }
+    }
+    if (b.num_entries > 0)
+    {
+        render_flush_batch(ctx, image, &b, b.num_entries);
+    }
+}
+
+void render_mesh(render_context* ctx, uint32_t* image, const mesh* m, const material* const* materials, mat4 transform, vec3f camera_pos, quat camera_rot)
+{
+    render_mesh_instanced(ctx, image, m, materials, (const mat4*)transform, 1, camera_pos, camera_rot);
+}
@@ -0,0 +1,203 @@
+// sort-middle binning: post-clip triangles are sorted into screen tiles, then tiles are rasterized in parallel
+#include "tiles.h"
+#include "hiz.h"
+
+#include <math.h>
+
+// plain compares; fminf/fmaxf handle NaN specially and usually end up as library calls
+static inline float minf(float a, float b) { return a < b ? a : b; }
+static inline float maxf(float a, float b) { return a > b ? a : b; }
+
+// pixel range a triangle's bounding box covers along one axis, clamped to [0, size). Uses the same snapping as the
+// rasterizer, so a triangle is binned into every tile it could write to and no others.
+static int tiles_pixel_range(float a, float b, float c, int size, int* lo, int* hi)
+{
+    float min = minf(a, minf(b, c));
+    float max = maxf(a, maxf(b, c));
+    if (max < 0.0f || min >= (float)size)
+        return 0;
+
+    min = maxf(min, 0.0f);
+    max = minf(max, (float)size);
+    *lo = (int)(lrintf(min * RASTER_SUBPIXEL_ONE) >> RASTER_SUBPIXEL_BITS);
+    *hi = (int)(lrintf(max * RASTER_SUBPIXEL_ONE) >> RASTER_SUBPIXEL_BITS);
+    if (*hi >= size)
+    {
+        *hi = size - 1;
+    }
+    return *lo <= *hi;
+}
+
+// the tile rectangle a triangle touches, or 0 if it is entirely off screen
+static int tiles_triangle_rect(const vec4f* v, const int* tri, int width, int height,
+                               int* tx0, int* ty0, int* tx1, int* ty1)
+{
+    const vec4f* a = &v[tri[0]];
+    const vec4f* b = &v[tri[1]];
+    const vec4f* c = &v[tri[2]];
+
+    int x0, x1, y0, y1;
+    if (!tiles_pixel_range(a->x, b->x, c->x, width, &x0, &x1) ||
+        !tiles_pixel_range(a->y, b->y, c->y, height, &y0, &y1))
+        return 0;
+
+    *tx0 = x0 / TILE_SIZE;
+    *ty0 = y0 / TILE_SIZE;
+    *tx1 = x1 / TILE_SIZE;
+    *ty1 = y1 / TILE_SIZE;
+    return 1;
+}
+
+void tiles_bin_triangles(arena* frame_arena, const vec4f* screen_vertices, const int* indices, int num_indices,
+                         int width, int height, tile_bins* out)
+{
+    out->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    out->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    int num_tiles = out->tiles_x * out->tiles_y;
+    int num_triangles = num_indices / 3;
+
+    // two passes: count what lands in each tile, then fill in exactly-sized lists. This keeps the lists in one
+    // contiguous array and every tile's list in triangle order.
+    int* offsets = arena_alloc_array(frame_arena, int, num_tiles + 1);
+    for (int t = 0; t <= num_tiles; t++)
+    {
+        offsets[t] = 0;
+    }
+
+    for (int i = 0; i < num_triangles; i++)
+    {
+        int tx0, ty0, tx1, ty1;
+        if (!tiles_triangle_rect(screen_vertices, &indices[i * 3], width, height, &tx0, &ty0, &tx1, &ty1))
+            continue;
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                offsets[ty * out->tiles_x + tx + 1]++;
+            }
+        }
+    }
+
+    for (int t = 0; t < num_tiles; t++)
+    {
+        offsets[t + 1] += offsets[t];
+    }
+
+    int* cursor = arena_alloc_array(frame_arena, int, num_tiles);
+    for (int t = 0; t < num_tiles; t++)
+    {
+        cursor[t] = offsets[t];
+    }
+    int* triangles = arena_alloc_array(frame_arena, int, offsets[num_tiles] > 0 ? offsets[num_tiles] : 1);
+
+    for (int i = 0; i < num_triangles; i++)
+    {
+        int tx0, ty0, tx1, ty1;
+        if (!tiles_triangle_rect(screen_vertices, &indices[i * 3], width, height, &tx0, &ty0, &tx1, &ty1))
+            continue;
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                triangles[cursor[ty * out->tiles_x + tx]++] = i;
+            }
+        }
+    }
+
+    out->offsets = offsets;
+    out->triangles = triangles;
+}
+
+typedef struct tiles_fill_job
+{
+    const tile_bins* bins;
+    const raster_target* target;
+    const vec4f* screen_vertices;
+    const int* indices;
+    const raster_shading* shading;
+    dirty_tiles* drawn;
+} tiles_fill_job;
+
+static void tiles_fill_tile(void* data, int tile, int worker)
+{
+    (void)worker;
+    const tiles_fill_job* job = data;
+    const tile_bins* bins = job->bins;
+
+    int first = bins->offsets[tile];
+    int last = bins->offsets[tile + 1];
+    if (first == last)
+        return;
+
+    // same buffers, but only this tile's pixels
+    raster_target target = *job->target;
+    int x = (tile % bins->tiles_x) * TILE_SIZE;
+    int y = (tile / bins->tiles_x) * TILE_SIZE;
+    if (x > target.x0) target.x0 = x;
+    if (y > target.y0) target.y0 = y;
+    if (x + TILE_SIZE < target.x1) target.x1 = x + TILE_SIZE;
+    if (y + TILE_SIZE < target.y1) target.y1 = y + TILE_SIZE;
+    if (target.x0 >= target.x1 || target.y0 >= target.y1)
+        return;
+
+    hiz_buffer* hiz = target.hiz;
+    const raster_shading* shading = job->shading;
+    int drew = 0;
+    for (int i = first; i < last; i++)
+    {
+        const int* tri = &job->indices[bins->triangles[i] * 3];
+        vec4f a = job->screen_vertices[tri[0]];
+        vec4f b = job->screen_vertices[tri[1]];
+        vec4f c = job->screen_vertices[tri[2]];
+
+        // behind everything that was in this tile when the tile started
+        if (hiz && minf(a.z, minf(b.z, c.z)) >= hiz->tile_max[tile])
+            continue;
+        // the material comes from the first corner; the corners of a triangle always share one
+        const float* attributes[3] = { NULL, NULL, NULL };
+        const raster_material* material = NULL;
+        if (shading->attributes)
+        {
+            int stride = shading->attribute_count;
+            attributes[0] = shading->attributes + (size_t)tri[0] * stride;
+            attributes[1] = shading->attributes + (size_t)tri[1] * stride;
+            attributes[2] = shading->attributes + (size_t)tri[2] * stride;
+        }
+        if (shading->num_materials > 0)
+        {
+            long id = shading->material_offset >= 0 ? lrintf(attributes[0][shading->material_offset]) : 0;
+            if (id < 0) id = 0;
+            if (id >= shading->num_materials) id = shading->num_materials - 1;
+            material = &shading->materials[id];
+        }
+
+        if (shading->lighting == RASTER_LIGHTING_NONE &&
+            (!material || !material->texture || shading->uv_offset < 0))
+        {
+            raster_fill_triangle(&target, a, b, c, shading->color);
+        }
+        else
+        {
+            raster_fill_triangle_shaded(&target, a, b, c, shading, material, attributes);
+        }
+        drew = 1;
+    }
+    // conservative: a triangle that reaches the tile's rectangle may still cover none of its pixels
+    if (drew && job->drawn)
+    {
+        job->drawn->tiles[tile] = 1;
+    }
+
+    if (hiz)
+    {
+        hiz_update_tile(hiz, tile);
+    }
+}
+
+void tiles_fill_model(threadpool* pool, const tile_bins* bins, const raster_target* target,
+                      const vec4f* screen_vertices, const int* indices, const raster_shading* shading,
+                      dirty_tiles* drawn)
+{
+    tiles_fill_job job = { bins, target, screen_vertices, indices, shading, drawn };
+    threadpool_run(pool, tiles_fill_tile, &job, bins->tiles_x * bins->tiles_y);
+}
@@ -0,0 +1,278 @@
+// the vertex stage: model space to clip space in one pass, then clip space to screen space in another
+/*
+    Every kernel here has a scalar version and, where the compiler allows it (see simd.h), SSE2 and AVX2 versions.
+    The SIMD versions use separate multiplies and adds in the same order as the scalar code rather than FMA, so all
+    three produce bit-identical output and switching instruction sets never changes a rendered frame.
+*/
+#include "vertex.h"
+#include "camera.h"
+#include "simd.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+int vertex_stream_init(vertex_stream* stream, const vec3f* vertices, int num_vertices)
+{
+    // round each array up to a whole number of cache lines so the next one starts aligned too
+    size_t stride = ((size_t)num_vertices * sizeof(float) + VERTEX_STREAM_ALIGN - 1) & ~(size_t)(VERTEX_STREAM_ALIGN - 1);
+    stream->block = malloc(3 * stride + VERTEX_STREAM_ALIGN);
+    if (!stream->block)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+
+    uintptr_t base = ((uintptr_t)stream->block + VERTEX_STREAM_ALIGN - 1) & ~(uintptr_t)(VERTEX_STREAM_ALIGN - 1);
+    stream->x = (float*)base;
+    stream->y = (float*)(base + stride);
+    stream->z = (float*)(base + 2 * stride);
+    stream->count = num_vertices;
+
+    for (int i = 0; i < num_vertices; i++)
+    {
+        stream->x[i] = vertices[i].x;
+        stream->y[i] = vertices[i].y;
+        stream->z[i] = vertices[i].z;
+    }
+    return 0;
+}
+
+void vertex_stream_destroy(vertex_stream* stream)
+{
+    free(stream->block);
+    stream->block = NULL;
+    stream->x = stream->y = stream->z = NULL;
+    stream->count = 0;
+}
+
+void vertex_build_mvp(mat4 projection, vec3f camera_pos, quat camera_rot, mat4 model, mat4 out)
+{
+    mat4 view;
+    camera_view_matrix(camera_pos, camera_rot, view);
+
+    mat4 view_model;
+    mat4_multiply(view, model, view_model);
+    mat4_multiply(projection, view_model, out);
+}
+
+// one vertex, scalar; the SIMD loops use this for their leftovers
+static inline void vertex_transform_one(const mat4 m, float x, float y, float z, vec4f* out)
+{
+    out->x = m[0] * x + m[4] * y + m[8] * z + m[12];
+    out->y = m[1] * x + m[5] * y + m[9] * z + m[13];
+    out->z = m[2] * x + m[6] * y + m[10] * z + m[14];
+    out->w = m[3] * x + m[7] * y + m[11] * z + m[15];
+}
+
+#ifdef RENDER_SSE2
+// row r of the matrix dotted with (x, y, z, 1), four vertices at once
+static inline __m128 sse_row(const __m128* m, int r, __m128 x, __m128 y, __m128 z)
+{
+    __m128 acc = _mm_mul_ps(m[r], x);
+    acc = _mm_add_ps(acc, _mm_mul_ps(m[4 + r], y));
+    acc = _mm_add_ps(acc, _mm_mul_ps(m[8 + r], z));
+    return _mm_add_ps(acc, m[12 + r]);
+}
+
+// four vertices from separate x/y/z/w registers back into four consecutive vec4f
+static inline void sse_store_aos(vec4f* out, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&out[0].x, x);
+    _mm_storeu_ps(&out[1].x, y);
+    _mm_storeu_ps(&out[2].x, z);
+    _mm_storeu_ps(&out[3].x, w);
+}
+#endif
+
+#ifdef RENDER_AVX2
+static inline __m256 avx_row(const __m256* m, int r, __m256 x, __m256 y, __m256 z)
+{
+    __m256 acc = _mm256_mul_ps(m[r], x);
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(m[4 + r], y));
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(m[8 + r], z));
+    return _mm256_add_ps(acc, m[12 + r]);
+}
+
+// eight vertices from x/y/z/w registers into eight consecutive vec4f: a 4x4 transpose in each 128-bit lane,
+// then the lanes are swapped around so vertex order is preserved
+static inline void avx_store_aos(vec4f* out, __m256 x, __m256 y, __m256 z, __m256 w)
+{
+    __m256 t0 = _mm256_unpacklo_ps(x, y); // x0 y0 x1 y1 | x4 y4 x5 y5
+    __m256 t1 = _mm256_unpackhi_ps(x, y); // x2 y2 x3 y3 | x6 y6 x7 y7
+    __m256 t2 = _mm256_unpacklo_ps(z, w);
+    __m256 t3 = _mm256_unpackhi_ps(z, w);
+    __m256 v0 = _mm256_shuffle_ps(t0, t2, 0x44); // vertex 0 | vertex 4
+    __m256 v1 = _mm256_shuffle_ps(t0, t2, 0xEE); // vertex 1 | vertex 5
+    __m256 v2 = _mm256_shuffle_ps(t1, t3, 0x44);
+    __m256 v3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+    _mm256_storeu_ps(&out[0].x, _mm256_permute2f128_ps(v0, v1, 0x20));
+    _mm256_storeu_ps(&out[2].x, _mm256_permute2f128_ps(v2, v3, 0x20));
+    _mm256_storeu_ps(&out[4].x, _mm256_permute2f128_ps(v0, v1, 0x31));
+    _mm256_storeu_ps(&out[6].x, _mm256_permute2f128_ps(v2, v3, 0x31));
+}
+
+// the inverse of avx_store_aos: eight consecutive vec4f into x/y/z/w registers
+static inline void avx_load_soa(const vec4f* in, __m256* x, __m256* y, __m256* z, __m256* w)
+{
+    __m256 a = _mm256_loadu_ps(&in[0].x); // vertex 0 | vertex 1
+    __m256 b = _mm256_loadu_ps(&in[2].x);
+    __m256 c = _mm256_loadu_ps(&in[4].x);
+    __m256 d = _mm256_loadu_ps(&in[6].x);
+    __m256 p0 = _mm256_permute2f128_ps(a, c, 0x20); // vertex 0 | vertex 4
+    __m256 p1 = _mm256_permute2f128_ps(a, c, 0x31); // vertex 1 | vertex 5
+    __m256 p2 = _mm256_permute2f128_ps(b, d, 0x20);
+    __m256 p3 = _mm256_permute2f128_ps(b, d, 0x31);
+    __m256 t0 = _mm256_unpacklo_ps(p0, p1); // x0 x1 y0 y1 | x4 x5 y4 y5
+    __m256 t1 = _mm256_unpackhi_ps(p0, p1); // z0 z1 w0 w1 | z4 z5 w4 w5
+    __m256 t2 = _mm256_unpacklo_ps(p2, p3);
+    __m256 t3 = _mm256_unpackhi_ps(p2, p3);
+    *x = _mm256_shuffle_ps(t0, t2, 0x44);
+    *y = _mm256_shuffle_ps(t0, t2, 0xEE);
+    *z = _mm256_shuffle_ps(t1, t3, 0x44);
+    *w = _mm256_shuffle_ps(t1, t3, 0xEE);
+}
+#endif
+
+void vertex_transform_to_clip(const vec3f* vertices, int num_vertices, const mat4 mvp, vec4f* out_vertices)
+{
+    int i = 0;
+
+#ifdef RENDER_SSE2
+    __m128 m[16];
+    for (int k = 0; k < 16; k++)
+    {
+        m[k] = _mm_set1_ps(mvp[k]);
+    }
+
+    // four packed vec3f are three registers: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+    for (; i + 4 <= num_vertices; i += 4)
+    {
+        const float* p = &vertices[i].x;
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+
+        __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+        __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                                  _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                                  _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+        sse_store_aos(&out_vertices[i], sse_row(m, 0, x, y, z), sse_row(m, 1, x, y, z),
+                      sse_row(m, 2, x, y, z), sse_row(m, 3, x, y, z));
+    }
+#endif
+
+    for (; i < num_vertices; i++)
+    {
+        vertex_transform_one(mvp, vertices[i].x, vertices[i].y, vertices[i].z, &out_vertices[i]);
+    }
+}
+
+void vertex_transform_indexed_to_clip(const vec3f* vertices, const int* remap, int count, const mat4 mvp, vec4f* out_vertices)
+{
+    // a gather; the loads are scattered anyway, so there's nothing for the SIMD paths to win here
+    for (int i = 0; i < count; i++)
+    {
+        const vec3f* v = &vertices[remap[i]];
+        vertex_transform_one(mvp, v->x, v->y, v->z, &out_vertices[i]);
+    }
+}
+
+void vertex_stream_transform_to_clip(const vertex_stream* stream, const mat4 mvp, vec4f* out_vertices)
+{
+    int i = 0;
+    int n = stream->count;
+
+#if defined(RENDER_AVX2)
+    __m256 m[16];
+    for (int k = 0; k < 16; k++)
+    {
+        m[k] = _mm256_set1_ps(mvp[k]);
+    }
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 x = _mm256_load_ps(stream->x + i);
+        __m256 y = _mm256_load_ps(stream->y + i);
+        __m256 z = _mm256_load_ps(stream->z + i);
+        avx_store_aos(&out_vertices[i], avx_row(m, 0, x, y, z), avx_row(m, 1, x, y, z),
+                      avx_row(m, 2, x, y, z), avx_row(m, 3, x, y, z));
+    }
+#elif defined(RENDER_SSE2)
+    __m128 m[16];
+    for (int k = 0; k < 16; k++)
+    {
+        m[k] = _mm_set1_ps(mvp[k]);
+    }
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_load_ps(stream->x + i);
+        __m128 y = _mm_load_ps(stream->y + i);
+        __m128 z = _mm_load_ps(stream->z + i);
+        sse_store_aos(&out_vertices[i], sse_row(m, 0, x, y, z), sse_row(m, 1, x, y, z),
+                      sse_row(m, 2, x, y, z), sse_row(m, 3, x, y, z));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        vertex_transform_one(mvp, stream->x[i], stream->y[i], stream->z[i], &out_vertices[i]);
+    }
+}
+
+void vertex_project_to_screen(vec4f* vertices, int num_vertices, int width, int height)
+{
+    const float w_px = (float)width;
+    const float h_px = (float)height;
+    int i = 0;
+
+#if defined(RENDER_AVX2)
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 wv = _mm256_set1_ps(w_px);
+    const __m256 hv = _mm256_set1_ps(h_px);
+    for (; i + 8 <= num_vertices; i += 8)
+    {
+        __m256 x, y, z, w;
+        avx_load_soa(&vertices[i], &x, &y, &z, &w);
+        x = _mm256_div_ps(x, w);
+        y = _mm256_div_ps(y, w);
+        z = _mm256_div_ps(z, w);
+        x = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(x, one), half), wv);
+        y = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(_mm256_add_ps(y, one), half)), hv);
+        avx_store_aos(&vertices[i], x, y, z, w);
+    }
+#elif defined(RENDER_SSE2)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 wv = _mm_set1_ps(w_px);
+    const __m128 hv = _mm_set1_ps(h_px);
+    for (; i + 4 <= num_vertices; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&vertices[i].x);
+        __m128 y = _mm_loadu_ps(&vertices[i + 1].x);
+        __m128 z = _mm_loadu_ps(&vertices[i + 2].x);
+        __m128 w = _mm_loadu_ps(&vertices[i + 3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        x = _mm_div_ps(x, w);
+        y = _mm_div_ps(y, w);
+        z = _mm_div_ps(z, w);
+        x = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(x, one), half), wv);
+        y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(_mm_add_ps(y, one), half)), hv);
+        sse_store_aos(&vertices[i], x, y, z, w);
+    }
+#endif
+
+    for (; i < num_vertices; i++)
+    {
+        vec4f* v = &vertices[i];
+        float x = v->x / v->w;
+        float y = v->y / v->w;
+        v->z = v->z / v->w;
+        v->x = (x + 1.0f) * 0.5f * w_px;
+        v->y = (1.0f - (y + 1.0f) * 0.5f) * h_px; // flip Y axis
+    }
+}
@@ -0,0 +1,475 @@
+// filled-triangle rasterizer: half-space edge functions, fixed-point vertices, 8x8 block traversal
+/*
+    For a triangle with (positive) area, a pixel sample p is inside iff all three edge functions
+        E(p) = A * p.x + B * p.y + C
+    are >= 0. Moving one pixel right adds A * RASTER_SUBPIXEL_ONE and one pixel down adds B * RASTER_SUBPIXEL_ONE,
+    so once E is known at a block's corner, every other value in the block is a running sum.
+
+    Because E is linear, its largest and smallest values over a block are at two of the block's corners, which
+    gives the trivial reject (largest < 0 for some edge) and trivial accept (smallest >= 0 for every edge) tests.
+
+    Fill rule: a sample exactly on an edge belongs to the triangle only if that edge is a top or left edge. That is
+    folded into C as a -1 bias on the other edges, so the inner loop only ever compares against zero.
+*/
+#include "raster.h"
+#include "hiz.h"
+#include "texture.h"
+
+#include <math.h>
+
+typedef struct raster_edge
+{
+    int64_t a, b, c;
+} raster_edge;
+
+// edge from p to q, oriented so the triangle's interior is where E >= 0
+static raster_edge raster_make_edge(int64_t px, int64_t py, int64_t qx, int64_t qy)
+{
+    raster_edge e;
+    e.a = py - qy;
+    e.b = qx - px;
+    e.c = -(e.a * px + e.b * py);
+
+    // with y pointing down and positive area, top edges are horizontal with b > 0, left edges have a > 0
+    int top_left = e.a > 0 || (e.a == 0 && e.b > 0);
+    if (!top_left)
+    {
+        e.c -= 1;
+    }
+    return e;
+}
+
+// E at the pixel center of (x, y)
+static inline int64_t raster_edge_at(const raster_edge* e, int x, int y)
+{
+    int64_t sx = ((int64_t)x << RASTER_SUBPIXEL_BITS) + RASTER_SUBPIXEL_ONE / 2;
+    int64_t sy = ((int64_t)y << RASTER_SUBPIXEL_BITS) + RASTER_SUBPIXEL_ONE / 2;
+    return e->a * sx + e->b * sy + e->c;
+}
+
+// plain compares; fminf/fmaxf handle NaN specially and usually end up as library calls
+static inline float minf(float a, float b) { return a < b ? a : b; }
+static inline float maxf(float a, float b) { return a > b ? a : b; }
+static inline int64_t min64(int64_t a, int64_t b) { return a < b ? a : b; }
+static inline int64_t max64(int64_t a, int64_t b) { return a > b ? a : b; }
+
+// values interpolated perspective-correctly across one triangle: the texture coordinate (u, v) and the lighting terms
+#define RASTER_VARYINGS 5
+#define RASTER_VARYING_UV 0
+#define RASTER_VARYING_LIGHTING 2
+
+// a triangle's values divided by w, along with q = 1 / w: all of them are affine in screen space, so like depth they
+// are a value at vertex a plus steps per pixel in x and y
+typedef struct raster_varyings
+{
+    const texture* texture; // NULL to light plain white
+    raster_lighting lighting;
+    const shade_light* light;
+    const shade_material* material;
+    float ax, ay; // vertex a, snapped
+    float q, dqdx, dqdy; // at vertex a
+    float q_min, q_max; // q's range over the triangle
+    float value[RASTER_VARYINGS], ddx[RASTER_VARYINGS], ddy[RASTER_VARYINGS];
+} raster_varyings;
+
+// steps in x and y of the plane through (a, va), (b, vb), (c, vc), as for depth
+static inline void raster_gradient(float va, float vb, float vc, float ax, float ay, float bx, float by, float cx,
+                                   float cy, float det, float* ddx, float* ddy)
+{
+    *ddx = ((vb - va) * (cy - ay) - (vc - va) * (by - ay)) / det;
+    *ddy = ((vc - va) * (bx - ax) - (vb - va) * (cx - ax)) / det;
+}
+
+// one varying at (px, py), relative to vertex a
+static inline float raster_varying_at(const raster_varyings* v, int k, float px, float py)
+{
+    return v->value[k] + v->ddx[k] * px + v->ddy[k] * py;
+}
+
+// the shaded counterpart of one block's pixel loops below. `e_row` holds the edge functions at (x_start, y_start),
+// or is NULL if the block is fully covered; without `depth_test`, every covered pixel is drawn.
+static void raster_shaded_block(const raster_target* target, const raster_varyings* v, int block_x, int block_y,
+                                int x_start, int x_end, int y_start, int y_end, float z_row, float dzdx, float dzdy,
+                                const int64_t* e_row, const int64_t* step_x, const int64_t* step_y, int depth_test)
+{
+    // the mip level where a pixel at the block's center covers about one texel. The center may be outside the
+    // triangle, so q is kept to the triangle's range: it can't be extrapolated past zero there.
+    const texture* tex = v->texture;
+    const texture_level* level = NULL;
+    if (tex)
+    {
+        float cx = block_x + RASTER_BLOCK_SIZE * 0.5f - v->ax;
+        float cy = block_y + RASTER_BLOCK_SIZE * 0.5f - v->ay;
+        float q = minf(maxf(v->q + v->dqdx * cx + v->dqdy * cy, v->q_min), v->q_max);
+        float u = raster_varying_at(v, RASTER_VARYING_UV, cx, cy) / q;
+        float t = raster_varying_at(v, RASTER_VARYING_UV + 1, cx, cy) / q;
+        float width = (float)tex->levels[0].width, height = (float)tex->levels[0].height;
+        const float* ddx = v->ddx + RASTER_VARYING_UV;
+        const float* ddy = v->ddy + RASTER_VARYING_UV;
+        float dudx = (ddx[0] - u * v->dqdx) / q * width, dvdx = (ddx[1] - t * v->dqdx) / q * height;
+        float dudy = (ddy[0] - u * v->dqdy) / q * width, dvdy = (ddy[1] - t * v->dqdy) / q * height;
+        float rho_squared = maxf(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+        level = &tex->levels[texture_select_level(tex, rho_squared)];
+    }
+
+    int64_t e[3] = { 0, 0, 0 };
+    if (e_row)
+    {
+        e[0] = e_row[0];
+        e[1] = e_row[1];
+        e[2] = e_row[2];
+    }
+    uint32_t colors[RASTER_BLOCK_SIZE];
+    for (int y = y_start; y <= y_end; y++)
+    {
+        int row = y * target->stride;
+
+        // which pixels of the row get drawn, and the span of them that needs shading
+        unsigned pass = 0;
+        int first = RASTER_BLOCK_SIZE, last = -1;
+        int64_t e0 = e[0], e1 = e[1], e2 = e[2];
+        float z = z_row;
+        for (int x = x_start; x <= x_end; x++)
+        {
+            if ((!e_row || (e0 | e1 | e2) >= 0) && (!depth_test || z < target->depth[row + x]))
+            {
+                pass |= 1u << (x - x_start);
+                if (first > x - x_start)
+                    first = x - x_start;
+                last = x - x_start;
+            }
+            e0 += step_x[0];
+            e1 += step_x[1];
+            e2 += step_x[2];
+            z += dzdx;
+        }
+
+        if (pass)
+        {
+            float px = x_start + first + 0.5f - v->ax, py = y + 0.5f - v->ay;
+            float q = v->q + v->dqdx * px + v->dqdy * py;
+            int count = last - first + 1;
+            if (tex)
+            {
+                texture_sample_span(level, raster_varying_at(v, RASTER_VARYING_UV, px, py),
+                                    raster_varying_at(v, RASTER_VARYING_UV + 1, px, py), q,
+                                    v->ddx[RASTER_VARYING_UV], v->ddx[RASTER_VARYING_UV + 1], v->dqdx, count, colors);
+            }
+            else
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    colors[i] = 0xFFFFFFFFu;
+                }
+            }
+
+            const int l = RASTER_VARYING_LIGHTING;
+            if (v->lighting == RASTER_LIGHTING_VERTEX)
+            {
+                shade_span_vertex(v->material, raster_varying_at(v, l, px, py), raster_varying_at(v, l + 1, px, py), q,
+                                  v->ddx[l], v->ddx[l + 1], v->dqdx, count, colors, colors);
+            }
+            else if (v->lighting == RASTER_LIGHTING_PIXEL)
+            {
+                vec3f n = { raster_varying_at(v, l, px, py), raster_varying_at(v, l + 1, px, py),
+                            raster_varying_at(v, l + 2, px, py) };
+                vec3f dn = { v->ddx[l], v->ddx[l + 1], v->ddx[l + 2] };
+                shade_span_pixel(v->material, v->light, n, dn, count, colors, colors);
+            }
+
+            z = z_row;
+            for (int x = x_start; x <= x_end; x++)
+            {
+                if (pass & (1u << (x - x_start)))
+                {
+                    target->depth[row + x] = z;
+                    target->color[row + x] = colors[x - x_start - first];
+                }
+                z += dzdx;
+            }
+        }
+
+        e[0] += step_y[0];
+        e[1] += step_y[1];
+        e[2] += step_y[2];
+        z_row += dzdy;
+    }
+}
+
+// raster_fill_triangle, and with a shading (and its material and attributes) raster_fill_triangle_shaded: the setup
+// and block walk are shared, only the pixel loops differ
+static inline void raster_fill(const raster_target* target, vec4f a, vec4f b, vec4f c, uint32_t color,
+                               const raster_shading* shading, const raster_material* material,
+                               const float* const* attributes)
+{
+    // snap to the subpixel grid
+    int64_t x0 = lrintf(a.x * RASTER_SUBPIXEL_ONE), y0 = lrintf(a.y * RASTER_SUBPIXEL_ONE);
+    int64_t x1 = lrintf(b.x * RASTER_SUBPIXEL_ONE), y1 = lrintf(b.y * RASTER_SUBPIXEL_ONE);
+    int64_t x2 = lrintf(c.x * RASTER_SUBPIXEL_ONE), y2 = lrintf(c.y * RASTER_SUBPIXEL_ONE);
+
+    const float* attr_a = NULL;
+    const float* attr_b = NULL;
+    const float* attr_c = NULL;
+    if (shading)
+    {
+        attr_a = attributes[0];
+        attr_b = attributes[1];
+        attr_c = attributes[2];
+    }
+
+    int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+    if (area == 0)
+        return; // degenerate, covers no samples
+    if (area < 0)
+    {
+        // make the winding consistent so "inside" is always E >= 0
+        int64_t tx = x1, ty = y1;
+        x1 = x2; y1 = y2;
+        x2 = tx; y2 = ty;
+        vec4f tv = b; b = c; c = tv;
+        const float* tattr = attr_b; attr_b = attr_c; attr_c = tattr;
+        area = -area;
+    }
+
+    // bounding box in whole pixels, clipped to the target rectangle
+    int64_t min_x = max64(min64(x0, min64(x1, x2)), (int64_t)target->x0 << RASTER_SUBPIXEL_BITS);
+    int64_t min_y = max64(min64(y0, min64(y1, y2)), (int64_t)target->y0 << RASTER_SUBPIXEL_BITS);
+    int64_t max_x = min64(max64(x0, max64(x1, x2)), ((int64_t)target->x1 << RASTER_SUBPIXEL_BITS) - 1);
+    int64_t max_y = min64(max64(y0, max64(y1, y2)), ((int64_t)target->y1 << RASTER_SUBPIXEL_BITS) - 1);
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    int px0 = (int)(min_x >> RASTER_SUBPIXEL_BITS);
+    int py0 = (int)(min_y >> RASTER_SUBPIXEL_BITS);
+    int px1 = (int)(max_x >> RASTER_SUBPIXEL_BITS); // inclusive
+    int py1 = (int)(max_y >> RASTER_SUBPIXEL_BITS);
+
+    raster_edge edges[3] = {
+        raster_make_edge(x1, y1, x2, y2),
+        raster_make_edge(x2, y2, x0, y0),
+        raster_make_edge(x0, y0, x1, y1)
+    };
+
+    // depth is affine in screen space: z(x, y) = z0 + dzdx * (x - ax) + dzdy * (y - ay), using the snapped positions
+    float ax = (float)x0 / RASTER_SUBPIXEL_ONE, ay = (float)y0 / RASTER_SUBPIXEL_ONE;
+    float bx = (float)x1 / RASTER_SUBPIXEL_ONE, by = (float)y1 / RASTER_SUBPIXEL_ONE;
+    float cx = (float)x2 / RASTER_SUBPIXEL_ONE, cy = (float)y2 / RASTER_SUBPIXEL_ONE;
+    float det = (bx - ax) * (cy - ay) - (cx - ax) * (by - ay);
+    float dzdx = ((b.z - a.z) * (cy - ay) - (c.z - a.z) * (by - ay)) / det;
+    float dzdy = ((c.z - a.z) * (bx - ax) - (b.z - a.z) * (cx - ax)) / det;
+    float tri_zmin = minf(a.z, minf(b.z, c.z));
+    float tri_zmax = maxf(a.z, maxf(b.z, c.z));
+    // how much depth can rise / fall from a block's first pixel center to its last, in x and y
+    float dz_span_lo = minf(dzdx, 0.0f) * (RASTER_BLOCK_SIZE - 1) + minf(dzdy, 0.0f) * (RASTER_BLOCK_SIZE - 1);
+    float dz_span_hi = maxf(dzdx, 0.0f) * (RASTER_BLOCK_SIZE - 1) + maxf(dzdy, 0.0f) * (RASTER_BLOCK_SIZE - 1);
+    struct hiz_buffer* hiz = target->hiz;
+
+    raster_varyings vary = {0};
+    if (shading)
+    {
+        float qa = 1.0f / a.w, qb = 1.0f / b.w, qc = 1.0f / c.w;
+        vary.texture = shading->uv_offset >= 0 ? material->texture : NULL;
+        vary.lighting = shading->lighting;
+        vary.light = &shading->light;
+        vary.material = &material->shade;
+        vary.ax = ax;
+        vary.ay = ay;
+        vary.q = qa;
+        raster_gradient(qa, qb, qc, ax, ay, bx, by, cx, cy, det, &vary.dqdx, &vary.dqdy);
+        vary.q_min = minf(qa, minf(qb, qc));
+        vary.q_max = maxf(qa, maxf(qb, qc));
+
+        // which varyings this triangle needs, and where in the attributes they come from
+        int source[RASTER_VARYINGS] = { -1, -1, -1, -1, -1 };
+        if (vary.texture)
+        {
+            source[RASTER_VARYING_UV] = shading->uv_offset;
+            source[RASTER_VARYING_UV + 1] = shading->uv_offset + 1;
+        }
+        int lighting_count = vary.lighting == RASTER_LIGHTING_VERTEX ? 2 : vary.lighting == RASTER_LIGHTING_PIXEL ? 3 : 0;
+        for (int k = 0; k < lighting_count; k++)
+        {
+            source[RASTER_VARYING_LIGHTING + k] = shading->lighting_offset + k;
+        }
+        for (int k = 0; k < RASTER_VARYINGS; k++)
+        {
+            if (source[k] < 0)
+                continue;
+            vary.value[k] = attr_a[source[k]] * qa;
+            raster_gradient(vary.value[k], attr_b[source[k]] * qb, attr_c[source[k]] * qc, ax, ay, bx, by, cx, cy,
+                            det, &vary.ddx[k], &vary.ddy[k]);
+        }
+    }
+
+    // per-pixel and per-row steps of each edge function
+    int64_t step_x[3], step_y[3];
+    // offsets from a block's top-left pixel to its corner with the largest / smallest E
+    int64_t to_max[3], to_min[3];
+    const int span = RASTER_BLOCK_SIZE - 1;
+    for (int e = 0; e < 3; e++)
+    {
+        step_x[e] = edges[e].a * RASTER_SUBPIXEL_ONE;
+        step_y[e] = edges[e].b * RASTER_SUBPIXEL_ONE;
+        to_max[e] = (step_x[e] > 0 ? step_x[e] * span : 0) + (step_y[e] > 0 ? step_y[e] * span : 0);
+        to_min[e] = (step_x[e] < 0 ? step_x[e] * span : 0) + (step_y[e] < 0 ? step_y[e] * span : 0);
+    }
+
+    const int block_mask = ~(RASTER_BLOCK_SIZE - 1);
+    for (int block_y = py0 & block_mask; block_y <= py1; block_y += RASTER_BLOCK_SIZE)
+    {
+        int y_start = block_y < py0 ? py0 : block_y;
+        int y_end = block_y + RASTER_BLOCK_SIZE - 1 > py1 ? py1 : block_y + RASTER_BLOCK_SIZE - 1;
+
+        for (int block_x = px0 & block_mask; block_x <= px1; block_x += RASTER_BLOCK_SIZE)
+        {
+            int64_t corner[3];
+            int reject = 0;
+            int accept = 1;
+            for (int e = 0; e < 3; e++)
+            {
+                corner[e] = raster_edge_at(&edges[e], block_x, block_y);
+                if (corner[e] + to_max[e] < 0) reject = 1;
+                if (corner[e] + to_min[e] < 0) accept = 0;
+            }
+            if (reject)
+                continue;
+
+            // reject against the triangle's nearest vertex, which costs nothing per block; only fully covered blocks,
+            // which are worth it, get the tighter bound from the depth plane at their corners
+            int block = 0;
+            int skip_depth_test = 0;
+            if (hiz)
+            {
+                block = (block_y / RASTER_BLOCK_SIZE) * hiz->blocks_x + block_x / RASTER_BLOCK_SIZE;
+                // hidden behind everything already in the block
+                if (tri_zmin >= hiz->block_max[block])
+                    continue;
+
+                if (accept)
+                {
+                    float z_corner = a.z + dzdx * (block_x + 0.5f - ax) + dzdy * (block_y + 0.5f - ay);
+                    float block_zmin = maxf(z_corner + dz_span_lo, tri_zmin);
+                    float block_zmax = minf(z_corner + dz_span_hi, tri_zmax);
+                    if (block_zmin >= hiz->block_max[block])
+                        continue;
+
+                    // in front of everything already in the block
+                    skip_depth_test = block_zmax < hiz->block_min[block];
+                    if (block_zmin < hiz->block_min[block])
+                        hiz->block_min[block] = block_zmin;
+                    // the block ends up no farther than this triangle anywhere in it
+                    if (block_zmax < hiz->block_max[block])
+                        hiz->block_max[block] = block_zmax;
+                }
+                else if (tri_zmin < hiz->block_min[block])
+                {
+                    hiz->block_min[block] = tri_zmin;
+                }
+            }
+
+            int x_start = block_x < px0 ? px0 : block_x;
+            int x_end = block_x + RASTER_BLOCK_SIZE - 1 > px1 ? px1 : block_x + RASTER_BLOCK_SIZE - 1;
+            float z_row = a.z + dzdx * (x_start + 0.5f - ax) + dzdy * (y_start + 0.5f - ay);
+
+            if (shading)
+            {
+                int64_t e_row[3];
+                for (int e = 0; e < 3; e++)
+                {
+                    e_row[e] = corner[e] + (x_start - block_x) * step_x[e] + (y_start - block_y) * step_y[e];
+                }
+                raster_shaded_block(target, &vary, block_x, block_y, x_start, x_end, y_start, y_end, z_row, dzdx,
+                                      dzdy, accept ? NULL : e_row, step_x, step_y, !skip_depth_test);
+                continue;
+            }
+
+            if (skip_depth_test)
+            {
+                for (int y = y_start; y <= y_end; y++)
+                {
+                    int row = y * target->stride;
+                    float z = z_row;
+                    for (int x = x_start; x <= x_end; x++)
+                    {
+                        target->depth[row + x] = z;
+                        target->color[row + x] = color;
+                        z += dzdx;
+                    }
+                    z_row += dzdy;
+                }
+                continue;
+            }
+
+            if (accept)
+            {
+                // every sample in the block is inside; only depth needs testing
+                for (int y = y_start; y <= y_end; y++)
+                {
+                    int row = y * target->stride;
+                    float z = z_row;
+                    for (int x = x_start; x <= x_end; x++)
+                    {
+                        if (z < target->depth[row + x])
+                        {
+                            target->depth[row + x] = z;
+                            target->color[row + x] = color;
+                        }
+                        z += dzdx;
+                    }
+                    z_row += dzdy;
+                }
+                continue;
+            }
+
+            // partially covered: walk the edge functions along with depth
+            int64_t e_row[3];
+            for (int e = 0; e < 3; e++)
+            {
+                e_row[e] = corner[e] + (x_start - block_x) * step_x[e] + (y_start - block_y) * step_y[e];
+            }
+            for (int y = y_start; y <= y_end; y++)
+            {
+                int row = y * target->stride;
+                int64_t e0 = e_row[0], e1 = e_row[1], e2 = e_row[2];
+                float z = z_row;
+                for (int x = x_start; x <= x_end; x++)
+                {
+                    if ((e0 | e1 | e2) >= 0 && z < target->depth[row + x])
+                    {
+                        target->depth[row + x] = z;
+                        target->color[row + x] = color;
+                    }
+                    e0 += step_x[0];
+                    e1 += step_x[1];
+                    e2 += step_x[2];
+                    z += dzdx;
+                }
+                e_row[0] += step_y[0];
+                e_row[1] += step_y[1];
+                e_row[2] += step_y[2];
+                z_row += dzdy;
+            }
+        }
+    }
+}
+
+void raster_fill_triangle(const raster_target* target, vec4f a, vec4f b, vec4f c, uint32_t color)
+{
+    raster_fill(target, a, b, c, color, NULL, NULL, NULL);
+}
+
+void raster_fill_triangle_shaded(const raster_target* target, vec4f a, vec4f b, vec4f c,
+                                 const raster_shading* shading, const raster_material* material,
+                                 const float* const attributes[3])
+{
+    raster_fill(target, a, b, c, 0, shading, material, attributes);
+}
+
+void raster_fill_model(const raster_target* target, const vec4f* screen_vertices, const int* indices, int num_indices, uint32_t color)
+{
+    for (int i = 0; i + 2 < num_indices; i += 3)
+    {
+        raster_fill_triangle(target, screen_vertices[indices[i]], screen_vertices[indices[i + 1]],
+                             screen_vertices[indices[i + 2]], color);
+    }
+}
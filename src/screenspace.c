@@ -1,6 +1,8 @@
 #include "screenspace.h"
+#include "lines.h"
 
 float* depth_buffer;
+dirty_tiles* drawn_tiles;
 
 void screenspace_draw_triangle(uint32_t* image, triangle tri)
 {
@@ -12,62 +14,8 @@ void screenspace_draw_triangle(uint32_t* image, triangle tri)
 
 void screenspace_draw_line(uint32_t* image, vec4f p1, vec4f p2)
 {
-    /*
-        1. Extrapolate the slope of the line
-        2. Iterate through every whole-number X-coordinate between p1.x and p2.x
-        3. For each X-coord, get the Y-coord on the line rounded to the nearest whole number
-        4. Copy it on!
-    */
-
-    //float slope = (float)(p2.y - p1.y) / (p2.x - p1.x);
-    int dy = p2.y - p1.y;
-    int dx = p2.x - p1.x;
-    // dz is not used for rendering, but we use it for z-buffering
-    int dz = p2.z - p1.z;
-    // equation is y = m(x - x1) + y1
-    // which equates to y = slope * (x - p1.x) + p1.y
-    
-    if (abs(dy) <= abs(dx)) // slope <= 1
-    {
-        if (p1.x > p2.x)
-        {
-            vec4f tmp = p1;
-            p1 = p2;
-            p2 = tmp;
-        }
-
-        float z = p1.z;
-        for (int x = p1.x; x <= p2.x; x++)
-        {
-            int y = (int) (((float)dy / dx) * (x - p1.x) + p1.y);
-            screenspace_add_point_depth((vec4f){x, y, z, 1.0f}, image);
-
-            // add to z according to dz
-            z += ((float)dz / dx) * (x - p1.x);
-        }
-    }    
-    else
-    {
-        if (p1.y > p2.y)
-        {
-            vec4f tmp = p1;
-            p1 = p2;
-            p2 = tmp;
-        }
-
-        float z = p1.z;
-        for (int y = p1.y; y <= p2.y; y++)
-        {
-            int x = (int) (((float)dx / dy) * (y - p1.y) + p1.x);
-            screenspace_add_point_depth((vec4f){x, y, z, 1.0f}, image);
-
-            // add to z according to dz (this time in terms of dy)
-            z += ((float)dz / dy) * (y - p1.y);
-        }
-    }
-
-    // screenspace_plot_point(image, p1);
-    // screenspace_plot_point(image, p2);
+    lines_draw(&(raster_target){ image, depth_buffer, window_width, 0, 0, window_width, window_height, NULL },
+               p1, p2, 0xFF00FF00, drawn_tiles);
 }
 
 void screenspace_draw_vertical_line(uint32_t* image, vec4f p1, vec4f p2)
@@ -122,29 +70,29 @@ void screenspace_from_ndc(vec4f *vertices, int num_vertices, float znear, float
 
 void screenspace_draw_model(vec4f* screen_vertices, int num_indices, int* ibo, uint32_t* image)
 {
-    for (int i = 0; i < num_indices; i += 3)
-    {
-        triangle tri = {
-            screen_vertices[ibo[i]],
-            screen_vertices[ibo[i + 1]],
-            screen_vertices[ibo[i + 2]]
-        };
-        screenspace_draw_triangle(image, tri);
-    }
+    lines_draw_model(&(raster_target){ image, depth_buffer, window_width, 0, 0, window_width, window_height, NULL },
+                     screen_vertices, ibo, num_indices, 0xFF00FF00, drawn_tiles);
 }
 
 void screenspace_add_point_depth(vec4f point, uint32_t* image)
 {
-    if (point.z < depth_buffer[((int)round(point.y) * window_width) + (int)round(point.x)])
+    int x = (int)round(point.x);
+    int y = (int)round(point.y);
+    // clipped vertices land exactly on the viewport edge, which rounds to one past the last row/column
+    if (x < 0 || x >= window_width || y < 0 || y >= window_height)
+        return;
+
+    int index = y * window_width + x;
+    if (point.z < depth_buffer[index])
     {
-        depth_buffer[((int)round(point.y) * window_width) + (int)round(point.x)] = point.z;
-        image[((int)round(point.y) * window_width) + (int)round(point.x)] = 0xFF00FF00;
+        depth_buffer[index] = point.z;
+        image[index] = 0xFF00FF00;
+        dirty_mark_pixel(drawn_tiles, x, y);
     }
 }
 
 void screenspace_clear_depth_buffer(int width, int height)
 {
-    depth_buffer = malloc(width * height * sizeof(float));
     for (int i = 0; i < width * height; i++)
     {
         depth_buffer[i] = 1.0f;
@@ -0,0 +1,215 @@
+// lighting spans of pixels: diffuse and specular from one directional light, per vertex or per pixel, SIMD-wide
+/*
+    A lit pixel is
+        base * Kd * (ambient + (1 - ambient) * max(N.L, 0)) + Ks * spec(N.H)
+    per channel, clamped to 255. Everything here is plain float adds, multiplies, divisions and square roots, in the
+    same order in every path: those are exactly rounded, so 8 lanes, 4 lanes and one at a time agree to the bit. No
+    fused multiply-adds, and no reciprocal estimates.
+*/
+#include "shade.h"
+#include "simd.h"
+
+#include <math.h>
+
+// a normal shorter than this (squared) is taken as this long instead of dividing by zero; such pixels come out
+// ambient-only, since the dot products vanish with it
+#define SHADE_MIN_LENGTH2 1e-30f
+
+// plain compares, in the operand order _mm_min_ps and _mm_max_ps use, so NaNs come out the same way
+static inline float shade_min(float a, float b) { return a < b ? a : b; }
+static inline float shade_max(float a, float b) { return a > b ? a : b; }
+
+static inline void shade_terms_at(const shade_light* light, float shininess, float nx, float ny, float nz,
+                                  float* diffuse, float* specular)
+{
+    float length2 = nx * nx + ny * ny + nz * nz;
+    float inverse = 1.0f / sqrtf(shade_max(length2, SHADE_MIN_LENGTH2));
+    float n_dot_l = (nx * light->direction.x + ny * light->direction.y + nz * light->direction.z) * inverse;
+    float n_dot_h = (nx * light->half.x + ny * light->half.y + nz * light->half.z) * inverse;
+    *diffuse = light->ambient + (1.0f - light->ambient) * shade_max(n_dot_l, 0.0f);
+    float x = shade_max(n_dot_h, 0.0f);
+    float highlight = x / (shininess - shininess * x + x);
+    *specular = n_dot_l > 0.0f ? highlight : 0.0f;
+}
+
+void shade_terms(const shade_light* light, float shininess, vec3f normal, float* diffuse, float* specular)
+{
+    shade_terms_at(light, shininess, normal.x, normal.y, normal.z, diffuse, specular);
+}
+
+// one lit color; `specular` is already scaled to 0-255
+static inline uint32_t shade_combine(uint32_t base, float d, float s, const float diffuse[3], const float specular[3])
+{
+    float r = (float)((base >> 16) & 0xFF) * (diffuse[0] * d) + specular[0] * s;
+    float g = (float)((base >> 8) & 0xFF) * (diffuse[1] * d) + specular[1] * s;
+    float b = (float)(base & 0xFF) * (diffuse[2] * d) + specular[2] * s;
+    return 0xFF000000u | (uint32_t)shade_min(r, 255.0f) << 16 | (uint32_t)shade_min(g, 255.0f) << 8 |
+           (uint32_t)shade_min(b, 255.0f);
+}
+
+#if defined(RENDER_SSE2)
+static inline __m128 sse_shade_channel(__m128i c, __m128 d, __m128 s, float diffuse, float specular, __m128i byte)
+{
+    __m128 channel = _mm_cvtepi32_ps(_mm_and_si128(c, byte));
+    __m128 lit = _mm_add_ps(_mm_mul_ps(channel, _mm_mul_ps(_mm_set1_ps(diffuse), d)),
+                            _mm_mul_ps(_mm_set1_ps(specular), s));
+    return _mm_min_ps(lit, _mm_set1_ps(255.0f));
+}
+
+static inline __m128i sse_shade_combine(__m128i base, __m128 d, __m128 s, const float diffuse[3],
+                                        const float specular[3])
+{
+    const __m128i byte = _mm_set1_epi32(0xFF);
+    __m128i r = _mm_cvttps_epi32(sse_shade_channel(_mm_srli_epi32(base, 16), d, s, diffuse[0], specular[0], byte));
+    __m128i g = _mm_cvttps_epi32(sse_shade_channel(_mm_srli_epi32(base, 8), d, s, diffuse[1], specular[1], byte));
+    __m128i b = _mm_cvttps_epi32(sse_shade_channel(base, d, s, diffuse[2], specular[2], byte));
+    __m128i color = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)), b);
+    return _mm_or_si128(color, _mm_set1_epi32((int)0xFF000000u));
+}
+#endif
+
+#if defined(RENDER_AVX2)
+static inline __m256 avx_shade_channel(__m256i c, __m256 d, __m256 s, float diffuse, float specular, __m256i byte)
+{
+    __m256 channel = _mm256_cvtepi32_ps(_mm256_and_si256(c, byte));
+    __m256 lit = _mm256_add_ps(_mm256_mul_ps(channel, _mm256_mul_ps(_mm256_set1_ps(diffuse), d)),
+                               _mm256_mul_ps(_mm256_set1_ps(specular), s));
+    return _mm256_min_ps(lit, _mm256_set1_ps(255.0f));
+}
+
+static inline __m256i avx_shade_combine(__m256i base, __m256 d, __m256 s, const float diffuse[3],
+                                        const float specular[3])
+{
+    const __m256i byte = _mm256_set1_epi32(0xFF);
+    __m256i r = _mm256_cvttps_epi32(avx_shade_channel(_mm256_srli_epi32(base, 16), d, s, diffuse[0], specular[0], byte));
+    __m256i g = _mm256_cvttps_epi32(avx_shade_channel(_mm256_srli_epi32(base, 8), d, s, diffuse[1], specular[1], byte));
+    __m256i b = _mm256_cvttps_epi32(avx_shade_channel(base, d, s, diffuse[2], specular[2], byte));
+    __m256i color = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_slli_epi32(g, 8)), b);
+    return _mm256_or_si256(color, _mm256_set1_epi32((int)0xFF000000u));
+}
+#endif
+
+void shade_span_vertex(const shade_material* m, float d, float s, float q, float dd, float ds, float dq, int count,
+                       const uint32_t* base, uint32_t* out)
+{
+    const float* diffuse = m->diffuse;
+    const float specular[3] = { m->specular[0] * 255.0f, m->specular[1] * 255.0f, m->specular[2] * 255.0f };
+    int i = 0;
+
+#if defined(RENDER_AVX2)
+    {
+        const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), lane);
+            __m256 w = _mm256_div_ps(one, _mm256_add_ps(_mm256_set1_ps(q), _mm256_mul_ps(index, _mm256_set1_ps(dq))));
+            __m256 di = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(d), _mm256_mul_ps(index, _mm256_set1_ps(dd))), w);
+            __m256 si = _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(s), _mm256_mul_ps(index, _mm256_set1_ps(ds))), w);
+            __m256i color = _mm256_loadu_si256((const __m256i*)(base + i));
+            _mm256_storeu_si256((__m256i*)(out + i), avx_shade_combine(color, di, si, diffuse, specular));
+        }
+    }
+#endif
+#if defined(RENDER_SSE2)
+    {
+        const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 index = _mm_add_ps(_mm_set1_ps((float)i), lane);
+            __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_set1_ps(q), _mm_mul_ps(index, _mm_set1_ps(dq))));
+            __m128 di = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(d), _mm_mul_ps(index, _mm_set1_ps(dd))), w);
+            __m128 si = _mm_mul_ps(_mm_add_ps(_mm_set1_ps(s), _mm_mul_ps(index, _mm_set1_ps(ds))), w);
+            __m128i color = _mm_loadu_si128((const __m128i*)(base + i));
+            _mm_storeu_si128((__m128i*)(out + i), sse_shade_combine(color, di, si, diffuse, specular));
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float index = (float)i;
+        float w = 1.0f / (q + index * dq);
+        out[i] = shade_combine(base[i], (d + index * dd) * w, (s + index * ds) * w, diffuse, specular);
+    }
+}
+
+void shade_span_pixel(const shade_material* m, const shade_light* light, vec3f n, vec3f dn, int count,
+                      const uint32_t* base, uint32_t* out)
+{
+    const float* diffuse = m->diffuse;
+    const float specular[3] = { m->specular[0] * 255.0f, m->specular[1] * 255.0f, m->specular[2] * 255.0f };
+    const float shininess = m->shininess;
+    int i = 0;
+
+#if defined(RENDER_AVX2)
+    {
+        const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+        const __m256 min_length2 = _mm256_set1_ps(SHADE_MIN_LENGTH2);
+        const __m256 lx = _mm256_set1_ps(light->direction.x), ly = _mm256_set1_ps(light->direction.y);
+        const __m256 lz = _mm256_set1_ps(light->direction.z);
+        const __m256 hx = _mm256_set1_ps(light->half.x), hy = _mm256_set1_ps(light->half.y);
+        const __m256 hz = _mm256_set1_ps(light->half.z);
+        const __m256 ambient = _mm256_set1_ps(light->ambient), lambert = _mm256_set1_ps(1.0f - light->ambient);
+        const __m256 exponent = _mm256_set1_ps(shininess);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), lane);
+            __m256 nx = _mm256_add_ps(_mm256_set1_ps(n.x), _mm256_mul_ps(index, _mm256_set1_ps(dn.x)));
+            __m256 ny = _mm256_add_ps(_mm256_set1_ps(n.y), _mm256_mul_ps(index, _mm256_set1_ps(dn.y)));
+            __m256 nz = _mm256_add_ps(_mm256_set1_ps(n.z), _mm256_mul_ps(index, _mm256_set1_ps(dn.z)));
+            __m256 length2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_mul_ps(nz, nz));
+            __m256 inverse = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_max_ps(length2, min_length2)));
+            __m256 n_dot_l = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, lx), _mm256_mul_ps(ny, ly)),
+                                                         _mm256_mul_ps(nz, lz)), inverse);
+            __m256 n_dot_h = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, hx), _mm256_mul_ps(ny, hy)),
+                                                         _mm256_mul_ps(nz, hz)), inverse);
+            __m256 d = _mm256_add_ps(ambient, _mm256_mul_ps(lambert, _mm256_max_ps(n_dot_l, zero)));
+            __m256 x = _mm256_max_ps(n_dot_h, zero);
+            __m256 highlight = _mm256_div_ps(x, _mm256_add_ps(_mm256_sub_ps(exponent, _mm256_mul_ps(exponent, x)), x));
+            __m256 s = _mm256_and_ps(highlight, _mm256_cmp_ps(n_dot_l, zero, _CMP_GT_OQ));
+            __m256i color = _mm256_loadu_si256((const __m256i*)(base + i));
+            _mm256_storeu_si256((__m256i*)(out + i), avx_shade_combine(color, d, s, diffuse, specular));
+        }
+    }
+#endif
+#if defined(RENDER_SSE2)
+    {
+        const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+        const __m128 min_length2 = _mm_set1_ps(SHADE_MIN_LENGTH2);
+        const __m128 lx = _mm_set1_ps(light->direction.x), ly = _mm_set1_ps(light->direction.y);
+        const __m128 lz = _mm_set1_ps(light->direction.z);
+        const __m128 hx = _mm_set1_ps(light->half.x), hy = _mm_set1_ps(light->half.y), hz = _mm_set1_ps(light->half.z);
+        const __m128 ambient = _mm_set1_ps(light->ambient), lambert = _mm_set1_ps(1.0f - light->ambient);
+        const __m128 exponent = _mm_set1_ps(shininess);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 index = _mm_add_ps(_mm_set1_ps((float)i), lane);
+            __m128 nx = _mm_add_ps(_mm_set1_ps(n.x), _mm_mul_ps(index, _mm_set1_ps(dn.x)));
+            __m128 ny = _mm_add_ps(_mm_set1_ps(n.y), _mm_mul_ps(index, _mm_set1_ps(dn.y)));
+            __m128 nz = _mm_add_ps(_mm_set1_ps(n.z), _mm_mul_ps(index, _mm_set1_ps(dn.z)));
+            __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+            __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(length2, min_length2)));
+            __m128 n_dot_l = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, lx), _mm_mul_ps(ny, ly)),
+                                                   _mm_mul_ps(nz, lz)), inverse);
+            __m128 n_dot_h = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, hx), _mm_mul_ps(ny, hy)),
+                                                   _mm_mul_ps(nz, hz)), inverse);
+            __m128 d = _mm_add_ps(ambient, _mm_mul_ps(lambert, _mm_max_ps(n_dot_l, zero)));
+            __m128 x = _mm_max_ps(n_dot_h, zero);
+            __m128 highlight = _mm_div_ps(x, _mm_add_ps(_mm_sub_ps(exponent, _mm_mul_ps(exponent, x)), x));
+            __m128 s = _mm_and_ps(highlight, _mm_cmpgt_ps(n_dot_l, zero));
+            __m128i color = _mm_loadu_si128((const __m128i*)(base + i));
+            _mm_storeu_si128((__m128i*)(out + i), sse_shade_combine(color, d, s, diffuse, specular));
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float index = (float)i;
+        float d, s;
+        shade_terms_at(light, shininess, n.x + index * dn.x, n.y + index * dn.y, n.z + index * dn.z, &d, &s);
+        out[i] = shade_combine(base[i], d, s, diffuse, specular);
+    }
+}
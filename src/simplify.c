@@ -0,0 +1,439 @@
+// quadric-error mesh simplification by edge collapse, for building levels of detail
+#include "simplify.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "meshopt.h"
+
+/*
+    A quadric is the sum of w * (n . p + d)^2 over a set of planes (n, d) with weights w, as a symmetric 4x4 matrix,
+    so the summed squared distance from any point p to all of those planes is one small polynomial in p. Every vertex
+    starts with the planes of the triangles around it, weighted by area; collapsing a into b gives b the sum of both.
+    The cost of the collapse is the merged quadric at b's position, divided by the total weight, i.e. the mean
+    squared distance from b to every plane a and b stood for.
+
+    The terms are kept in double: on a dense mesh, the distances that matter are around 1e-6 of the unit cube while
+    the terms are around 1, and in float the polynomial would cancel out to noise.
+*/
+typedef struct simplify_quadric
+{
+    double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+    double w;
+} simplify_quadric;
+
+typedef struct simplify_candidate
+{
+    int from, to;
+    float cost;
+} simplify_candidate;
+
+static void* simplify_alloc(size_t size)
+{
+    void* p = malloc(size ? size : 1);
+    if (!p)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    return p;
+}
+
+static vec3f simplify_sub(vec3f a, vec3f b)
+{
+    return (vec3f){a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static vec3f simplify_cross(vec3f a, vec3f b)
+{
+    return (vec3f){a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+static float simplify_dot(vec3f a, vec3f b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static void simplify_quadric_add(simplify_quadric* q, const simplify_quadric* other)
+{
+    q->a2 += other->a2; q->b2 += other->b2; q->c2 += other->c2;
+    q->ab += other->ab; q->ac += other->ac; q->bc += other->bc;
+    q->ad += other->ad; q->bd += other->bd; q->cd += other->cd;
+    q->d2 += other->d2;
+    q->w += other->w;
+}
+
+// mean squared distance from p to the planes of a + b
+static float simplify_cost(const simplify_quadric* a, const simplify_quadric* b, vec3f p)
+{
+    simplify_quadric q = *a;
+    simplify_quadric_add(&q, b);
+    if (q.w <= 0.0)
+        return 0.0f;
+
+    double x = p.x, y = p.y, z = p.z;
+    double e = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z +
+               2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z) +
+               2.0 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+    // rounding can take a true zero slightly negative
+    return e > 0.0 ? (float)(e / q.w) : 0.0f;
+}
+
+static int simplify_compare_candidates(const void* a, const void* b)
+{
+    const simplify_candidate* x = a;
+    const simplify_candidate* y = b;
+    if (x->cost != y->cost)
+        return x->cost < y->cost ? -1 : 1;
+    // ties in a fixed order, so the result doesn't depend on qsort
+    if (x->from != y->from)
+        return x->from - y->from;
+    return x->to - y->to;
+}
+
+// the k-th smallest cost (0-based), partially reordering the candidates; Hoare partitioning around the middle one
+static float simplify_select_cost(simplify_candidate* candidates, int count, int k)
+{
+    int lo = 0, hi = count - 1;
+    while (lo < hi)
+    {
+        float pivot = candidates[lo + (hi - lo) / 2].cost;
+        int i = lo, j = hi;
+        while (i <= j)
+        {
+            while (candidates[i].cost < pivot) i++;
+            while (candidates[j].cost > pivot) j--;
+            if (i <= j)
+            {
+                simplify_candidate t = candidates[i];
+                candidates[i++] = candidates[j];
+                candidates[j--] = t;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else break;
+    }
+    return candidates[k].cost;
+}
+
+// vertex -> triangles, over the current index list
+static void simplify_build_adjacency(simplifier* s)
+{
+    int* start = s->adjacency_start;
+    memset(start, 0, (size_t)(s->num_positions + 1) * sizeof(int));
+    for (int i = 0; i < s->num_indices; i++)
+    {
+        start[s->indices[i] + 1]++;
+    }
+    for (int v = 0; v < s->num_positions; v++)
+    {
+        start[v + 1] += start[v];
+    }
+    // filling moves every start up to where the next vertex's begins, so shift them back afterwards
+    for (int i = 0; i < s->num_indices; i++)
+    {
+        s->adjacency[start[s->indices[i]]++] = i / 3;
+    }
+    for (int v = s->num_positions; v > 0; v--)
+    {
+        start[v] = start[v - 1];
+    }
+    start[0] = 0;
+}
+
+// number of current triangles that use both a and b
+static int simplify_shared_triangles(const simplifier* s, int a, int b)
+{
+    int count = 0;
+    for (int k = s->adjacency_start[a]; k < s->adjacency_start[a + 1]; k++)
+    {
+        const int* tri = &s->indices[s->adjacency[k] * 3];
+        if (tri[0] == b || tri[1] == b || tri[2] == b)
+            count++;
+    }
+    return count;
+}
+
+void simplify_init(simplifier* s, const mesh* m, const int* indices, int num_indices)
+{
+    memset(s, 0, sizeof(*s));
+    const vec3f* positions = m->positions;
+    int num_positions = m->num_positions;
+    s->positions = positions;
+    s->num_positions = num_positions;
+    s->num_indices = num_indices - num_indices % 3;
+
+    // vertices with the same position (and texture coordinates, normal and material) are one vertex as far as
+    // collapsing goes
+    int* canonical = simplify_alloc((size_t)num_positions * sizeof(int));
+    meshopt_vertex_remap(m, canonical);
+    s->indices = simplify_alloc((size_t)s->num_indices * sizeof(int));
+    int kept = 0;
+    for (int i = 0; i < s->num_indices; i += 3)
+    {
+        int a = canonical[indices[i]], b = canonical[indices[i + 1]], c = canonical[indices[i + 2]];
+        // triangles that were degenerate all along would only confuse the border test
+        if (a == b || b == c || a == c)
+            continue;
+        s->indices[kept++] = a;
+        s->indices[kept++] = b;
+        s->indices[kept++] = c;
+    }
+    s->num_indices = kept;
+    free(canonical);
+
+    // into the unit cube
+    vec3f lo = {0.0f, 0.0f, 0.0f}, hi = {0.0f, 0.0f, 0.0f};
+    if (num_positions > 0)
+    {
+        lo = hi = positions[0];
+    }
+    for (int i = 1; i < num_positions; i++)
+    {
+        vec3f p = positions[i];
+        if (p.x < lo.x) lo.x = p.x;
+        if (p.y < lo.y) lo.y = p.y;
+        if (p.z < lo.z) lo.z = p.z;
+        if (p.x > hi.x) hi.x = p.x;
+        if (p.y > hi.y) hi.y = p.y;
+        if (p.z > hi.z) hi.z = p.z;
+    }
+    float extent = hi.x - lo.x;
+    if (hi.y - lo.y > extent) extent = hi.y - lo.y;
+    if (hi.z - lo.z > extent) extent = hi.z - lo.z;
+    s->scale = extent > 0.0f ? extent : 1.0f;
+    s->unit = simplify_alloc((size_t)num_positions * sizeof(vec3f));
+    for (int i = 0; i < num_positions; i++)
+    {
+        s->unit[i] = (vec3f){(positions[i].x - lo.x) / s->scale, (positions[i].y - lo.y) / s->scale,
+                             (positions[i].z - lo.z) / s->scale};
+    }
+
+    // every triangle's plane goes into its three corners, weighted by area
+    s->quadrics = calloc((size_t)num_positions + 1, sizeof(simplify_quadric));
+    s->locked = calloc((size_t)num_positions + 1, 1);
+    if (!s->quadrics || !s->locked)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    for (int t = 0; t < s->num_indices / 3; t++)
+    {
+        const int* tri = &s->indices[t * 3];
+        vec3f a = s->unit[tri[0]], b = s->unit[tri[1]], c = s->unit[tri[2]];
+        vec3f n = simplify_cross(simplify_sub(b, a), simplify_sub(c, a));
+        float length = sqrtf(simplify_dot(n, n));
+        if (length == 0.0f)
+            continue;
+        double area = length * 0.5;
+        double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+        double d = -(nx * a.x + ny * a.y + nz * a.z);
+
+        simplify_quadric q = {
+            area * nx * nx, area * ny * ny, area * nz * nz,
+            area * nx * ny, area * nx * nz, area * ny * nz,
+            area * nx * d, area * ny * d, area * nz * d,
+            area * d * d, area
+        };
+        for (int k = 0; k < 3; k++)
+        {
+            simplify_quadric_add(&s->quadrics[tri[k]], &q);
+        }
+    }
+
+    s->adjacency_start = simplify_alloc((size_t)(num_positions + 1) * sizeof(int));
+    s->adjacency = simplify_alloc((size_t)s->num_indices * sizeof(int));
+    s->collapse = simplify_alloc((size_t)num_positions * sizeof(int));
+    for (int i = 0; i < num_positions; i++)
+    {
+        s->collapse[i] = i;
+    }
+    s->touched = simplify_alloc((size_t)num_positions);
+    s->candidates = simplify_alloc((size_t)s->num_indices * sizeof(simplify_candidate));
+
+    // an edge with exactly two triangles on it is interior; one is an open border, three or more is non-manifold.
+    // Either way, collapsing it would tear or fold the surface, so its vertices stay put
+    simplify_build_adjacency(s);
+    for (int i = 0; i < s->num_indices; i++)
+    {
+        int a = s->indices[i];
+        int b = s->indices[i - i % 3 + (i + 1) % 3];
+        if (a != b && simplify_shared_triangles(s, a, b) != 2)
+        {
+            s->locked[a] = 1;
+            s->locked[b] = 1;
+        }
+    }
+}
+
+// tries the candidates in [begin, end) in order until `triangles` is down to `target`; returns how many went away
+static int simplify_collapse(simplifier* s, int begin, int end, int triangles, int target)
+{
+    int removed = 0;
+    for (int c = begin; c < end && triangles - removed > target; c++)
+    {
+        const simplify_candidate* cand = &s->candidates[c];
+        int a = cand->from, b = cand->to;
+
+        // both ends are final for this pass: `a` is gone, and `b` has just changed its quadric
+        if (s->touched[a] || s->touched[b])
+            continue;
+
+        // every triangle around `a` changes; none may flip over, and for that test to hold, none of their other
+        // corners may have moved already this pass
+        int ok = 1;
+        int vanishing = 0;
+        for (int k = s->adjacency_start[a]; k < s->adjacency_start[a + 1] && ok; k++)
+        {
+            const int* tri = &s->indices[s->adjacency[k] * 3];
+            if (s->collapse[tri[0]] != tri[0] || s->collapse[tri[1]] != tri[1] || s->collapse[tri[2]] != tri[2])
+            {
+                ok = 0;
+                break;
+            }
+            if (tri[0] == b || tri[1] == b || tri[2] == b)
+            {
+                vanishing++;
+                continue;
+            }
+
+            vec3f p[3], q[3];
+            for (int j = 0; j < 3; j++)
+            {
+                p[j] = s->unit[tri[j]];
+                q[j] = tri[j] == a ? s->unit[b] : p[j];
+            }
+            vec3f n_old = simplify_cross(simplify_sub(p[1], p[0]), simplify_sub(p[2], p[0]));
+            vec3f n_new = simplify_cross(simplify_sub(q[1], q[0]), simplify_sub(q[2], q[0]));
+            if (simplify_dot(n_old, n_new) <= 0.0f)
+                ok = 0;
+        }
+        if (!ok)
+            continue;
+
+        s->collapse[a] = b;
+        s->touched[a] = s->touched[b] = 1;
+        simplify_quadric_add(&s->quadrics[b], &s->quadrics[a]);
+        if (cand->cost > s->error)
+            s->error = cand->cost;
+        removed += vanishing;
+    }
+
+    return removed;
+}
+
+// one round of collapses, cheapest first, each vertex in at most one; returns how many triangles went away
+static int simplify_pass(simplifier* s, int target_triangles)
+{
+    simplify_build_adjacency(s);
+    int num_triangles = s->num_indices / 3;
+
+    // every edge once: interior edges show up as (a, b) in one triangle and (b, a) in the other
+    int num_candidates = 0;
+    for (int i = 0; i < s->num_indices; i++)
+    {
+        int a = s->indices[i];
+        int b = s->indices[i - i % 3 + (i + 1) % 3];
+        if (a >= b || (s->locked[a] && s->locked[b]))
+            continue;
+
+        float cost_ab = s->locked[a] ? INFINITY : simplify_cost(&s->quadrics[a], &s->quadrics[b], s->unit[b]);
+        float cost_ba = s->locked[b] ? INFINITY : simplify_cost(&s->quadrics[a], &s->quadrics[b], s->unit[a]);
+        simplify_candidate* c = &s->candidates[num_candidates++];
+        if (cost_ab <= cost_ba)
+        {
+            c->from = a; c->to = b; c->cost = cost_ab;
+        }
+        else
+        {
+            c->from = b; c->to = a; c->cost = cost_ba;
+        }
+    }
+    if (num_candidates == 0)
+        return 0;
+
+    // a collapse removes about two triangles. Look at about as many of the cheapest edges as it would take to reach
+    // the target, and a bit past that in cost: taking expensive edges now, when cheaper ones will open up next pass,
+    // makes for a worse result. Only those need to be in order, which on the first passes is a small part of them
+    int goal = (num_triangles - target_triangles) / 2;
+    if (goal < 1) goal = 1;
+    if (goal > num_candidates) goal = num_candidates;
+    float cost_limit = simplify_select_cost(s->candidates, num_candidates, goal - 1) * 1.5f;
+    int num_cheap = 0;
+    for (int c = 0; c < num_candidates; c++)
+    {
+        if (s->candidates[c].cost <= cost_limit)
+        {
+            simplify_candidate t = s->candidates[num_cheap];
+            s->candidates[num_cheap++] = s->candidates[c];
+            s->candidates[c] = t;
+        }
+    }
+    qsort(s->candidates, num_cheap, sizeof(simplify_candidate), simplify_compare_candidates);
+
+    // if none of the cheap ones could go, fall back to the rest rather than stopping early
+    memset(s->touched, 0, (size_t)s->num_positions);
+    int removed = simplify_collapse(s, 0, num_cheap, num_triangles, target_triangles);
+    if (removed == 0 && num_cheap < num_candidates)
+    {
+        qsort(s->candidates + num_cheap, num_candidates - num_cheap, sizeof(simplify_candidate), simplify_compare_candidates);
+        removed = simplify_collapse(s, num_cheap, num_candidates, num_triangles, target_triangles);
+    }
+
+    // apply the pass: no chains are possible, since a target never moves in the same pass
+    int out = 0;
+    for (int t = 0; t < num_triangles; t++)
+    {
+        int v0 = s->collapse[s->indices[t * 3]];
+        int v1 = s->collapse[s->indices[t * 3 + 1]];
+        int v2 = s->collapse[s->indices[t * 3 + 2]];
+        if (v0 == v1 || v1 == v2 || v0 == v2)
+            continue;
+        s->indices[out++] = v0;
+        s->indices[out++] = v1;
+        s->indices[out++] = v2;
+    }
+    for (int i = 0; i < s->num_indices; i++)
+    {
+        s->collapse[s->indices[i]] = s->indices[i];
+    }
+    for (int c = 0; c < num_candidates; c++)
+    {
+        s->collapse[s->candidates[c].from] = s->candidates[c].from;
+    }
+    int before = s->num_indices;
+    s->num_indices = out;
+    return (before - out) / 3;
+}
+
+int simplify_run(simplifier* s, int target_indices)
+{
+    int target_triangles = target_indices / 3;
+    while (s->num_indices / 3 > target_triangles)
+    {
+        if (simplify_pass(s, target_triangles) == 0)
+            break;
+    }
+    return s->num_indices;
+}
+
+float simplify_error(const simplifier* s)
+{
+    return sqrtf(s->error) * s->scale;
+}
+
+void simplify_destroy(simplifier* s)
+{
+    free(s->candidates);
+    free(s->touched);
+    free(s->collapse);
+    free(s->adjacency);
+    free(s->adjacency_start);
+    free(s->locked);
+    free(s->quadrics);
+    free(s->unit);
+    free(s->indices);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,609 @@
+// textures: image loading, mip chain generation, tiled storage and bilinear sampling
+/*
+    Storage: every level is cut into TEXTURE_TILE x TEXTURE_TILE tiles of 64 bytes, so the four texels a bilinear
+    sample reads are in one cache line unless the sample sits right on a tile border. With a linear layout the two
+    rows of the footprint are a whole image row apart, and on a minified surface every sample touches lines that
+    nothing else will touch again before they are evicted. Mip levels fix the other half of that: a level is picked so
+    neighbouring pixels read neighbouring texels.
+
+    Filtering: texture coordinates become 32-bit fixed point with TEXTURE_FILTER_BITS of fraction. The blend is done
+    in 16-bit lanes, a + ((b - a) * f >> TEXTURE_FILTER_BITS), first along x and then along y; with 7 fraction bits
+    the product always fits. The scalar path does the same integer steps, so all instruction sets agree exactly.
+*/
+#include "texture.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXTURE_ALIGN 64
+// texture coordinates are clamped to this many texels (before wrapping) so the fixed-point conversion never overflows
+#define TEXTURE_COORD_LIMIT ((float)(1 << (30 - TEXTURE_FILTER_BITS)))
+
+static int texture_log2(int n)
+{
+    int shift = 0;
+    while ((1 << shift) < n)
+    {
+        shift++;
+    }
+    return shift;
+}
+
+// texels a level takes up once padded to whole tiles
+static size_t texture_level_texels(int width, int height)
+{
+    size_t tiles_x = (size_t)(width + TEXTURE_TILE - 1) / TEXTURE_TILE;
+    size_t tiles_y = (size_t)(height + TEXTURE_TILE - 1) / TEXTURE_TILE;
+    return tiles_x * tiles_y * TEXTURE_TILE * TEXTURE_TILE;
+}
+
+// bilinear resample of a top-down image into a bottom-up one of another size; only ever used to scale up to a
+// power of two, where bilinear loses nothing worth a better filter
+static void texture_resample(const uint32_t* src, int src_w, int src_h, uint32_t* dst, int dst_w, int dst_h)
+{
+    for (int y = 0; y < dst_h; y++)
+    {
+        // dst row 0 is the bottom of the image
+        float sy = ((float)(dst_h - 1 - y) + 0.5f) * src_h / dst_h - 0.5f;
+        if (sy < 0.0f) sy = 0.0f;
+        int y0 = (int)sy;
+        int y1 = y0 + 1 < src_h ? y0 + 1 : y0;
+        int fy = (int)((sy - y0) * 256.0f);
+        for (int x = 0; x < dst_w; x++)
+        {
+            float sx = ((float)x + 0.5f) * src_w / dst_w - 0.5f;
+            if (sx < 0.0f) sx = 0.0f;
+            int x0 = (int)sx;
+            int x1 = x0 + 1 < src_w ? x0 + 1 : x0;
+            int fx = (int)((sx - x0) * 256.0f);
+
+            uint32_t t00 = src[y0 * src_w + x0], t10 = src[y0 * src_w + x1];
+            uint32_t t01 = src[y1 * src_w + x0], t11 = src[y1 * src_w + x1];
+            uint32_t out = 0;
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                int a = (t00 >> shift) & 0xff, b = (t10 >> shift) & 0xff;
+                int c = (t01 >> shift) & 0xff, d = (t11 >> shift) & 0xff;
+                int top = a * (256 - fx) + b * fx;
+                int bottom = c * (256 - fx) + d * fx;
+                int value = (top * (256 - fy) + bottom * fy + 32768) >> 16;
+                out |= (uint32_t)value << shift;
+            }
+            dst[y * dst_w + x] = out;
+        }
+    }
+}
+
+// one level down: every texel is the rounded average of a 2 x 2 block (a 1 x 2 one where a side is already 1)
+static void texture_downsample(const uint32_t* src, int src_w, int src_h, uint32_t* dst, int dst_w, int dst_h)
+{
+    for (int y = 0; y < dst_h; y++)
+    {
+        int y0 = y * 2;
+        int y1 = y0 + 1 < src_h ? y0 + 1 : y0;
+        for (int x = 0; x < dst_w; x++)
+        {
+            int x0 = x * 2;
+            int x1 = x0 + 1 < src_w ? x0 + 1 : x0;
+            uint32_t a = src[y0 * src_w + x0], b = src[y0 * src_w + x1];
+            uint32_t c = src[y1 * src_w + x0], d = src[y1 * src_w + x1];
+            uint32_t out = 0;
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                uint32_t sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) + ((c >> shift) & 0xff) + ((d >> shift) & 0xff);
+                out |= ((sum + 2) >> 2) << shift;
+            }
+            dst[y * dst_w + x] = out;
+        }
+    }
+}
+
+// copies a linear, bottom-up level into its tiles; padding texels of partial tiles repeat the edge
+static void texture_swizzle(const uint32_t* src, texture_level* level)
+{
+    int padded_w = level->width > TEXTURE_TILE ? level->width : TEXTURE_TILE;
+    int padded_h = level->height > TEXTURE_TILE ? level->height : TEXTURE_TILE;
+    for (int y = 0; y < padded_h; y++)
+    {
+        int sy = y < level->height ? y : level->height - 1;
+        for (int x = 0; x < padded_w; x++)
+        {
+            int sx = x < level->width ? x : level->width - 1;
+            level->texels[texture_texel_offset(level, x, y)] = src[sy * level->width + sx];
+        }
+    }
+}
+
+int texture_init(texture* t, const uint32_t* pixels, int width, int height)
+{
+    memset(t, 0, sizeof(*t));
+    const int max_size = 1 << (TEXTURE_MAX_LEVELS - 1);
+    if (width <= 0 || height <= 0 || width > max_size || height > max_size)
+    {
+        fprintf(stderr, "Texture size %dx%d is out of range!\n", width, height);
+        return 1;
+    }
+
+    int w = 1 << texture_log2(width);
+    int h = 1 << texture_log2(height);
+    t->num_levels = 1 + (texture_log2(w) > texture_log2(h) ? texture_log2(w) : texture_log2(h));
+
+    size_t total = 0;
+    for (int l = 0, lw = w, lh = h; l < t->num_levels; l++)
+    {
+        total += texture_level_texels(lw, lh);
+        lw = lw > 1 ? lw / 2 : 1;
+        lh = lh > 1 ? lh / 2 : 1;
+    }
+
+    // two linear scratch levels to filter between: the current one, and the half-size one made from it
+    t->block = malloc(total * sizeof(uint32_t) + TEXTURE_ALIGN);
+    uint32_t* current = malloc((size_t)w * h * sizeof(uint32_t));
+    uint32_t* next = malloc(((size_t)w * h / 2 + 1) * sizeof(uint32_t));
+    if (!t->block || !current || !next)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        free(t->block);
+        free(current);
+        free(next);
+        t->block = NULL;
+        return 1;
+    }
+
+    if (w == width && h == height)
+    {
+        // just turn it bottom-up
+        for (int y = 0; y < h; y++)
+        {
+            memcpy(current + (size_t)y * w, pixels + (size_t)(h - 1 - y) * w, (size_t)w * sizeof(uint32_t));
+        }
+    }
+    else
+    {
+        texture_resample(pixels, width, height, current, w, h);
+    }
+
+    uint32_t* texels = (uint32_t*)(((uintptr_t)t->block + TEXTURE_ALIGN - 1) & ~(uintptr_t)(TEXTURE_ALIGN - 1));
+    for (int l = 0; l < t->num_levels; l++)
+    {
+        texture_level* level = &t->levels[l];
+        level->width = w;
+        level->height = h;
+        level->tiles_x_shift = w > TEXTURE_TILE ? texture_log2(w / TEXTURE_TILE) : 0;
+        level->texels = texels;
+        texture_swizzle(current, level);
+        texels += texture_level_texels(w, h);
+
+        if (l + 1 < t->num_levels)
+        {
+            int next_w = w > 1 ? w / 2 : 1;
+            int next_h = h > 1 ? h / 2 : 1;
+            texture_downsample(current, w, h, next, next_w, next_h);
+            uint32_t* swap = current; current = next; next = swap;
+            w = next_w;
+            h = next_h;
+        }
+    }
+
+    free(current);
+    free(next);
+    return 0;
+}
+
+void texture_destroy(texture* t)
+{
+    free(t->block);
+    memset(t, 0, sizeof(*t));
+}
+
+// the whole file in memory, or NULL
+static unsigned char* texture_read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        perror("Failed to open texture");
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* data = length > 0 ? malloc((size_t)length) : NULL;
+    if (!data || fread(data, 1, (size_t)length, file) != (size_t)length)
+    {
+        fprintf(stderr, "Failed to read texture %s\n", path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+// the next decimal number of a PPM header, skipping whitespace and comments; -1 if there isn't one
+static long texture_ppm_number(const unsigned char* data, size_t size, size_t* pos)
+{
+    for (;;)
+    {
+        while (*pos < size && (data[*pos] == ' ' || data[*pos] == '\t' || data[*pos] == '\r' || data[*pos] == '\n'))
+        {
+            (*pos)++;
+        }
+        if (*pos < size && data[*pos] == '#')
+        {
+            while (*pos < size && data[*pos] != '\n')
+            {
+                (*pos)++;
+            }
+            continue;
+        }
+        break;
+    }
+    if (*pos >= size || data[*pos] < '0' || data[*pos] > '9')
+        return -1;
+    long value = 0;
+    while (*pos < size && data[*pos] >= '0' && data[*pos] <= '9')
+    {
+        if (value < 1000000L)
+            value = value * 10 + (data[*pos] - '0');
+        (*pos)++;
+    }
+    return value;
+}
+
+// binary PPM, 8 bits per channel, to top-down ARGB8888
+static uint32_t* texture_decode_ppm(const unsigned char* data, size_t size, int* width, int* height)
+{
+    size_t pos = 2;
+    long w = texture_ppm_number(data, size, &pos);
+    long h = texture_ppm_number(data, size, &pos);
+    long max = texture_ppm_number(data, size, &pos);
+    if (w <= 0 || h <= 0 || max <= 0 || max > 255 || pos >= size)
+        return NULL;
+    pos++; // the single whitespace character that ends the header
+    if ((size - pos) / 3 / (size_t)w < (size_t)h)
+        return NULL;
+
+    uint32_t* pixels = malloc((size_t)w * h * sizeof(uint32_t));
+    if (!pixels)
+        return NULL;
+    const unsigned char* p = data + pos;
+    for (size_t i = 0; i < (size_t)w * h; i++, p += 3)
+    {
+        uint32_t r = p[0] * 255u / (uint32_t)max, g = p[1] * 255u / (uint32_t)max, b = p[2] * 255u / (uint32_t)max;
+        pixels[i] = 0xFF000000u | (r << 16) | (g << 8) | b;
+    }
+    *width = (int)w;
+    *height = (int)h;
+    return pixels;
+}
+
+// one TGA pixel (BGR, BGRA or gray) to ARGB8888
+static uint32_t texture_tga_pixel(const unsigned char* p, int bytes)
+{
+    if (bytes == 1)
+        return 0xFF000000u | ((uint32_t)p[0] << 16) | ((uint32_t)p[0] << 8) | p[0];
+    uint32_t a = bytes == 4 ? p[3] : 0xFF;
+    return (a << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+// Truevision TGA: true color (24/32 bit) or grayscale (8 bit), raw or run-length encoded, to top-down ARGB8888
+static uint32_t* texture_decode_tga(const unsigned char* data, size_t size, int* width, int* height)
+{
+    if (size < 18)
+        return NULL;
+    int id_length = data[0];
+    int colormap_type = data[1];
+    int type = data[2];
+    int w = data[12] | (data[13] << 8);
+    int h = data[14] | (data[15] << 8);
+    int bytes = data[16] / 8;
+    int top_down = (data[17] & 0x20) != 0;
+    int rle = type == 10 || type == 11;
+    int gray = type == 3 || type == 11;
+    if (colormap_type != 0 || !(type == 2 || type == 3 || rle) || w == 0 || h == 0 ||
+        (gray ? bytes != 1 : (bytes != 3 && bytes != 4)))
+        return NULL;
+
+    uint32_t* pixels = malloc((size_t)w * h * sizeof(uint32_t));
+    if (!pixels)
+        return NULL;
+    size_t pos = 18 + (size_t)id_length;
+    size_t count = (size_t)w * h;
+    size_t i = 0;
+    while (i < count)
+    {
+        // a raw image is one long raw packet
+        size_t run = count - i;
+        int repeat = 0;
+        if (rle)
+        {
+            if (pos >= size)
+                break;
+            run = (size_t)(data[pos] & 0x7f) + 1;
+            repeat = (data[pos] & 0x80) != 0;
+            pos++;
+            if (run > count - i)
+                run = count - i;
+        }
+        size_t needed = repeat ? (size_t)bytes : run * bytes;
+        if (pos > size || size - pos < needed)
+            break;
+        for (size_t k = 0; k < run; k++)
+        {
+            pixels[i++] = texture_tga_pixel(data + pos + (repeat ? 0 : k * bytes), bytes);
+        }
+        pos += needed;
+    }
+    if (i < count)
+    {
+        free(pixels);
+        return NULL;
+    }
+
+    if (!top_down)
+    {
+        for (int y = 0; y < h / 2; y++)
+        {
+            uint32_t* a = pixels + (size_t)y * w;
+            uint32_t* b = pixels + (size_t)(h - 1 - y) * w;
+            for (int x = 0; x < w; x++)
+            {
+                uint32_t tmp = a[x]; a[x] = b[x]; b[x] = tmp;
+            }
+        }
+    }
+    *width = w;
+    *height = h;
+    return pixels;
+}
+
+int texture_load(const char* path, texture* t)
+{
+    memset(t, 0, sizeof(*t));
+    size_t size = 0;
+    unsigned char* data = texture_read_file(path, &size);
+    if (!data)
+        return 1;
+
+    int width = 0, height = 0;
+    uint32_t* pixels = NULL;
+    if (size >= 2 && data[0] == 'P' && data[1] == '6')
+        pixels = texture_decode_ppm(data, size, &width, &height);
+    else
+        pixels = texture_decode_tga(data, size, &width, &height);
+    free(data);
+    if (!pixels)
+    {
+        fprintf(stderr, "Texture %s is not a binary PPM or TGA image, or is truncated\n", path);
+        return 1;
+    }
+
+    int result = texture_init(t, pixels, width, height);
+    free(pixels);
+    return result;
+}
+
+int texture_select_level(const texture* t, float rho_squared)
+{
+    // floor(log2(sqrt(r))) is half of floor(log2(r)), which is r's exponent
+    uint32_t bits;
+    memcpy(&bits, &rho_squared, sizeof(bits));
+    int exponent = (int)((bits >> 23) & 0xff) - 127;
+    if (exponent < 0 || (bits >> 31))
+        return 0;
+    int level = exponent >> 1;
+    return level < t->num_levels ? level : t->num_levels - 1;
+}
+
+// a + floor((b - a) * f / 2^TEXTURE_FILTER_BITS) for one 8-bit channel, which is what the SIMD shift computes
+static inline int texture_lerp(int a, int b, int f)
+{
+    const int bias = 255 << TEXTURE_FILTER_BITS; // keeps the shifted value non-negative
+    return a + (((b - a) * f + bias) >> TEXTURE_FILTER_BITS) - 255;
+}
+
+static inline float texture_clamp(float x)
+{
+    x = x > -TEXTURE_COORD_LIMIT ? x : -TEXTURE_COORD_LIMIT;
+    return x < TEXTURE_COORD_LIMIT ? x : TEXTURE_COORD_LIMIT;
+}
+
+// one pixel of texture_sample_span, at texel position (x, y) in TEXTURE_FILTER_BITS fixed point, texel centers at 0
+static uint32_t texture_sample_one(const texture_level* level, float x, float y)
+{
+    const int one = 1 << TEXTURE_FILTER_BITS;
+    x = texture_clamp(x);
+    y = texture_clamp(y);
+    int xi = (int)x;
+    int yi = (int)y;
+    xi -= x < (float)xi;
+    yi -= y < (float)yi;
+
+    int x0 = (xi >> TEXTURE_FILTER_BITS) & (level->width - 1);
+    int y0 = (yi >> TEXTURE_FILTER_BITS) & (level->height - 1);
+    int x1 = (x0 + 1) & (level->width - 1);
+    int y1 = (y0 + 1) & (level->height - 1);
+    int fx = xi & (one - 1);
+    int fy = yi & (one - 1);
+
+    uint32_t t00 = level->texels[texture_texel_offset(level, x0, y0)];
+    uint32_t t10 = level->texels[texture_texel_offset(level, x1, y0)];
+    uint32_t t01 = level->texels[texture_texel_offset(level, x0, y1)];
+    uint32_t t11 = level->texels[texture_texel_offset(level, x1, y1)];
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        int top = texture_lerp((t00 >> shift) & 0xff, (t10 >> shift) & 0xff, fx);
+        int bottom = texture_lerp((t01 >> shift) & 0xff, (t11 >> shift) & 0xff, fx);
+        out |= (uint32_t)texture_lerp(top, bottom, fy) << shift;
+    }
+    return out;
+}
+
+#if defined(RENDER_SSE2)
+// bilinear blend of four pixels' footprints, 16 bits per channel, as texture_lerp does it
+static inline __m128i sse_texture_blend(__m128i t00, __m128i t10, __m128i t01, __m128i t11, __m128i fx, __m128i fy)
+{
+    const __m128i zero = _mm_setzero_si128();
+    // every 16-bit lane of a pixel gets that pixel's weight
+    fx = _mm_or_si128(fx, _mm_slli_epi32(fx, 16));
+    fy = _mm_or_si128(fy, _mm_slli_epi32(fy, 16));
+    __m128i half[2];
+    for (int h = 0; h < 2; h++)
+    {
+        __m128i wx = h ? _mm_unpackhi_epi32(fx, fx) : _mm_unpacklo_epi32(fx, fx);
+        __m128i wy = h ? _mm_unpackhi_epi32(fy, fy) : _mm_unpacklo_epi32(fy, fy);
+        __m128i a = h ? _mm_unpackhi_epi8(t00, zero) : _mm_unpacklo_epi8(t00, zero);
+        __m128i b = h ? _mm_unpackhi_epi8(t10, zero) : _mm_unpacklo_epi8(t10, zero);
+        __m128i c = h ? _mm_unpackhi_epi8(t01, zero) : _mm_unpacklo_epi8(t01, zero);
+        __m128i d = h ? _mm_unpackhi_epi8(t11, zero) : _mm_unpacklo_epi8(t11, zero);
+        __m128i top = _mm_add_epi16(a, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(b, a), wx), TEXTURE_FILTER_BITS));
+        __m128i bottom = _mm_add_epi16(c, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(d, c), wx), TEXTURE_FILTER_BITS));
+        half[h] = _mm_add_epi16(top, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(bottom, top), wy), TEXTURE_FILTER_BITS));
+    }
+    return _mm_packus_epi16(half[0], half[1]);
+}
+
+// floor of a float vector as int32, without SSE4.1's round
+static inline __m128i sse_texture_floor(__m128 x)
+{
+    __m128i i = _mm_cvttps_epi32(x);
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(i)))); // true is -1
+}
+
+// texel offsets of a tile layout (texture_texel_offset), four at a time
+static inline __m128i sse_texture_offset(__m128i x, __m128i y, __m128i shift)
+{
+    __m128i three = _mm_set1_epi32(3);
+    __m128i tile = _mm_add_epi32(_mm_sll_epi32(_mm_srli_epi32(y, 2), shift), _mm_srli_epi32(x, 2));
+    return _mm_add_epi32(_mm_slli_epi32(tile, 4),
+                         _mm_add_epi32(_mm_slli_epi32(_mm_and_si128(y, three), 2), _mm_and_si128(x, three)));
+}
+#endif
+
+#if defined(RENDER_AVX2)
+static inline __m256i avx_texture_blend(__m256i t00, __m256i t10, __m256i t01, __m256i t11, __m256i fx, __m256i fy)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    fx = _mm256_or_si256(fx, _mm256_slli_epi32(fx, 16));
+    fy = _mm256_or_si256(fy, _mm256_slli_epi32(fy, 16));
+    __m256i half[2];
+    for (int h = 0; h < 2; h++)
+    {
+        __m256i wx = h ? _mm256_unpackhi_epi32(fx, fx) : _mm256_unpacklo_epi32(fx, fx);
+        __m256i wy = h ? _mm256_unpackhi_epi32(fy, fy) : _mm256_unpacklo_epi32(fy, fy);
+        __m256i a = h ? _mm256_unpackhi_epi8(t00, zero) : _mm256_unpacklo_epi8(t00, zero);
+        __m256i b = h ? _mm256_unpackhi_epi8(t10, zero) : _mm256_unpacklo_epi8(t10, zero);
+        __m256i c = h ? _mm256_unpackhi_epi8(t01, zero) : _mm256_unpacklo_epi8(t01, zero);
+        __m256i d = h ? _mm256_unpackhi_epi8(t11, zero) : _mm256_unpacklo_epi8(t11, zero);
+        __m256i top = _mm256_add_epi16(a, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(b, a), wx), TEXTURE_FILTER_BITS));
+        __m256i bottom = _mm256_add_epi16(c, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(d, c), wx), TEXTURE_FILTER_BITS));
+        half[h] = _mm256_add_epi16(top, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(bottom, top), wy), TEXTURE_FILTER_BITS));
+    }
+    // unpack and pack both work within 128-bit lanes, so this puts the pixels back in order
+    return _mm256_packus_epi16(half[0], half[1]);
+}
+
+static inline __m256i avx_texture_offset(__m256i x, __m256i y, __m128i shift)
+{
+    __m256i three = _mm256_set1_epi32(3);
+    __m256i tile = _mm256_add_epi32(_mm256_sll_epi32(_mm256_srli_epi32(y, 2), shift), _mm256_srli_epi32(x, 2));
+    return _mm256_add_epi32(_mm256_slli_epi32(tile, 4),
+                            _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, three), 2), _mm256_and_si256(x, three)));
+}
+#endif
+
+void texture_sample_span(const texture_level* level, float s, float t, float q, float ds, float dt, float dq,
+                         int count, uint32_t* out)
+{
+    const int one = 1 << TEXTURE_FILTER_BITS;
+    const float scale_x = (float)(level->width * one);
+    const float scale_y = (float)(level->height * one);
+    const float half = (float)(one / 2);
+    int i = 0;
+
+#if defined(RENDER_AVX2)
+    {
+        const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 lo = _mm256_set1_ps(-TEXTURE_COORD_LIMIT), hi = _mm256_set1_ps(TEXTURE_COORD_LIMIT);
+        const __m256i mask_x = _mm256_set1_epi32(level->width - 1), mask_y = _mm256_set1_epi32(level->height - 1);
+        const __m256i frac = _mm256_set1_epi32(one - 1), inc = _mm256_set1_epi32(1);
+        const __m128i shift = _mm_cvtsi32_si128(level->tiles_x_shift);
+        const int* texels = (const int*)level->texels;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), lane);
+            __m256 qv = _mm256_add_ps(_mm256_set1_ps(q), _mm256_mul_ps(index, _mm256_set1_ps(dq)));
+            __m256 u = _mm256_div_ps(_mm256_add_ps(_mm256_set1_ps(s), _mm256_mul_ps(index, _mm256_set1_ps(ds))), qv);
+            __m256 v = _mm256_div_ps(_mm256_add_ps(_mm256_set1_ps(t), _mm256_mul_ps(index, _mm256_set1_ps(dt))), qv);
+            __m256 x = _mm256_sub_ps(_mm256_mul_ps(u, _mm256_set1_ps(scale_x)), _mm256_set1_ps(half));
+            __m256 y = _mm256_sub_ps(_mm256_mul_ps(v, _mm256_set1_ps(scale_y)), _mm256_set1_ps(half));
+            __m256i xi = _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_min_ps(_mm256_max_ps(x, lo), hi)));
+            __m256i yi = _mm256_cvtps_epi32(_mm256_floor_ps(_mm256_min_ps(_mm256_max_ps(y, lo), hi)));
+
+            __m256i x0 = _mm256_and_si256(_mm256_srai_epi32(xi, TEXTURE_FILTER_BITS), mask_x);
+            __m256i y0 = _mm256_and_si256(_mm256_srai_epi32(yi, TEXTURE_FILTER_BITS), mask_y);
+            __m256i x1 = _mm256_and_si256(_mm256_add_epi32(x0, inc), mask_x);
+            __m256i y1 = _mm256_and_si256(_mm256_add_epi32(y0, inc), mask_y);
+            __m256i t00 = _mm256_i32gather_epi32(texels, avx_texture_offset(x0, y0, shift), 4);
+            __m256i t10 = _mm256_i32gather_epi32(texels, avx_texture_offset(x1, y0, shift), 4);
+            __m256i t01 = _mm256_i32gather_epi32(texels, avx_texture_offset(x0, y1, shift), 4);
+            __m256i t11 = _mm256_i32gather_epi32(texels, avx_texture_offset(x1, y1, shift), 4);
+            __m256i color = avx_texture_blend(t00, t10, t01, t11, _mm256_and_si256(xi, frac), _mm256_and_si256(yi, frac));
+            _mm256_storeu_si256((__m256i*)(out + i), color);
+        }
+    }
+#endif
+#if defined(RENDER_SSE2)
+    {
+        const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 lo = _mm_set1_ps(-TEXTURE_COORD_LIMIT), hi = _mm_set1_ps(TEXTURE_COORD_LIMIT);
+        const __m128i mask_x = _mm_set1_epi32(level->width - 1), mask_y = _mm_set1_epi32(level->height - 1);
+        const __m128i frac = _mm_set1_epi32(one - 1), inc = _mm_set1_epi32(1);
+        const __m128i shift = _mm_cvtsi32_si128(level->tiles_x_shift);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 index = _mm_add_ps(_mm_set1_ps((float)i), lane);
+            __m128 qv = _mm_add_ps(_mm_set1_ps(q), _mm_mul_ps(index, _mm_set1_ps(dq)));
+            __m128 u = _mm_div_ps(_mm_add_ps(_mm_set1_ps(s), _mm_mul_ps(index, _mm_set1_ps(ds))), qv);
+            __m128 v = _mm_div_ps(_mm_add_ps(_mm_set1_ps(t), _mm_mul_ps(index, _mm_set1_ps(dt))), qv);
+            __m128 x = _mm_sub_ps(_mm_mul_ps(u, _mm_set1_ps(scale_x)), _mm_set1_ps(half));
+            __m128 y = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(scale_y)), _mm_set1_ps(half));
+            __m128i xi = sse_texture_floor(_mm_min_ps(_mm_max_ps(x, lo), hi));
+            __m128i yi = sse_texture_floor(_mm_min_ps(_mm_max_ps(y, lo), hi));
+
+            __m128i x0 = _mm_and_si128(_mm_srai_epi32(xi, TEXTURE_FILTER_BITS), mask_x);
+            __m128i y0 = _mm_and_si128(_mm_srai_epi32(yi, TEXTURE_FILTER_BITS), mask_y);
+            __m128i x1 = _mm_and_si128(_mm_add_epi32(x0, inc), mask_x);
+            __m128i y1 = _mm_and_si128(_mm_add_epi32(y0, inc), mask_y);
+            // no gather before AVX2: work out the offsets four wide, then fetch one by one
+            int offsets[4][4];
+            _mm_storeu_si128((__m128i*)offsets[0], sse_texture_offset(x0, y0, shift));
+            _mm_storeu_si128((__m128i*)offsets[1], sse_texture_offset(x1, y0, shift));
+            _mm_storeu_si128((__m128i*)offsets[2], sse_texture_offset(x0, y1, shift));
+            _mm_storeu_si128((__m128i*)offsets[3], sse_texture_offset(x1, y1, shift));
+            __m128i corner[4];
+            for (int c = 0; c < 4; c++)
+            {
+                const uint32_t* tx = level->texels;
+                corner[c] = _mm_setr_epi32((int)tx[offsets[c][0]], (int)tx[offsets[c][1]],
+                                           (int)tx[offsets[c][2]], (int)tx[offsets[c][3]]);
+            }
+            __m128i color = sse_texture_blend(corner[0], corner[1], corner[2], corner[3],
+                                              _mm_and_si128(xi, frac), _mm_and_si128(yi, frac));
+            _mm_storeu_si128((__m128i*)(out + i), color);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        float index = (float)i;
+        float qi = q + index * dq;
+        out[i] = texture_sample_one(level, (s + index * ds) / qi * scale_x - half, (t + index * dt) / qi * scale_y - half);
+    }
+}
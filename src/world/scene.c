@@ -0,0 +1,195 @@
+// the scene graph: node hierarchy, dirty-flag transform propagation, bounds and culled drawing
+#include "scene.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline float minf(float a, float b) { return a < b ? a : b; }
+static inline float maxf(float a, float b) { return a > b ? a : b; }
+
+static int scene_bounds_empty(vec3f lo, vec3f hi)
+{
+    return lo.x > hi.x || lo.y > hi.y || lo.z > hi.z;
+}
+
+void scene_init(scene* s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void scene_destroy(scene* s)
+{
+    free(s->nodes);
+    free(s->hidden);
+    memset(s, 0, sizeof(*s));
+}
+
+int scene_add_node(scene* s, int parent, const surface* surface, const mat4 local)
+{
+    if (parent != SCENE_NO_PARENT && (parent < 0 || parent >= s->num_nodes))
+    {
+        fprintf(stderr, "scene_add_node: no node %d to parent to\n", parent);
+        return -1;
+    }
+
+    if (s->num_nodes == s->node_alloc)
+    {
+        int grown = s->node_alloc ? s->node_alloc * 2 : 64;
+        scene_node* nodes = realloc(s->nodes, (size_t)grown * sizeof(scene_node));
+        uint8_t* hidden = realloc(s->hidden, (size_t)grown);
+        if (!nodes || !hidden)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+            exit(1);
+        }
+        s->nodes = nodes;
+        s->hidden = hidden;
+        s->node_alloc = grown;
+    }
+
+    int index = s->num_nodes++;
+    scene_node* node = &s->nodes[index];
+    memset(node, 0, sizeof(*node));
+    node->parent = parent;
+    node->surface = surface;
+    memcpy(node->local, local, sizeof(mat4));
+    node->dirty = 1;
+    s->num_dirty++;
+    if (parent != SCENE_NO_PARENT)
+    {
+        s->nodes[parent].num_children++;
+    }
+    return index;
+}
+
+void scene_set_local(scene* s, int node, const mat4 local)
+{
+    scene_node* n = &s->nodes[node];
+    memcpy(n->local, local, sizeof(mat4));
+    if (!n->dirty)
+    {
+        n->dirty = 1;
+        s->num_dirty++;
+    }
+}
+
+int scene_update(scene* s)
+{
+    if (s->num_dirty == 0)
+        return 0;
+
+    // forward: parents come first, so a node's parent is always final by the time we get to it. `dirty` is
+    // pushed down to the whole subtree on the way, which is what the backward pass keys on
+    int recomputed = 0;
+    for (int i = 0; i < s->num_nodes; i++)
+    {
+        scene_node* n = &s->nodes[i];
+        const scene_node* p = n->parent == SCENE_NO_PARENT ? NULL : &s->nodes[n->parent];
+        if (p && p->dirty)
+        {
+            n->dirty = 1;
+        }
+
+        if (n->dirty)
+        {
+            if (p)
+            {
+                mat4_multiply((float*)p->world, n->local, n->world);
+            }
+            else
+            {
+                memcpy(n->world, n->local, sizeof(mat4));
+            }
+
+            if (n->surface)
+            {
+                surface_transform_bounds(n->surface->bounds_min, n->surface->bounds_max, n->world,
+                                         &n->bounds_min, &n->bounds_max);
+            }
+            else
+            {
+                n->bounds_min = (vec3f){FLT_MAX, FLT_MAX, FLT_MAX};
+                n->bounds_max = (vec3f){-FLT_MAX, -FLT_MAX, -FLT_MAX};
+            }
+            recomputed++;
+        }
+        n->subtree_min = n->bounds_min;
+        n->subtree_max = n->bounds_max;
+    }
+
+    // backward: children come after their parents, so every subtree is complete before it's merged upward
+    for (int i = s->num_nodes - 1; i >= 0; i--)
+    {
+        scene_node* n = &s->nodes[i];
+        n->dirty = 0;
+        if (n->parent == SCENE_NO_PARENT)
+            continue;
+
+        scene_node* p = &s->nodes[n->parent];
+        p->subtree_min.x = minf(p->subtree_min.x, n->subtree_min.x);
+        p->subtree_min.y = minf(p->subtree_min.y, n->subtree_min.y);
+        p->subtree_min.z = minf(p->subtree_min.z, n->subtree_min.z);
+        p->subtree_max.x = maxf(p->subtree_max.x, n->subtree_max.x);
+        p->subtree_max.y = maxf(p->subtree_max.y, n->subtree_max.y);
+        p->subtree_max.z = maxf(p->subtree_max.z, n->subtree_max.z);
+    }
+
+    s->num_dirty = 0;
+    return recomputed;
+}
+
+int scene_render(scene* s, render_context* ctx, uint32_t* image, vec3f camera_pos, quat camera_rot)
+{
+    scene_update(s);
+
+    // bounds are already in world space
+    mat4 identity;
+    mat4_identity(identity);
+
+    // runs of visible nodes that share a mesh and materials go down as one instanced draw
+    mat4* transforms = arena_alloc_array(&ctx->frame_arena, mat4, s->num_nodes);
+    const mesh* run_mesh = NULL;
+    const material* const* run_materials = NULL;
+    int run = 0;
+
+    int drawn = 0;
+    for (int i = 0; i < s->num_nodes; i++)
+    {
+        scene_node* n = &s->nodes[i];
+
+        // a hidden parent hides the whole subtree; otherwise test the subtree as a unit if there is more than
+        // this node in it, and the node's own box if it has something to draw
+        int hidden = n->parent != SCENE_NO_PARENT && s->hidden[n->parent];
+        if (!hidden && n->num_children > 0)
+        {
+            hidden = scene_bounds_empty(n->subtree_min, n->subtree_max) ||
+                     !render_bounds_visible(ctx, n->subtree_min, n->subtree_max, identity, camera_pos, camera_rot);
+        }
+        s->hidden[i] = (uint8_t)hidden;
+
+        if (hidden || !n->surface)
+            continue;
+        if (!render_bounds_visible(ctx, n->bounds_min, n->bounds_max, identity, camera_pos, camera_rot))
+            continue;
+
+        if (n->surface->mesh != run_mesh || n->surface->materials != run_materials)
+        {
+            if (run > 0)
+            {
+                render_mesh_instanced(ctx, image, run_mesh, run_materials, transforms, run, camera_pos, camera_rot);
+            }
+            run_mesh = n->surface->mesh;
+            run_materials = n->surface->materials;
+            run = 0;
+        }
+        memcpy(transforms[run++], n->world, sizeof(mat4));
+        drawn++;
+    }
+    if (run > 0)
+    {
+        render_mesh_instanced(ctx, image, run_mesh, run_materials, transforms, run, camera_pos, camera_rot);
+    }
+    return drawn;
+}
@@ -0,0 +1,41 @@
+// drawable surfaces for the scene graph, and moving their bounds between spaces
+#include "surface.h"
+
+void surface_init(surface* s, const mesh* m)
+{
+    s->mesh = m;
+    s->materials = NULL;
+    s->bounds_min = m->bounds_min;
+    s->bounds_max = m->bounds_max;
+}
+
+void surface_transform_bounds(vec3f bounds_min, vec3f bounds_max, const mat4 m, vec3f* out_min, vec3f* out_max)
+{
+    float center[3] = {
+        (bounds_min.x + bounds_max.x) * 0.5f,
+        (bounds_min.y + bounds_max.y) * 0.5f,
+        (bounds_min.z + bounds_max.z) * 0.5f
+    };
+    float extent[3] = {
+        (bounds_max.x - bounds_min.x) * 0.5f,
+        (bounds_max.y - bounds_min.y) * 0.5f,
+        (bounds_max.z - bounds_min.z) * 0.5f
+    };
+
+    // column-major: element (row, col) is m[col * 4 + row]
+    float new_center[3], new_extent[3];
+    for (int row = 0; row < 3; row++)
+    {
+        new_center[row] = m[12 + row];
+        new_extent[row] = 0.0f;
+        for (int col = 0; col < 3; col++)
+        {
+            float e = m[col * 4 + row];
+            new_center[row] += e * center[col];
+            new_extent[row] += (e < 0.0f ? -e : e) * extent[col];
+        }
+    }
+
+    *out_min = (vec3f){new_center[0] - new_extent[0], new_center[1] - new_extent[1], new_center[2] - new_extent[2]};
+    *out_max = (vec3f){new_center[0] + new_extent[0], new_center[1] + new_extent[1], new_center[2] + new_extent[2]};
+}
@@ -0,0 +1,104 @@
+// per-frame bump allocator
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// the block header is padded out so the first allocation in a block is already cache line aligned
+#define ARENA_HEADER_SIZE ((sizeof(arena_block) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static arena_block* arena_new_block(size_t size)
+{
+    // over-allocate so the data area can be aligned no matter what malloc returns
+    arena_block* block = malloc(ARENA_HEADER_SIZE + size + ARENA_ALIGN);
+    if (!block)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        exit(1);
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+static char* arena_block_data(arena_block* block)
+{
+    uintptr_t data = (uintptr_t)block + ARENA_HEADER_SIZE;
+    data = (data + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    return (char*)data;
+}
+
+void arena_init(arena* a, size_t initial_size)
+{
+    a->blocks = arena_new_block(initial_size);
+}
+
+void* arena_alloc(arena* a, size_t size, size_t align)
+{
+    arena_block* block = a->blocks;
+    char* data = arena_block_data(block);
+    uintptr_t start = ((uintptr_t)(data + block->used) + align - 1) & ~(uintptr_t)(align - 1);
+
+    if (start + size > (uintptr_t)(data + block->size))
+    {
+        // out of room: chain a new block at least twice as big as the last one
+        size_t new_size = block->size * 2;
+        if (new_size < size + align)
+        {
+            new_size = size + align;
+        }
+        arena_block* fresh = arena_new_block(new_size);
+        fresh->next = block;
+        a->blocks = fresh;
+        block = fresh;
+        data = arena_block_data(block);
+        start = ((uintptr_t)data + align - 1) & ~(uintptr_t)(align - 1);
+    }
+
+    block->used = (start + size) - (uintptr_t)data;
+    return (void*)start;
+}
+
+size_t arena_used(const arena* a)
+{
+    size_t used = 0;
+    for (arena_block* block = a->blocks; block; block = block->next)
+    {
+        used += block->used;
+    }
+    return used;
+}
+
+void arena_reset(arena* a)
+{
+    if (a->blocks->next)
+    {
+        // the frame overflowed into several blocks; replace them with one that fits it outright
+        size_t total = 0;
+        arena_block* block = a->blocks;
+        while (block)
+        {
+            arena_block* next = block->next;
+            total += block->size;
+            free(block);
+            block = next;
+        }
+        a->blocks = arena_new_block(total);
+    }
+
+    a->blocks->used = 0;
+}
+
+void arena_destroy(arena* a)
+{
+    arena_block* block = a->blocks;
+    while (block)
+    {
+        arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    a->blocks = NULL;
+}
@@ -0,0 +1,252 @@
+// per-tile dirty flags, and the clears and upload rectangles built from them
+#include "dirty.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simd.h"
+
+int dirty_init(dirty_tiles* d, int width, int height, int tile_size)
+{
+    d->width = width;
+    d->height = height;
+    d->tile_size = tile_size;
+    d->tile_shift = 0;
+    while ((1 << d->tile_shift) < tile_size)
+    {
+        d->tile_shift++;
+    }
+    if (tile_size <= 0 || (1 << d->tile_shift) != tile_size)
+    {
+        fprintf(stderr, "Dirty tile size %d is not a power of two!\n", tile_size);
+        d->tiles = NULL;
+        return 1;
+    }
+    d->tiles_x = (width + tile_size - 1) / tile_size;
+    d->tiles_y = (height + tile_size - 1) / tile_size;
+    d->tiles = malloc((size_t)d->tiles_x * d->tiles_y);
+    if (!d->tiles)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+    dirty_mark_all(d);
+    return 0;
+}
+
+void dirty_destroy(dirty_tiles* d)
+{
+    free(d->tiles);
+    d->tiles = NULL;
+}
+
+void dirty_reset(dirty_tiles* d)
+{
+    memset(d->tiles, 0, (size_t)d->tiles_x * d->tiles_y);
+}
+
+void dirty_mark_all(dirty_tiles* d)
+{
+    memset(d->tiles, 1, (size_t)d->tiles_x * d->tiles_y);
+}
+
+void dirty_mark_rect(dirty_tiles* d, int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > d->width) x1 = d->width;
+    if (y1 > d->height) y1 = d->height;
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    int tx0 = x0 / d->tile_size;
+    int tx1 = (x1 - 1) / d->tile_size;
+    for (int ty = y0 / d->tile_size; ty <= (y1 - 1) / d->tile_size; ty++)
+    {
+        memset(&d->tiles[ty * d->tiles_x + tx0], 1, tx1 - tx0 + 1);
+    }
+}
+
+void dirty_copy(dirty_tiles* dst, const dirty_tiles* src)
+{
+    memcpy(dst->tiles, src->tiles, (size_t)src->tiles_x * src->tiles_y);
+}
+
+void dirty_merge(dirty_tiles* dst, const dirty_tiles* src)
+{
+    int num_tiles = src->tiles_x * src->tiles_y;
+    for (int i = 0; i < num_tiles; i++)
+    {
+        dst->tiles[i] |= src->tiles[i];
+    }
+}
+
+// the next run of dirty tiles in row `ty` at or after column `tx`, as [*run_start, *run_end); 0 if there is none
+static int dirty_next_run(const dirty_tiles* d, int ty, int tx, int* run_start, int* run_end)
+{
+    const uint8_t* row = &d->tiles[ty * d->tiles_x];
+    while (tx < d->tiles_x && !row[tx])
+    {
+        tx++;
+    }
+    if (tx == d->tiles_x)
+        return 0;
+    *run_start = tx;
+    while (tx < d->tiles_x && row[tx])
+    {
+        tx++;
+    }
+    *run_end = tx;
+    return 1;
+}
+
+// tile rectangle [tx0, tx1) x [ty0, ty1) to pixels, clipped to the buffer
+static dirty_rect dirty_tile_rect(const dirty_tiles* d, int tx0, int ty0, int tx1, int ty1)
+{
+    int x0 = tx0 * d->tile_size;
+    int y0 = ty0 * d->tile_size;
+    int x1 = tx1 * d->tile_size;
+    int y1 = ty1 * d->tile_size;
+    if (x1 > d->width) x1 = d->width;
+    if (y1 > d->height) y1 = d->height;
+    return (dirty_rect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+int dirty_rects(const dirty_tiles* d, dirty_rect* rects)
+{
+    // built in tiles first: x0, x1, y0, y1 per rectangle, y1 being one past the last row it has grown into
+    int tile_rects[DIRTY_MAX_RECTS][4];
+    int count = 0;
+    int overflow = 0;
+    int bx0 = d->tiles_x, by0 = d->tiles_y, bx1 = 0, by1 = 0;
+
+    for (int ty = 0; ty < d->tiles_y; ty++)
+    {
+        int row_start = count;
+        int run_start, run_end;
+        int tx = 0;
+        while (dirty_next_run(d, ty, tx, &run_start, &run_end))
+        {
+            tx = run_end;
+            if (run_start < bx0) bx0 = run_start;
+            if (run_end > bx1) bx1 = run_end;
+            if (ty < by0) by0 = ty;
+            by1 = ty + 1;
+            if (overflow)
+                continue;
+
+            // grow a rectangle that reached the row above with exactly this run, if there is one
+            int grown = 0;
+            for (int i = 0; i < row_start; i++)
+            {
+                if (tile_rects[i][0] == run_start && tile_rects[i][1] == run_end && tile_rects[i][3] == ty)
+                {
+                    tile_rects[i][3] = ty + 1;
+                    grown = 1;
+                    break;
+                }
+            }
+            if (grown)
+                continue;
+            if (count == DIRTY_MAX_RECTS)
+            {
+                overflow = 1;
+                continue;
+            }
+            tile_rects[count][0] = run_start;
+            tile_rects[count][1] = run_end;
+            tile_rects[count][2] = ty;
+            tile_rects[count][3] = ty + 1;
+            count++;
+        }
+    }
+
+    if (bx1 == 0)
+        return 0;
+    if (overflow)
+    {
+        rects[0] = dirty_tile_rect(d, bx0, by0, bx1, by1);
+        return 1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        rects[i] = dirty_tile_rect(d, tile_rects[i][0], tile_rects[i][2], tile_rects[i][1], tile_rects[i][3]);
+    }
+    return count;
+}
+
+void dirty_fill32(void* dst, uint32_t pattern, size_t count)
+{
+    char* p = dst;
+    size_t i = 0;
+#if defined(RENDER_AVX2)
+    __m256i wide = _mm256_set1_epi32((int)pattern);
+    for (; i + 32 <= count; i += 32)
+    {
+        _mm256_storeu_si256((__m256i*)(p + i * 4), wide);
+        _mm256_storeu_si256((__m256i*)(p + i * 4 + 32), wide);
+        _mm256_storeu_si256((__m256i*)(p + i * 4 + 64), wide);
+        _mm256_storeu_si256((__m256i*)(p + i * 4 + 96), wide);
+    }
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256((__m256i*)(p + i * 4), wide);
+    }
+#elif defined(RENDER_SSE2)
+    __m128i wide = _mm_set1_epi32((int)pattern);
+    for (; i + 16 <= count; i += 16)
+    {
+        _mm_storeu_si128((__m128i*)(p + i * 4), wide);
+        _mm_storeu_si128((__m128i*)(p + i * 4 + 16), wide);
+        _mm_storeu_si128((__m128i*)(p + i * 4 + 32), wide);
+        _mm_storeu_si128((__m128i*)(p + i * 4 + 48), wide);
+    }
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_si128((__m128i*)(p + i * 4), wide);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        memcpy(p + i * 4, &pattern, 4);
+    }
+}
+
+// fills the dirty tiles of a buffer of 32-bit values, a horizontal run of tiles at a time
+static void dirty_fill_tiles(const dirty_tiles* d, void* buffer, uint32_t pattern)
+{
+    char* base = buffer;
+    size_t stride = (size_t)d->width * 4;
+    for (int ty = 0; ty < d->tiles_y; ty++)
+    {
+        int run_start, run_end;
+        int tx = 0;
+        while (dirty_next_run(d, ty, tx, &run_start, &run_end))
+        {
+            tx = run_end;
+            dirty_rect r = dirty_tile_rect(d, run_start, ty, run_end, ty + 1);
+            if (r.w == d->width)
+            {
+                // whole rows are contiguous, so do the tile row in one go
+                dirty_fill32(base + r.y * stride, pattern, (size_t)r.w * r.h);
+                continue;
+            }
+            for (int y = r.y; y < r.y + r.h; y++)
+            {
+                dirty_fill32(base + y * stride + (size_t)r.x * 4, pattern, r.w);
+            }
+        }
+    }
+}
+
+void dirty_clear_color(const dirty_tiles* d, uint32_t* image, uint32_t color)
+{
+    dirty_fill_tiles(d, image, color);
+}
+
+void dirty_clear_depth(const dirty_tiles* d, float* depth, float value)
+{
+    uint32_t pattern;
+    memcpy(&pattern, &value, sizeof(pattern));
+    dirty_fill_tiles(d, depth, pattern);
+}
@@ -1,48 +1,53 @@
+// backend-independent half of the drawer: dispatches to the active presentation backend
 #include "drawer.h"
 
-#include <SDL2/SDL.h>
+#include <string.h>
 
-SDL_Window *window;
-SDL_Renderer *renderer;
-SDL_Texture *texture;
 int window_width;
 int window_height;
 
-void drawer_init(int width, int height)
-{
-    window = SDL_CreateWindow("3DRenderer",
-        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-        width, height, 0);
+static const drawer_backend* active_backend = &drawer_sdl_backend;
 
-    renderer = SDL_CreateRenderer(window, -1, 0);
+void drawer_set_backend(const drawer_backend* backend)
+{
+    active_backend = backend;
+}
 
-    texture = SDL_CreateTexture(renderer,
-        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
-        width, height);
+const drawer_backend* drawer_find_backend(const char* name)
+{
+    if (strcmp(name, drawer_sdl_backend.name) == 0) return &drawer_sdl_backend;
+    if (strcmp(name, drawer_null_backend.name) == 0) return &drawer_null_backend;
+    return NULL;
+}
 
+int drawer_init(int width, int height)
+{
     window_width = width;
     window_height = height;
+    return active_backend->init(width, height);
 }
 
 void drawer_draw_buffer(uint32_t* image)
 {
-    SDL_UpdateTexture(texture, NULL, image, window_width * sizeof(uint32_t));
-    SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-    SDL_RenderPresent(renderer);
+    active_backend->present(image, NULL, 0);
+}
+
+void drawer_draw_buffer_rects(uint32_t* image, const dirty_rect* rects, int num_rects)
+{
+    active_backend->present(image, rects, num_rects);
+}
+
+int drawer_poll_events(void)
+{
+    return active_backend->poll_events();
 }
 
 void drawer_cleanup()
 {
-    SDL_DestroyTexture(texture);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    active_backend->cleanup();
 }
 
 void drawer_clear_buffer(uint32_t* image)
 {
-    for (int i = 0; i < window_width * window_height; i++)
-    {
-        image[i] = 0xFF000000; // ARGB format, fully transparent
-    }
-}
\ No newline at end of file
+    dirty_fill32(image, 0xFF000000, (size_t)window_width * window_height); // ARGB format, opaque black
+}
@@ -0,0 +1,109 @@
+// null presentation backend: no window, no SDL video. Frames stay in memory and can optionally be dumped to disk,
+// which is what lets the pipeline run on machines without a display.
+#include "drawer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int frame_count;
+static char dump_prefix[512];
+static drawer_dump_format dump_format = DRAWER_DUMP_NONE;
+static unsigned char* dump_row; // scratch RGB row for PPM output
+
+void drawer_null_set_dump(const char* path_prefix, drawer_dump_format format)
+{
+    if (!path_prefix || format == DRAWER_DUMP_NONE)
+    {
+        dump_format = DRAWER_DUMP_NONE;
+        return;
+    }
+    strncpy(dump_prefix, path_prefix, sizeof(dump_prefix) - 1);
+    dump_prefix[sizeof(dump_prefix) - 1] = '\0';
+    dump_format = format;
+}
+
+int drawer_null_frame_count(void)
+{
+    return frame_count;
+}
+
+static void null_write_frame(uint32_t* image)
+{
+    char path[600];
+    snprintf(path, sizeof(path), "%s_%05d.%s", dump_prefix, frame_count,
+             dump_format == DRAWER_DUMP_PPM ? "ppm" : "raw");
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        perror("Failed to open frame dump");
+        dump_format = DRAWER_DUMP_NONE; // don't spam the same error every frame
+        return;
+    }
+
+    if (dump_format == DRAWER_DUMP_RAW)
+    {
+        fwrite(image, sizeof(uint32_t), (size_t)window_width * window_height, file);
+    }
+    else
+    {
+        fprintf(file, "P6\n%d %d\n255\n", window_width, window_height);
+        for (int y = 0; y < window_height; y++)
+        {
+            uint32_t* row = image + (size_t)y * window_width;
+            for (int x = 0; x < window_width; x++)
+            {
+                dump_row[x * 3 + 0] = (row[x] >> 16) & 0xFF;
+                dump_row[x * 3 + 1] = (row[x] >> 8) & 0xFF;
+                dump_row[x * 3 + 2] = row[x] & 0xFF;
+            }
+            fwrite(dump_row, 3, window_width, file);
+        }
+    }
+    fclose(file);
+}
+
+static int null_init(int width, int height)
+{
+    frame_count = 0;
+    dump_row = malloc((size_t)width * 3);
+    if (!dump_row)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return 1;
+    }
+    (void)height;
+    return 0;
+}
+
+static void null_present(uint32_t* image, const dirty_rect* rects, int num_rects)
+{
+    // the whole frame is in memory either way, so dumps don't care what changed
+    (void)rects;
+    (void)num_rects;
+    if (dump_format != DRAWER_DUMP_NONE)
+    {
+        null_write_frame(image);
+    }
+    frame_count++;
+}
+
+static int null_poll_events(void)
+{
+    // nothing to poll without a window; the caller decides when to stop
+    return 1;
+}
+
+static void null_cleanup(void)
+{
+    free(dump_row);
+    dump_row = NULL;
+}
+
+const drawer_backend drawer_null_backend = {
+    .name = "null",
+    .init = null_init,
+    .present = null_present,
+    .poll_events = null_poll_events,
+    .cleanup = null_cleanup
+};
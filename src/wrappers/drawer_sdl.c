@@ -0,0 +1,95 @@
+// SDL presentation backend: streams each frame into a texture and shows it in a window
+#include "drawer.h"
+#include "io.h"
+
+#include <SDL2/SDL.h>
+
+static SDL_Window *window;
+static SDL_Renderer *renderer;
+static SDL_Texture *texture;
+
+static int sdl_init(int width, int height)
+{
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    window = SDL_CreateWindow("3DRenderer",
+        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+        width, height, 0);
+
+    renderer = window ? SDL_CreateRenderer(window, -1, 0) : NULL;
+
+    texture = renderer ? SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+        width, height) : NULL;
+
+    if (!texture)
+    {
+        fprintf(stderr, "Failed to create SDL window: %s\n", SDL_GetError());
+        return 1;
+    }
+    return 0;
+}
+
+static void sdl_present(uint32_t* image, const dirty_rect* rects, int num_rects)
+{
+    // the texture still holds the last frame, so only upload what changed since
+    if (!rects)
+    {
+        SDL_UpdateTexture(texture, NULL, image, window_width * sizeof(uint32_t));
+    }
+    for (int i = 0; rects && i < num_rects; i++)
+    {
+        SDL_Rect r = { rects[i].x, rects[i].y, rects[i].w, rects[i].h };
+        SDL_UpdateTexture(texture, &r, image + (size_t)r.y * window_width + r.x, window_width * sizeof(uint32_t));
+    }
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+}
+
+static int sdl_poll_events(void)
+{
+    int running = 1;
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {
+        switch (event.type)
+        {
+            case SDL_QUIT:
+                running = 0;
+                break;
+            case SDL_KEYDOWN:
+                keydown(event.key.keysym.sym);
+                break;
+            case SDL_KEYUP:
+                keyup(event.key.keysym.sym);
+                break;
+            default:
+                break;
+        }
+    }
+    return running;
+}
+
+static void sdl_cleanup(void)
+{
+    if (texture) SDL_DestroyTexture(texture);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (window) SDL_DestroyWindow(window);
+    texture = NULL;
+    renderer = NULL;
+    window = NULL;
+    SDL_Quit();
+}
+
+const drawer_backend drawer_sdl_backend = {
+    .name = "sdl",
+    .init = sdl_init,
+    .present = sdl_present,
+    .poll_events = sdl_poll_events,
+    .cleanup = sdl_cleanup
+};
@@ -0,0 +1,228 @@
+// per-stage frame profiler: a ring buffer of the most recent frames, each holding the timed events recorded during it
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct profiler_event
+{
+    profiler_stage stage;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} profiler_event;
+
+typedef struct profiler_frame
+{
+    int number;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int num_events;
+    profiler_event events[PROFILER_MAX_EVENTS_PER_FRAME];
+} profiler_frame;
+
+int profiler_enabled = 0;
+
+static profiler_frame* frames;   // ring buffer of PROFILER_MAX_FRAMES
+static int frame_counter;        // total frames begun, including ones that have been overwritten
+static profiler_frame* current;  // frame being recorded, NULL outside begin/end
+static uint64_t epoch_ns;        // timestamps in the exports are relative to this
+
+static const char* stage_names[PROFILE_STAGE_COUNT] = {
+    "vertex",
+    "cull",
+    "project",
+    "bin",
+    "raster",
+    "present",
+    "clear"
+};
+
+const char* profiler_stage_name(profiler_stage stage)
+{
+    return stage_names[stage];
+}
+
+void profiler_enable(int enabled)
+{
+    if (enabled && !frames)
+    {
+        frames = calloc(PROFILER_MAX_FRAMES, sizeof(profiler_frame));
+        if (!frames)
+        {
+            fprintf(stderr, "Memory allocation failed!\n");
+            return;
+        }
+        frame_counter = 0;
+        epoch_ns = timer_now_ns();
+    }
+    profiler_enabled = enabled;
+    current = NULL;
+}
+
+void profiler_begin_frame(void)
+{
+    if (!profiler_enabled)
+        return;
+
+    current = &frames[frame_counter % PROFILER_MAX_FRAMES];
+    current->number = frame_counter;
+    current->num_events = 0;
+    current->start_ns = timer_now_ns();
+    current->end_ns = current->start_ns;
+    frame_counter++;
+}
+
+void profiler_end_frame(void)
+{
+    if (!profiler_enabled || !current)
+        return;
+
+    current->end_ns = timer_now_ns();
+    current = NULL;
+}
+
+void profiler_record(profiler_stage stage, uint64_t start_ns, uint64_t end_ns)
+{
+    if (!current || current->num_events >= PROFILER_MAX_EVENTS_PER_FRAME)
+        return;
+
+    profiler_event* event = &current->events[current->num_events++];
+    event->stage = stage;
+    event->start_ns = start_ns;
+    event->end_ns = end_ns;
+}
+
+// iterates the ring buffer oldest-first, skipping the frame still being recorded
+static int finished_frames(int* first)
+{
+    int count = frame_counter < PROFILER_MAX_FRAMES ? frame_counter : PROFILER_MAX_FRAMES;
+    *first = frame_counter - count;
+    if (current)
+    {
+        count--;
+    }
+    return count < 0 ? 0 : count;
+}
+
+int profiler_export_chrome_trace(const char* path)
+{
+    if (!frames)
+        return 1;
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        perror("Failed to open trace file");
+        return 1;
+    }
+
+    int first;
+    int count = finished_frames(&first);
+
+    // "X" (complete) events carry their own duration, so begin/end pairs don't need matching up.
+    // Timestamps are in microseconds.
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"render\"}}");
+    for (int i = 0; i < count; i++)
+    {
+        profiler_frame* frame = &frames[(first + i) % PROFILER_MAX_FRAMES];
+        fprintf(file, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%d}}",
+                (frame->start_ns - epoch_ns) / 1000.0, (frame->end_ns - frame->start_ns) / 1000.0, frame->number);
+        for (int e = 0; e < frame->num_events; e++)
+        {
+            profiler_event* event = &frame->events[e];
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    stage_names[event->stage], (event->start_ns - epoch_ns) / 1000.0,
+                    (event->end_ns - event->start_ns) / 1000.0);
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    fclose(file);
+    return 0;
+}
+
+int profiler_export_csv(const char* path)
+{
+    if (!frames)
+        return 1;
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        perror("Failed to open CSV file");
+        return 1;
+    }
+
+    fprintf(file, "frame,total_us");
+    for (int s = 0; s < PROFILE_STAGE_COUNT; s++)
+    {
+        fprintf(file, ",%s_us", stage_names[s]);
+    }
+    fprintf(file, "\n");
+
+    int first;
+    int count = finished_frames(&first);
+    for (int i = 0; i < count; i++)
+    {
+        profiler_frame* frame = &frames[(first + i) % PROFILER_MAX_FRAMES];
+
+        // a stage can run more than once per frame, so sum its events
+        uint64_t totals[PROFILE_STAGE_COUNT] = {0};
+        for (int e = 0; e < frame->num_events; e++)
+        {
+            totals[frame->events[e].stage] += frame->events[e].end_ns - frame->events[e].start_ns;
+        }
+
+        fprintf(file, "%d,%.1f", frame->number, (frame->end_ns - frame->start_ns) / 1000.0);
+        for (int s = 0; s < PROFILE_STAGE_COUNT; s++)
+        {
+            fprintf(file, ",%.1f", totals[s] / 1000.0);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void profiler_print_summary(FILE* out)
+{
+    if (!frames)
+        return;
+
+    int first;
+    int count = finished_frames(&first);
+    if (count == 0)
+        return;
+
+    uint64_t totals[PROFILE_STAGE_COUNT] = {0};
+    uint64_t frame_total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        profiler_frame* frame = &frames[(first + i) % PROFILER_MAX_FRAMES];
+        frame_total += frame->end_ns - frame->start_ns;
+        for (int e = 0; e < frame->num_events; e++)
+        {
+            totals[frame->events[e].stage] += frame->events[e].end_ns - frame->events[e].start_ns;
+        }
+    }
+
+    fprintf(out, "mean per-stage time over the last %d frames:\n", count);
+    for (int s = 0; s < PROFILE_STAGE_COUNT; s++)
+    {
+        if (totals[s] == 0)
+            continue;
+        fprintf(out, "  %-16s %9.3f ms  %5.1f%%\n", stage_names[s], totals[s] / 1e6 / count,
+                frame_total ? 100.0 * totals[s] / frame_total : 0.0);
+    }
+    fprintf(out, "  %-16s %9.3f ms\n", "frame", frame_total / 1e6 / count);
+}
+
+void profiler_cleanup(void)
+{
+    free(frames);
+    frames = NULL;
+    current = NULL;
+    profiler_enabled = 0;
+}
@@ -0,0 +1,101 @@
+// frame pacing: fixed-timestep simulation, deadline-based sleeping and dropped frame accounting
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "timer.h"
+
+// SDL_Delay can oversleep by about a scheduler tick; sleep this much short of the deadline and spin the rest
+#define SCHEDULER_SPIN_NS 1500000ull
+
+void scheduler_init(scheduler* s, double step_hz, double target_fps, int lockstep)
+{
+    s->step_ns = (uint64_t)(1e9 / step_hz);
+    s->budget_ns = target_fps > 0.0 ? (uint64_t)(1e9 / target_fps) : 0;
+    s->lockstep = lockstep;
+    s->frame_start = 0;
+    s->deadline = 0;
+    s->accumulator = 0;
+    s->last_frame_ns = 0;
+    s->frames = 0;
+    s->dropped = 0;
+    s->busy_ns = 0;
+    s->worst_ns = 0;
+}
+
+int scheduler_begin_frame(scheduler* s)
+{
+    uint64_t now = timer_now_ns();
+    int first = s->frames == 0;
+    s->last_frame_ns = first ? 0 : now - s->frame_start;
+    s->frame_start = now;
+    if (first)
+    {
+        s->deadline = now + s->budget_ns;
+    }
+
+    if (s->lockstep)
+        return 1;
+
+    s->accumulator += s->last_frame_ns;
+    uint64_t steps = s->accumulator / s->step_ns;
+    if (steps > SCHEDULER_MAX_STEPS)
+    {
+        // too far behind to catch up: run what we can and let the rest of the time go
+        steps = SCHEDULER_MAX_STEPS;
+        s->accumulator = 0;
+    }
+    else
+    {
+        s->accumulator -= steps * s->step_ns;
+    }
+    return (int)steps;
+}
+
+void scheduler_end_frame(scheduler* s)
+{
+    uint64_t now = timer_now_ns();
+    uint64_t busy = now - s->frame_start;
+    s->frames++;
+    s->busy_ns += busy;
+    if (busy > s->worst_ns)
+    {
+        s->worst_ns = busy;
+    }
+
+    if (s->budget_ns == 0)
+        return;
+
+    if (now > s->deadline)
+    {
+        // missed it; pace the next frame from here instead of rushing to make up for it
+        s->dropped++;
+        s->deadline = now + s->budget_ns;
+        return;
+    }
+
+    uint64_t remaining = s->deadline - now;
+    if (remaining > SCHEDULER_SPIN_NS)
+    {
+        SDL_Delay((Uint32)((remaining - SCHEDULER_SPIN_NS) / 1000000ull));
+    }
+    while (timer_now_ns() < s->deadline)
+    {
+        // spin out the last bit, which SDL_Delay can't hit precisely
+    }
+    s->deadline += s->budget_ns;
+}
+
+void scheduler_print_summary(const scheduler* s)
+{
+    if (s->frames == 0)
+        return;
+
+    printf("%d frames, %.2f ms average, %.2f ms worst", s->frames,
+           timer_ns_to_ms(s->busy_ns) / s->frames, timer_ns_to_ms(s->worst_ns));
+    if (s->budget_ns > 0)
+    {
+        printf(", %d dropped (over %.2f ms)", s->dropped, timer_ns_to_ms(s->budget_ns));
+    }
+    printf("\n");
+}
@@ -0,0 +1,155 @@
+// framebuffers rotated between a render thread and the thread that presents them
+#include "swapchain.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "dirty.h"
+
+struct swapchain
+{
+    int num_buffers;
+    uint32_t* buffers[SWAPCHAIN_MAX_BUFFERS];
+
+    // frame counts since creation; frame f lives in slot f % num_buffers, and
+    // presented <= rendered <= queued <= presented + num_buffers
+    SDL_mutex* lock;
+    SDL_cond* changed; // broadcast whenever any of the counts below moves, or on close
+    int queued;
+    int rendering; // frames the render thread has taken, = rendered or rendered + 1
+    int rendered;
+    int presented;
+    int closed;
+};
+
+swapchain* swapchain_create(int num_buffers, int width, int height)
+{
+    if (num_buffers < 2) num_buffers = 2;
+    if (num_buffers > SWAPCHAIN_MAX_BUFFERS) num_buffers = SWAPCHAIN_MAX_BUFFERS;
+
+    swapchain* sc = calloc(1, sizeof(swapchain));
+    if (!sc)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return NULL;
+    }
+    sc->num_buffers = num_buffers;
+    sc->lock = SDL_CreateMutex();
+    sc->changed = SDL_CreateCond();
+    int ok = sc->lock && sc->changed;
+    for (int i = 0; i < num_buffers && ok; i++)
+    {
+        sc->buffers[i] = malloc((size_t)width * height * sizeof(uint32_t));
+        ok = sc->buffers[i] != NULL;
+        if (ok)
+        {
+            dirty_fill32(sc->buffers[i], 0xFF000000, (size_t)width * height);
+        }
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to set up the swap chain!\n");
+        swapchain_destroy(sc);
+        return NULL;
+    }
+    return sc;
+}
+
+void swapchain_destroy(swapchain* sc)
+{
+    if (!sc)
+        return;
+    for (int i = 0; i < sc->num_buffers; i++)
+    {
+        free(sc->buffers[i]);
+    }
+    if (sc->changed) SDL_DestroyCond(sc->changed);
+    if (sc->lock) SDL_DestroyMutex(sc->lock);
+    free(sc);
+}
+
+uint32_t* swapchain_buffer(const swapchain* sc, int slot)
+{
+    return sc->buffers[slot];
+}
+
+int swapchain_acquire(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    while (sc->queued - sc->presented >= sc->num_buffers)
+    {
+        SDL_CondWait(sc->changed, sc->lock);
+    }
+    int slot = sc->queued % sc->num_buffers;
+    SDL_UnlockMutex(sc->lock);
+    return slot;
+}
+
+void swapchain_queue(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    sc->queued++;
+    SDL_CondBroadcast(sc->changed);
+    SDL_UnlockMutex(sc->lock);
+}
+
+int swapchain_wait_render(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    while (sc->rendering == sc->queued && !sc->closed)
+    {
+        SDL_CondWait(sc->changed, sc->lock);
+    }
+    int slot = -1;
+    if (sc->rendering < sc->queued)
+    {
+        slot = sc->rendering % sc->num_buffers;
+        sc->rendering++;
+    }
+    SDL_UnlockMutex(sc->lock);
+    return slot;
+}
+
+void swapchain_rendered(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    sc->rendered++;
+    SDL_CondBroadcast(sc->changed);
+    SDL_UnlockMutex(sc->lock);
+}
+
+int swapchain_wait_present(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    while (sc->rendered == sc->presented)
+    {
+        SDL_CondWait(sc->changed, sc->lock);
+    }
+    int slot = sc->presented % sc->num_buffers;
+    SDL_UnlockMutex(sc->lock);
+    return slot;
+}
+
+void swapchain_presented(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    sc->presented++;
+    SDL_CondBroadcast(sc->changed);
+    SDL_UnlockMutex(sc->lock);
+}
+
+int swapchain_in_flight(const swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    int count = sc->queued - sc->presented;
+    SDL_UnlockMutex(sc->lock);
+    return count;
+}
+
+void swapchain_close(swapchain* sc)
+{
+    SDL_LockMutex(sc->lock);
+    sc->closed = 1;
+    SDL_CondBroadcast(sc->changed);
+    SDL_UnlockMutex(sc->lock);
+}
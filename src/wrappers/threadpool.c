@@ -0,0 +1,189 @@
+// persistent worker threads for parallel-for jobs, on top of SDL's portable threads
+#include "threadpool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+typedef struct threadpool_worker
+{
+    threadpool* pool;
+    int id;
+} threadpool_worker;
+
+struct threadpool
+{
+    int num_threads; // including the caller
+    SDL_Thread** threads;
+    threadpool_worker* workers;
+
+    SDL_mutex* lock;
+    SDL_cond* wake;    // signalled when a new job is posted or the pool shuts down
+    SDL_cond* done;    // signalled when the last worker finishes a job
+    int generation;    // bumped for every job, so workers can tell a new job from a spurious wakeup
+    int busy;          // workers still inside the current job
+    int quit;
+
+    // the current job
+    threadpool_job job;
+    void* data;
+    int count;
+    SDL_atomic_t next; // next item to hand out
+};
+
+// grabs items until there are none left
+static void threadpool_drain(threadpool* pool, int worker)
+{
+    for (;;)
+    {
+        int index = SDL_AtomicAdd(&pool->next, 1);
+        if (index >= pool->count)
+            break;
+        pool->job(pool->data, index, worker);
+    }
+}
+
+static int threadpool_thread(void* arg)
+{
+    threadpool_worker* self = arg;
+    threadpool* pool = self->pool;
+    int seen = 0;
+
+    SDL_LockMutex(pool->lock);
+    for (;;)
+    {
+        while (!pool->quit && pool->generation == seen)
+        {
+            SDL_CondWait(pool->wake, pool->lock);
+        }
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        SDL_UnlockMutex(pool->lock);
+
+        threadpool_drain(pool, self->id);
+
+        SDL_LockMutex(pool->lock);
+        if (--pool->busy == 0)
+        {
+            SDL_CondSignal(pool->done);
+        }
+    }
+    SDL_UnlockMutex(pool->lock);
+    return 0;
+}
+
+threadpool* threadpool_create(int num_threads)
+{
+    threadpool* pool = calloc(1, sizeof(threadpool));
+    if (!pool)
+    {
+        fprintf(stderr, "Memory allocation failed!\n");
+        return NULL;
+    }
+    pool->num_threads = num_threads < 1 ? 1 : num_threads;
+
+    int extra = pool->num_threads - 1;
+    if (extra == 0)
+        return pool;
+
+    pool->threads = calloc(extra, sizeof(SDL_Thread*));
+    pool->workers = calloc(extra, sizeof(threadpool_worker));
+    pool->lock = SDL_CreateMutex();
+    pool->wake = SDL_CreateCond();
+    pool->done = SDL_CreateCond();
+    if (!pool->threads || !pool->workers || !pool->lock || !pool->wake || !pool->done)
+    {
+        fprintf(stderr, "Failed to set up thread pool!\n");
+        threadpool_destroy(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < extra; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i + 1;
+        pool->threads[i] = SDL_CreateThread(threadpool_thread, "render worker", &pool->workers[i]);
+        if (!pool->threads[i])
+        {
+            // run with however many threads we did get
+            fprintf(stderr, "Failed to create worker thread: %s\n", SDL_GetError());
+            pool->num_threads = i + 1;
+            break;
+        }
+    }
+    return pool;
+}
+
+void threadpool_run(threadpool* pool, threadpool_job job, void* data, int count)
+{
+    if (count <= 0)
+        return;
+
+    if (pool->num_threads == 1 || count == 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            job(data, i, 0);
+        }
+        return;
+    }
+
+    SDL_LockMutex(pool->lock);
+    pool->job = job;
+    pool->data = data;
+    pool->count = count;
+    SDL_AtomicSet(&pool->next, 0);
+    pool->busy = pool->num_threads - 1;
+    pool->generation++;
+    SDL_CondBroadcast(pool->wake);
+    SDL_UnlockMutex(pool->lock);
+
+    threadpool_drain(pool, 0);
+
+    SDL_LockMutex(pool->lock);
+    while (pool->busy > 0)
+    {
+        SDL_CondWait(pool->done, pool->lock);
+    }
+    SDL_UnlockMutex(pool->lock);
+}
+
+int threadpool_size(const threadpool* pool)
+{
+    return pool->num_threads;
+}
+
+void threadpool_destroy(threadpool* pool)
+{
+    if (!pool)
+        return;
+
+    if (pool->lock)
+    {
+        SDL_LockMutex(pool->lock);
+        pool->quit = 1;
+        SDL_CondBroadcast(pool->wake);
+        SDL_UnlockMutex(pool->lock);
+    }
+    for (int i = 0; pool->threads && i < pool->num_threads - 1; i++)
+    {
+        if (pool->threads[i])
+        {
+            SDL_WaitThread(pool->threads[i], NULL);
+        }
+    }
+
+    if (pool->done) SDL_DestroyCond(pool->done);
+    if (pool->wake) SDL_DestroyCond(pool->wake);
+    if (pool->lock) SDL_DestroyMutex(pool->lock);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+int threadpool_default_size(void)
+{
+    int cpus = SDL_GetCPUCount();
+    return cpus > 0 ? cpus : 1;
+}
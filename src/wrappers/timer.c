@@ -0,0 +1,22 @@
+// high resolution timing for benchmarks and profiling
+#include "timer.h"
+
+#include <SDL2/SDL.h>
+
+uint64_t timer_now_ns(void)
+{
+    static uint64_t frequency = 0;
+    if (frequency == 0)
+    {
+        frequency = SDL_GetPerformanceFrequency();
+    }
+
+    uint64_t counter = SDL_GetPerformanceCounter();
+    // split into whole seconds and remainder so the multiply can't overflow
+    return (counter / frequency) * 1000000000ull + (counter % frequency) * 1000000000ull / frequency;
+}
+
+double timer_ns_to_ms(uint64_t ns)
+{
+    return (double)ns / 1000000.0;
+}